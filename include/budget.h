@@ -0,0 +1,25 @@
+#ifndef NVFD_BUDGET_H
+#define NVFD_BUDGET_H
+
+/* Node-wide fan budget ("fan_budget"): the fan % of every controlled fan
+ * summed over the node. When the controllers ask for more, the GPUs with
+ * the least headroom below their critical_temp are served first and the
+ * coolest ones get what is left. Nobody goes below its floor: the fans'
+ * minimum, or everything it asked for when it is past critical_temp or
+ * under a manual order. */
+
+typedef struct {
+    int want;       /* sum of fan % the controller asked for */
+    int floor;      /* sum it cannot go below */
+    int headroom;   /* °C below critical_temp */
+    int grant;      /* result: sum of fan % allowed */
+} BudgetDemand;
+
+/* O(n^2) in the GPUs of one node, which is a handful */
+void budget_allocate(BudgetDemand *d, unsigned int count, int budget);
+
+/* One fan's share of its GPU's grant: what it asked for above fan_floor,
+ * scaled down as the whole GPU was */
+int  budget_share(const BudgetDemand *d, int wanted, int fan_floor);
+
+#endif /* NVFD_BUDGET_H */
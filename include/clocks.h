@@ -0,0 +1,38 @@
+#ifndef NVFD_CLOCKS_H
+#define NVFD_CLOCKS_H
+
+/* Clock-aware setpoint ("mode": "clocks"). GPU Boost sheds clock bins as
+ * the die heats, well before it throttles outright. The learner watches SM
+ * clocks under load and moves its estimate of the temperature where bins
+ * start to go: down when they are lost at or below it, up when full clocks
+ * hold above it. The fans then hold the GPU margin °C under that knee,
+ * never hotter than target nor cooler than floor. Clocks that stay at a
+ * lower plateau were not lost to heat (another workload, locked clocks):
+ * the learner takes that plateau as its peak and starts over. */
+
+typedef struct {
+    int floor;    /* °C, lowest setpoint the learner may choose */
+    int margin;   /* °C below the knee */
+} ClockParams;
+
+typedef struct {
+    int          primed;
+    double       knee;       /* °C, learned per GPU */
+    unsigned int peak_mhz;   /* highest SM clock seen under load */
+    unsigned int plateau_mhz;    /* clock of the current run below peak */
+    unsigned int plateau_count;  /* busy samples in that run */
+} ClockLearner;
+
+/* nvmlClocksThrottleReason* bits as sampled, and what they mean here */
+int  clock_thermal(unsigned long long reasons);
+int  clock_power(unsigned long long reasons);
+
+void clock_defaults(ClockParams *p, int target);
+/* Forget what was learned, e.g. when the target changes */
+void clock_reset(ClockLearner *c);
+
+/* sm_mhz and util are -1 when unavailable; returns the setpoint in °C */
+int  clock_update(ClockLearner *c, const ClockParams *p, int target, int temp,
+                  int sm_mhz, unsigned long long reasons, int util);
+
+#endif /* NVFD_CLOCKS_H */
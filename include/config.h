@@ -3,10 +3,121 @@
 
 #include <jansson.h>
 #include "nvfd.h"
+#include "pid.h"
+#include "smooth.h"
+#include "feedforward.h"
+#include "clocks.h"
+#include "efficiency.h"
+#include "governor.h"
+#include "realtime.h"
+#include "curve.h"
+#include "proc.h"
+#include "zone.h"
+
+typedef enum {
+    FAN_MODE_AUTO = 0,
+    FAN_MODE_MANUAL,
+    FAN_MODE_CURVE,
+    FAN_MODE_TARGET,
+    FAN_MODE_CLOCKS,
+    FAN_MODE_EFFICIENCY
+} FanMode;
+
+typedef struct {
+    char    key[NVML_DEVICE_UUID_V2_BUFFER_SIZE]; /* GPU UUID or legacy "gpuN" */
+    FanMode mode;
+    int     speed;     /* manual mode only */
+    int     target;    /* target mode: °C to hold; clocks, efficiency: at most */
+    SensorExpr sensor;     /* what the fans follow, no terms = the core */
+    PidGains gains;
+    ClockParams clocks;    /* clocks mode */
+    EfficiencyParams efficiency;  /* efficiency mode */
+    SmoothParams smooth;   /* temperature filter and fan slew limits */
+    FeedForwardParams feedforward;
+    GovernorParams governor;  /* power limit once the fans are saturated */
+    int     poll_min_ms;   /* adaptive polling range */
+    int     poll_max_ms;
+    int     min_speed;     /* fan limits below critical_temp */
+    int     max_speed;
+    char    profile[NVFD_PROFILE_NAME_MAX];  /* config.json: profile at start */
+} GpuPolicy;
+
+/* A named policy from NVFD_PROFILE_DIR, compiled along with the rest of
+ * the configuration so switching to it is a pointer swap */
+typedef struct {
+    char          name[NVFD_PROFILE_NAME_MAX];
+    GpuPolicy     policy;
+    CurveSet     *curves;            /* its own "curve", NULL = curve.json's */
+    DeviceCurves *curves_by_device;
+} Profile;
+
+/* "While a process like this runs on a GPU, use this profile" */
+typedef struct {
+    ProcPattern    process;  /* against /proc/<pid>/comm */
+    ProcPattern    cgroup;
+    char           name[NVFD_PROFILE_NAME_MAX];
+    const Profile *profile;  /* resolved once profiles are loaded */
+} ProcessRule;
+
+/* Parsed, validated view of config.json and curve.json. Never modified
+ * after load: the daemon swaps whole snapshots when the files change. */
+typedef struct {
+    int          poll_min_ms;  /* defaults for GPUs without their own range */
+    int          poll_max_ms;
+    int          deadband;     /* skip fan writes closer than this (%) */
+    int          reassert_s;   /* rewrite unchanged speeds this often, 0 = never */
+    int          fan_budget;   /* node-wide sum of fan %, 0 = none */
+    SmoothParams smooth;       /* defaults for GPUs without their own */
+    FeedForwardParams feedforward;
+    GovernorParams governor;
+    RealtimeParams realtime;   /* applied at startup only */
+    GpuPolicy   *policies;
+    int          policy_count;
+    CurveSet    *curves;   /* NULL = built-in default curve */
+    DeviceCurves *curves_by_device;  /* compiled per GPU index */
+    const GpuPolicy **by_device;  /* resolved per GPU index, NULL = auto */
+    Profile     *profiles;     /* sorted by name */
+    int          profile_count;
+    ProcessRule *rules;        /* first match wins */
+    int          rule_count;
+    int          rule_cgroups; /* some rule looks at cgroups */
+    int          rule_poll_s;
+    int          rule_debounce_s;
+    Zone        *zones;
+    int          zone_count;
+    const Zone **zone_by_device;  /* resolved per GPU index, NULL = alone */
+} ConfigSnapshot;
 
 int     config_ensure_dir(void);
 json_t *config_read(void);
-int     config_write_gpu(const char *gpu_key, const char *mode, int speed);
+json_t *config_gpu_entry(const json_t *root, unsigned int gpu_index);
+/* value is the speed for "manual" and the temperature for "target" */
+int     config_write_gpu(unsigned int gpu_index, const char *mode, int value);
+/* Target and gains of a raw entry, defaults where missing or invalid */
+void    config_entry_target(const json_t *entry, int *target, PidGains *gains);
 int     config_migrate(void);
+int     config_parse_mode(const char *str, FanMode *mode);
+const char *config_mode_name(FanMode mode);
+int     config_valid_profile_name(const char *name);
+
+/* Returns NULL (and reports why on stderr) if either file is invalid */
+ConfigSnapshot  *config_snapshot_load(void);
+ConfigSnapshot  *config_snapshot_empty(void);
+void             config_snapshot_free(ConfigSnapshot *snap);
+const GpuPolicy *config_snapshot_policy(const ConfigSnapshot *snap, unsigned int gpu_index);
+const DeviceCurves *config_snapshot_curves(const ConfigSnapshot *snap,
+                                           unsigned int gpu_index);
+/* The zone a GPU belongs to, NULL if none; *member = its index there */
+const Zone *config_snapshot_zone(const ConfigSnapshot *snap, unsigned int gpu_index,
+                                 int *member);
+/* First rule matching a process in list, NULL if none; *proc = the process */
+const ProcessRule *config_match_rules(const ConfigSnapshot *snap,
+                                      const ProcessList *list,
+                                      const ProcInfo **proc);
+const Profile   *config_snapshot_profile(const ConfigSnapshot *snap, const char *name);
+/* Curves a GPU follows under a profile (NULL = no profile) */
+const DeviceCurves *config_profile_curves(const ConfigSnapshot *snap,
+                                          const Profile *profile,
+                                          unsigned int gpu_index);
 
 #endif /* NVFD_CONFIG_H */
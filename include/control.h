@@ -0,0 +1,42 @@
+#ifndef NVFD_CONTROL_H
+#define NVFD_CONTROL_H
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "nvfd.h"
+
+/* Requests to the running daemon over NVFD_CONTROL_SOCKET, one datagram
+ * each way:
+ *   "profile <name|none> <gpu|all>"  -> "ok" or "error <reason>"
+ *   "active"                         -> one "<gpu> <profile|->" line per GPU
+ *   "budget"                         -> "budget <fan %>", then one
+ *                                       "<gpu> <granted> <wanted>" line per
+ *                                       GPU counted against it */
+
+#define CONTROL_MSG_MAX 4096
+
+typedef struct {
+    struct sockaddr_un from;
+    socklen_t          from_len;
+    char               text[CONTROL_MSG_MAX];
+} ControlMsg;
+
+/* Daemon side */
+int  control_open(void);
+void control_close(int fd);
+/* 1 with a request in msg, 0 when none is left */
+int  control_recv(int fd, ControlMsg *msg);
+void control_reply(int fd, const ControlMsg *msg, const char *text);
+
+/* Client side: -1 if no daemon answered in NVFD_CONTROL_TIMEOUT_MS */
+int  control_request(const char *request, char *reply, size_t len);
+/* name NULL = none, gpu -1 = all; 1 if the daemon refused, reason in err */
+int  control_set_profile(const char *name, int gpu, char *err, size_t len);
+/* Fills names[i] for count GPUs, "" where none is active */
+int  control_active_profiles(char (*names)[NVFD_PROFILE_NAME_MAX], unsigned int count);
+/* The node fan budget (0 = none) and, for count GPUs, the fan % granted
+ * and wanted, -1 where a GPU is not counted */
+int  control_fan_budget(int *budget, int *granted, int *wanted, unsigned int count);
+
+#endif /* NVFD_CONTROL_H */
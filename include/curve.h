@@ -1,15 +1,130 @@
 #ifndef NVFD_CURVE_H
 #define NVFD_CURVE_H
 
+#include <stddef.h>
+#include <jansson.h>
 #include "nvfd.h"
 
-FanCurve *curve_read(void);
-int       curve_write(const FanCurve *curve);
-void      curve_edit(int temp, int speed);
-void      curve_reset(void);
+/* Whole-degree temperature range a compiled curve covers; readings outside
+ * it clamp to the nearest end */
+#define CURVE_TEMP_MIN   0
+#define CURVE_TEMP_MAX 150
+
+/* Limits for the falling-edge options of a curve */
+#define CURVE_HYSTERESIS_MAX 20
+#define CURVE_HOLD_S_MAX    600.0
+
+/* A curve flattened to one rounded speed per degree, built once when the
+ * curve is loaded so that evaluating it is a single index */
+typedef struct {
+    unsigned char speed[CURVE_TEMP_MAX - CURVE_TEMP_MIN + 1];
+    int    hysteresis;
+    double hold_s;
+    SensorExpr sensor;       /* no terms = the GPU's input */
+} CurveTable;
+
+/* What one fan's curve output last was, for hysteresis and hold */
+typedef struct {
+    int    primed;
+    int    speed;
+    double raised_at;
+} CurveState;
+
+/* Override for one GPU, keyed like config.json (UUID or legacy "gpuN").
+ * An empty curve inherits: fans from their GPU, the GPU from the default. */
+typedef struct {
+    char         key[NVML_DEVICE_UUID_V2_BUFFER_SIZE];
+    FanCurve     curve;
+    FanCurve    *fans;       /* indexed by fan */
+    unsigned int fan_count;
+} GpuCurve;
+
+/* Everything in curve.json */
+typedef struct {
+    FanCurve  def;           /* no points = built-in curve */
+    GpuCurve *gpus;
+    int       gpu_count;
+} CurveSet;
+
+/* Which curve a command acts on: gpu -1 = default, fan -1 = whole GPU */
+typedef struct {
+    int gpu;
+    int fan;
+} CurveSelector;
+
+/* One GPU's curves compiled for the control loop */
+typedef struct {
+    const FanCurve *curve;   /* GPU curve in effect, NULL = built-in */
+    CurveTable      table;
+    CurveTable     *fans;    /* one per fan, inherited ones copied */
+    unsigned int    fan_count;
+    unsigned int    sensors; /* sensor_mask() of every bound curve */
+} DeviceCurves;
+
+/* Point lists */
+void      curve_init(FanCurve *curve);
+void      curve_free(FanCurve *curve);
+int       curve_copy(FanCurve *dst, const FanCurve *src);
+/* Adds or updates the point at temp; returns its index, -1 if out of memory */
+int       curve_set_point(FanCurve *curve, int temp, int speed);
+void      curve_remove_point(FanCurve *curve, int index);
+/* The curve 'nvfd curve reset' writes */
+int       curve_fill_default(FanCurve *curve);
+
+/* Lenient reader for interactive use: skips bad entries, NULL if no file */
+CurveSet *curve_read(void);
+/* Strict loader: 0 with *out == NULL if no curve file, -1 if invalid */
+int       curve_load(CurveSet **out);
+int       curve_write(const CurveSet *set);
+/* Strict parse of a curve.json-style object found in another file */
+CurveSet *curve_parse(const json_t *root, const char *file);
+CurveSet *curve_set_new(void);
+void      curve_set_free(CurveSet *set);
+
+/* Override entry for a GPU (UUID key wins over "gpuN"), NULL if none */
+const GpuCurve *curve_set_gpu(const CurveSet *set, unsigned int gpu_index);
+/* Curve in effect for a GPU's fan (fan -1 = the GPU itself), NULL = built-in */
+const FanCurve *curve_resolve(const CurveSet *set, unsigned int gpu_index, int fan);
+/* Editable curve for sel, created from the inherited one if missing */
+FanCurve *curve_select(CurveSet *set, CurveSelector sel);
+
+/* "default", "N", "gpuN", optionally ":F" for one fan */
+int       curve_parse_selector(const char *str, CurveSelector *sel);
+void      curve_describe(CurveSelector sel, char *buf, size_t len);
+
+void      curve_edit(CurveSelector sel, int temp, int speed);
+/* Default curve: restore the stock points; GPU or fan: drop the override */
+void      curve_reset(CurveSelector sel);
 int       curve_interpolate(int temp, const FanCurve *curve);
+/* "linear", "monotone_cubic", "step" */
+const char *curve_interpolation_name(CurveInterpolation mode);
+int       curve_parse_interpolation(const char *name, CurveInterpolation *mode);
 
 /* Default built-in curve interpolation (fallback when no curve file exists) */
 int       curve_default_interpolate(int temp);
 
+/* NULL or an empty curve compiles the built-in curve */
+void      curve_compile(const FanCurve *curve, CurveTable *table);
+int       curve_lookup(const CurveTable *table, int temp);
+/* speeds[i] = curve_lookup(tables[i], temps[i]) for count fans */
+void      curve_lookup_batch(const CurveTable *const *tables, const int *temps,
+                             unsigned int *speeds, unsigned int count);
+
+/* Rises follow the curve at once. Falls wait until hold_s has passed since
+ * the last rise, then follow the curve shifted hysteresis °C hotter, so a
+ * reading hovering at a point does not make the fans hunt. speed is
+ * curve_lookup(table, temp), e.g. from a batch. */
+void      curve_state_reset(CurveState *s);
+int       curve_hold(const CurveTable *table, CurveState *s, int speed, int temp,
+                     double now);
+int       curve_eval(const CurveTable *table, CurveState *s, int temp, double now);
+
+int       curve_compile_device(const CurveSet *set, unsigned int gpu_index,
+                               unsigned int fan_count, DeviceCurves *out);
+void      curve_device_free(DeviceCurves *dc);
+const CurveTable *curve_fan_table(const DeviceCurves *dc, unsigned int fan);
+
+/* 1 if temp is within margin °C of a point (NULL = built-in curve) */
+int       curve_near_point(const FanCurve *curve, int temp, int margin);
+
 #endif /* NVFD_CURVE_H */
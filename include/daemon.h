@@ -0,0 +1,6 @@
+#ifndef NVFD_DAEMON_H
+#define NVFD_DAEMON_H
+
+int daemon_run(void);
+
+#endif /* NVFD_DAEMON_H */
@@ -1,9 +1,13 @@
 #ifndef NVFD_DISPLAY_H
 #define NVFD_DISPLAY_H
 
+#include "curve.h"
+
 void display_help(void);
 void display_status(void);
 void display_list_gpus(void);
-void display_fan_curve(void);
+/* NULL shows the default curve and lists the overrides */
+void display_fan_curve(const CurveSelector *sel);
+void display_profiles(void);
 
 #endif /* NVFD_DISPLAY_H */
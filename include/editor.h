@@ -1,6 +1,9 @@
 #ifndef NVFD_EDITOR_H
 #define NVFD_EDITOR_H
 
-int editor_run(void);
+#include "curve.h"
+
+/* Edits the curve sel names; saving writes it back into curve.json */
+int editor_run(CurveSelector sel);
 
 #endif /* NVFD_EDITOR_H */
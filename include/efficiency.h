@@ -0,0 +1,50 @@
+#ifndef NVFD_EFFICIENCY_H
+#define NVFD_EFFICIENCY_H
+
+/* Efficiency mode ("mode": "efficiency"). A hotter die leaks more, so
+ * below some speed the watts a slower fan saves come back as board power.
+ * The optimizer looks for the speed where board power plus the estimated
+ * fan power is lowest. It first follows the curve for one dwell to measure
+ * what the curve costs, then perturbs and observes: it holds a speed for
+ * dwell_s, averages the total over the second half (the first is the die
+ * settling), and steps step % on the same way if the total fell, back if
+ * it rose. It ends up dithering about the minimum. A dwell only counts if
+ * utilization held steady through it; a change of load starts over from
+ * the curve. The GPU is never left at or above max_temp. */
+
+typedef struct {
+    double fan_watts;   /* one fan at 100 %, W; fans draw speed³ of it */
+    int    step;        /* fan % */
+    double dwell_s;
+} EfficiencyParams;
+
+typedef struct {
+    int    primed;
+    int    searching;    /* 0 = measuring the curve */
+    int    speed;        /* fan % on trial */
+    int    dir;          /* +1 or -1 */
+    double since;        /* start of the dwell */
+    double sum;          /* total power over the judged half, W·s */
+    double weight;       /* s */
+    int    util_lo, util_hi;
+    double last;         /* W at the previous speed, < 0 = none */
+    double total;        /* W, latest sample */
+    double curve_w;      /* W on the curve, at curve_speed */
+    int    curve_speed;
+    double saved_j;      /* energy below the curve over judged dwells */
+    double judged_s;
+    unsigned long long restarts;  /* load changes */
+} Efficiency;
+
+void eff_defaults(EfficiencyParams *p);
+/* Starts the search over from the curve, keeps the energy account */
+void eff_reset(Efficiency *e);
+
+/* power_mw and util are -1 when unavailable, without power the curve is
+ * followed. curve_speed is what the curve wants now, lo-hi the speeds
+ * allowed. Returns the fan speed to run. */
+int  eff_update(Efficiency *e, const EfficiencyParams *p, int max_temp, int temp,
+                int power_mw, int util, unsigned int fans, int curve_speed,
+                int lo, int hi, double dt, double now);
+
+#endif /* NVFD_EFFICIENCY_H */
@@ -0,0 +1,39 @@
+#ifndef NVFD_EVENTS_H
+#define NVFD_EVENTS_H
+
+/* NVML events wake the control loop as they happen instead of at the next
+ * poll. One thread blocks in nvmlEventSetWait for every GPU that supports
+ * them and queues what arrives; the loop reads the queue once the eventfd
+ * becomes readable. GPUs without event support are only polled. */
+
+#define EVENTS_QUEUE_MAX 64
+
+typedef struct {
+    unsigned int       gpu_index;
+    unsigned long long type;    /* nvmlEventType* */
+    unsigned long long data;    /* the Xid for nvmlEventTypeXidCriticalError */
+} GpuEvent;
+
+typedef struct EventWaiter EventWaiter;
+
+/* NULL if no GPU supports the events nvfd listens for */
+EventWaiter *events_start(void);
+/* Returns -1 instead of blocking if the waiter is still inside NVML; it
+ * then frees itself once NVML returns */
+int  events_stop(EventWaiter *w);
+/* Waiters events_stop() gave up on that are still inside NVML */
+unsigned int events_left_behind(void);
+
+/* nvmlEventType* bits registered for the GPU, 0 = polled only */
+unsigned long long events_registered(const EventWaiter *w, unsigned int gpu_index);
+/* Readable whenever events are queued or waiting has failed */
+int  events_fd(const EventWaiter *w);
+/* Moves up to max queued events into out; *dropped is how many were lost
+ * to a full queue since the last read */
+unsigned int events_read(EventWaiter *w, GpuEvent *out, unsigned int max,
+                         unsigned long long *dropped);
+/* 1 once NVML refused to wait; the waiter has stopped */
+int  events_failed(EventWaiter *w);
+const char *events_name(unsigned long long type);
+
+#endif /* NVFD_EVENTS_H */
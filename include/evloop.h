@@ -0,0 +1,69 @@
+#ifndef NVFD_EVLOOP_H
+#define NVFD_EVLOOP_H
+
+#include <stdint.h>
+#include <signal.h>
+
+#define EVLOOP_MAX_SLOTS 16
+#define EVLOOP_JITTER_BUCKETS 13
+
+typedef struct EvLoop EvLoop;
+
+typedef void (*EvFdHandler)(EvLoop *loop, int fd, uint32_t events, void *arg);
+typedef void (*EvTimerHandler)(EvLoop *loop, void *arg);
+typedef void (*EvSignalHandler)(EvLoop *loop, int signum, void *arg);
+
+typedef struct {
+    int         fd;        /* -1 = free slot */
+    EvFdHandler handler;
+    void       *arg;
+} EvSlot;
+
+/* How late timer wakeups ran: from the deadline, or from arming if that
+ * came later, to the handler */
+typedef struct {
+    unsigned long long count;
+    double             sum;      /* seconds */
+    double             max;
+    unsigned long long hist[EVLOOP_JITTER_BUCKETS];
+} EvJitter;
+
+struct EvLoop {
+    int             epoll_fd;
+    int             timer_fd;   /* CLOCK_MONOTONIC, absolute deadlines */
+    int             signal_fd;
+    double          deadline;   /* armed expiry, 0 = disarmed */
+    double          armed_at;
+    EvJitter        jitter;
+    EvTimerHandler  on_timer;
+    EvSignalHandler on_signal;
+    void           *arg;
+    EvSlot          slots[EVLOOP_MAX_SLOTS];
+    int             running;
+};
+
+/* Blocks the given signals and routes them through signalfd */
+int  evloop_init(EvLoop *loop, const sigset_t *signals,
+                 EvTimerHandler on_timer, EvSignalHandler on_signal, void *arg);
+void evloop_close(EvLoop *loop);
+
+/* One-shot timer at an absolute evloop_now() time; re-arming replaces it.
+ * Callers derive the next deadline from the previous one, not from the
+ * wakeup time, so schedules do not drift. */
+int  evloop_arm(EvLoop *loop, double deadline);
+
+int  evloop_add_fd(EvLoop *loop, int fd, uint32_t events,
+                   EvFdHandler handler, void *arg);
+int  evloop_del_fd(EvLoop *loop, int fd);
+
+/* CLOCK_MONOTONIC in seconds, the time base for all loop bookkeeping */
+double evloop_now(void);
+
+/* Upper bound in seconds of the jitter bucket holding quantile q (0-1);
+ * the maximum if that is the last bucket */
+double evloop_jitter_quantile(const EvJitter *jitter, double q);
+
+int  evloop_run(EvLoop *loop);
+void evloop_stop(EvLoop *loop);
+
+#endif /* NVFD_EVLOOP_H */
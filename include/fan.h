@@ -3,12 +3,40 @@
 
 #include "nvfd.h"
 
+/* What the daemon last wrote to each fan of one GPU */
+typedef struct {
+    unsigned int count;
+    int    *speed;       /* -1 = unknown, next command writes */
+    double *written_at;  /* monotonic seconds */
+} FanState;
+
+typedef struct {
+    unsigned long long writes;
+    unsigned long long skipped;
+    unsigned long long failures;
+} FanWriteStats;
+
 int  fan_get_count(nvmlDevice_t device);
 int  fan_get_speed(nvmlDevice_t device, unsigned int fan);
 int  fan_set_speed(nvmlDevice_t device, unsigned int fan, unsigned int speed);
+/* Speeds nvfd will actually write to this GPU */
+int  fan_get_range(unsigned int gpu_index, unsigned int *lo, unsigned int *hi);
 int  fan_set_gpu_speed(unsigned int gpu_index, unsigned int speed);
+/* One speed per fan of the GPU */
+int  fan_set_gpu_speeds(unsigned int gpu_index, const unsigned int *speeds);
 int  fan_set_all_speed(unsigned int speed);
 int  fan_reset_to_auto(unsigned int gpu_index);
 void fan_reset_all_to_auto(void);
 
+/* Change-only write of one speed per fan: skips fans already within
+ * deadband of their speed, unless the last write is older than reassert_s
+ * (catches driver resets). */
+int  fan_state_init(FanState *fs, unsigned int fan_count);
+void fan_state_free(FanState *fs);
+void fan_state_reset(FanState *fs);
+int  fan_command_gpu_speeds(unsigned int gpu_index, const unsigned int *speeds,
+                            FanState *fs, unsigned int deadband,
+                            unsigned int reassert_s, double now,
+                            FanWriteStats *stats);
+
 #endif /* NVFD_FAN_H */
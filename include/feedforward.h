@@ -0,0 +1,31 @@
+#ifndef NVFD_FEEDFORWARD_H
+#define NVFD_FEEDFORWARD_H
+
+/* Load feed-forward: a jump in power draw or utilization raises the fan
+ * target before the temperature responds. Each input is compared with a
+ * slow baseline that follows it with time constant tau_s, so the boost
+ * fades as the die heats up and the temperature term takes over. */
+
+typedef struct {
+    double power_gain;   /* fan % per % of power limit above baseline */
+    double util_gain;    /* fan % per % of utilization above baseline */
+    double tau_s;        /* baseline time constant */
+    double max;          /* cap on the boost, fan % */
+} FeedForwardParams;
+
+typedef struct {
+    int    primed;
+    double power_base;   /* % of power limit, -1 = no reading */
+    double util_base;
+    double boost;        /* last output */
+} FeedForward;
+
+void   ff_defaults(FeedForwardParams *p);
+int    ff_enabled(const FeedForwardParams *p);
+void   ff_reset(FeedForward *ff);
+
+/* power_pct and util are -1 when unavailable; returns the boost in fan % */
+double ff_update(FeedForward *ff, const FeedForwardParams *p,
+                 double power_pct, double util, double dt);
+
+#endif /* NVFD_FEEDFORWARD_H */
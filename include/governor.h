@@ -0,0 +1,38 @@
+#ifndef NVFD_GOVERNOR_H
+#define NVFD_GOVERNOR_H
+
+/* Thermal governor: the lever left once the fans can do no more. While
+ * every fan is at its ceiling (the card's maximum or the policy's
+ * max_speed) and the GPU is still at or above temp, the power limit steps
+ * down by step % of the original limit every interval_s, no lower than
+ * floor %. Once the GPU is hysteresis °C below temp, it steps back up the
+ * same way until the original limit is restored. */
+
+typedef struct {
+    int    temp;         /* °C, 0 = off */
+    int    step;         /* % of the original limit */
+    int    floor;        /* % of the original limit */
+    double interval_s;
+    int    hysteresis;   /* °C */
+} GovernorParams;
+
+typedef struct {
+    int    limit;        /* mW wanted, 0 = the original limit */
+    int    applied;      /* mW in effect, 0 = the original limit */
+    int    failed;       /* the driver refused a limit; stop trying */
+    double changed_at;
+    unsigned long long cuts;
+    unsigned long long restores;
+} Governor;
+
+void gov_defaults(GovernorParams *p);
+int  gov_enabled(const GovernorParams *p);
+/* Forgets the failure, keeps what is applied and the counters */
+void gov_reset(Governor *g);
+
+/* orig_mw and min_mw are the GPU's original and lowest accepted power
+ * limits. Returns the limit now wanted in mW, 0 = the original. */
+int  gov_update(Governor *g, const GovernorParams *p, int temp, int saturated,
+                int orig_mw, int min_mw, double now);
+
+#endif /* NVFD_GOVERNOR_H */
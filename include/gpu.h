@@ -3,15 +3,79 @@
 
 #include "nvfd.h"
 
+/* Static per-device data, probed once in gpu_init() */
+typedef struct {
+    unsigned int index;
+    nvmlDevice_t handle;
+    int          valid;      /* handle lookup succeeded */
+    char         uuid[NVML_DEVICE_UUID_V2_BUFFER_SIZE];
+    char         pci_bus_id[NVML_DEVICE_PCI_BUS_ID_BUFFER_SIZE];
+    char         name[NVML_DEVICE_NAME_BUFFER_SIZE];
+    unsigned int fan_count;
+    unsigned int fan_min;    /* percent, driver-reported range */
+    unsigned int fan_max;
+    int          has_mem_temp;
+    /* Driver temperature thresholds, °C, -1 = not reported */
+    int          slowdown_temp;
+    int          shutdown_temp;
+    int          gpu_max_temp;
+    int          mem_max_temp;
+    /* Power limit to step from and restore (the one in force at probe
+     * time, never above the driver default), the lowest the driver
+     * accepts, mW, 0 = not adjustable, and the driver default, 0 = not
+     * reported */
+    int          power_orig;
+    int          power_min;
+    int          power_default;
+} GpuDevice;
+
+/* What an NVML error means for the daemon: the GPU may answer next time,
+ * it is gone until probed again, or the library needs nvmlInit again */
+typedef enum {
+    GPU_FAULT_NONE = 0,
+    GPU_FAULT_TRANSIENT,
+    GPU_FAULT_LOST,
+    GPU_FAULT_LIBRARY
+} GpuFault;
+
 int  gpu_init(void);
+/* Also sets device_count to 0 */
 void gpu_shutdown(void);
+/* What NVML counts now, for spotting added or removed GPUs */
+nvmlReturn_t gpu_count_now(unsigned int *count);
+GpuFault gpu_fault(nvmlReturn_t r);
+/* Looks a lost GPU up again into *fresh, on its worker; the table itself
+ * is left alone. 0 = back as it was, 1 = a different device is at this
+ * index now, -1 = still gone (*status says why). */
+int  gpu_reprobe(unsigned int index, GpuDevice *fresh, nvmlReturn_t *status);
+/* Replaces the table entry with a gpu_reprobe() result, keeping the
+ * original power limit. Main thread only, with the GPU's worker idle and
+ * the event waiter stopped: both read the entry. */
+void gpu_adopt(unsigned int index, const GpuDevice *fresh);
+/* After NVML is initialized again, the limit to restore for a GPU whose
+ * limit nvfd had cut when the library failed. Main thread only. */
+void gpu_keep_power(unsigned int index, int power_orig);
+const GpuDevice *gpu_device(unsigned int index);
+int  gpu_find_uuid(const char *uuid);
 int  gpu_get_handle(unsigned int index, nvmlDevice_t *device);
 int  gpu_get_temperature(nvmlDevice_t device);
+/* Memory junction temperature, -1 where the board has no such sensor */
+int  gpu_get_memory_temperature(nvmlDevice_t device);
+/* temps[] indexed by SensorId for the sensors in mask, -1 = no reading;
+ * returns the NVML result of the core reading */
+nvmlReturn_t gpu_read_sensors(const GpuDevice *dev, unsigned int mask, int *temps);
 int  gpu_get_name(nvmlDevice_t device, char *buf, unsigned int len);
 int  gpu_enable_persistence(void);
 int  gpu_get_utilization(nvmlDevice_t device);
 int  gpu_get_memory(nvmlDevice_t device, unsigned long long *used, unsigned long long *total);
 int  gpu_get_power(nvmlDevice_t device);
 int  gpu_get_power_limit(nvmlDevice_t device);
+/* Needs root; -1 on error */
+int  gpu_set_power_limit(nvmlDevice_t device, int mw);
+int  gpu_get_sm_clock(nvmlDevice_t device);
+/* nvmlClocksThrottleReason* bits; -1 if unavailable */
+int  gpu_get_throttle_reasons(nvmlDevice_t device, unsigned long long *reasons);
+/* Distinct PIDs of compute and graphics clients, at most max; -1 on error */
+int  gpu_get_processes(nvmlDevice_t device, unsigned int *pids, unsigned int max);
 
 #endif /* NVFD_GPU_H */
@@ -0,0 +1,36 @@
+#ifndef NVFD_HEALTH_H
+#define NVFD_HEALTH_H
+
+#include "gpu.h"
+
+/* Per-GPU health. A GPU is healthy while its readings succeed. After
+ * NVFD_HEALTH_DEGRADED_AFTER failed readings in a row it is degraded: its
+ * fans go back to the driver and it is only sampled, at poll_max_ms, until
+ * a reading succeeds. A GPU NVML reports lost gets nothing but re-probes,
+ * the wait between them doubling from NVFD_HEALTH_RETRY_MIN_S up to
+ * NVFD_HEALTH_RETRY_MAX_S. Library failures are the daemon's to handle. */
+
+typedef enum {
+    HEALTH_OK = 0,
+    HEALTH_DEGRADED,
+    HEALTH_LOST
+} HealthState;
+
+typedef struct {
+    HealthState state;
+    int    failures;     /* failed readings in a row */
+    double since;        /* when the state last changed */
+    double backoff;      /* s, while lost */
+    double retry_at;
+    unsigned long long losses;
+} Health;
+
+const char *health_name(HealthState state);
+/* Lost from the start, e.g. no handle at startup; probed at once */
+void health_lost(Health *h, double now);
+/* A sample's fault; returns the new state */
+HealthState health_sample(Health *h, GpuFault fault, double now);
+/* A re-probe's outcome while lost; returns the new state */
+HealthState health_probe(Health *h, int back, double now);
+
+#endif /* NVFD_HEALTH_H */
@@ -4,32 +4,199 @@
 #include <nvml.h>
 #include <signal.h>
 
+/* Older nvml.h releases only define the v1 UUID buffer size */
+#ifndef NVML_DEVICE_UUID_V2_BUFFER_SIZE
+#define NVML_DEVICE_UUID_V2_BUFFER_SIZE 96
+#endif
+
 #define NVFD_VERSION "1.1"
 
+/* The test build (make check) points these into the build tree */
+#ifndef NVFD_CONFIG_DIR
 #define NVFD_CONFIG_DIR   "/etc/nvfd"
-#define NVFD_CONFIG_FILE  "/etc/nvfd/config.json"
-#define NVFD_CURVE_FILE   "/etc/nvfd/curve.json"
+#endif
+#define NVFD_CONFIG_FILE  NVFD_CONFIG_DIR "/config.json"
+#define NVFD_CURVE_FILE   NVFD_CONFIG_DIR "/curve.json"
+#define NVFD_PROFILE_DIR  NVFD_CONFIG_DIR "/profiles"
+
+/* The running daemon takes profile switches on this datagram socket */
+#ifndef NVFD_CONTROL_SOCKET
+#define NVFD_CONTROL_SOCKET "/run/nvfd.sock"
+#endif
+#define NVFD_CONTROL_TIMEOUT_MS 1000
+
+/* Profiles are <name>.json in NVFD_PROFILE_DIR; names are [A-Za-z0-9_-] */
+#define NVFD_PROFILE_NAME_MAX 32
+
+/* Process rules ("rules", "rule_poll_s", "rule_debounce_s" under "daemon"):
+ * the processes on each GPU are listed at most every rule_poll_s, and a
+ * change must hold for rule_debounce_s before the profile follows it */
+#define NVFD_RULE_POLL_S_DEFAULT      5
+#define NVFD_RULE_DEBOUNCE_S_DEFAULT 10
 
 /* Legacy paths for migration */
 #define NVFD_OLD_CONFIG_FILE "/etc/infinirc_gpu_fan_control.conf"
 #define NVFD_OLD_CURVE_FILE  "/etc/infinirc_gpu_fan_curve.json"
 
-#define MAX_GPU_COUNT    8
-#define MAX_FAN_COUNT    4
-#define MAX_CURVE_POINTS 20
+/* Adaptive polling: "poll_min_ms"/"poll_max_ms" under "daemon" or per GPU.
+ * A GPU is polled at the minimum while its temperature moves faster than
+ * NVFD_POLL_FAST_SLOPE or sits within NVFD_POLL_KNEE_MARGIN of a curve
+ * point, and backs off towards the maximum while it is steady. */
+#define NVFD_POLL_MIN_MS_DEFAULT  250
+#define NVFD_POLL_MAX_MS_DEFAULT 5000
+#define NVFD_POLL_MS_LOWER         50
+#define NVFD_POLL_MS_UPPER      60000
+#define NVFD_POLL_FAST_SLOPE     0.5   /* °C per second */
+#define NVFD_POLL_KNEE_MARGIN      2   /* °C */
+
+/* Fan write suppression ("daemon": {"deadband": N, "reassert_s": N}) */
+#define NVFD_DEADBAND_DEFAULT       1
+#define NVFD_REASSERT_S_DEFAULT    30
+
+/* Control shaping ("filter", "filter_tau_s", "filter_window", "slew_up",
+ * "slew_down", "critical_temp" under "daemon" or per GPU) */
+#define NVFD_FILTER_TAU_S_DEFAULT   2.0
+#define NVFD_FILTER_WINDOW_DEFAULT    5
+#define NVFD_SLEW_UP_DEFAULT       25.0   /* fan % per second */
+#define NVFD_SLEW_DOWN_DEFAULT      5.0
+#define NVFD_SLEW_MAX             100.0
+#define NVFD_CRITICAL_TEMP_DEFAULT   85
+
+/* Load feed-forward ("ff_power_gain", "ff_util_gain", "ff_tau_s", "ff_max");
+ * off unless a gain is set */
+#define NVFD_FF_TAU_S_DEFAULT      20.0
+#define NVFD_FF_MAX_DEFAULT        30.0
+#define NVFD_FF_GAIN_MAX           10.0
+
+/* Target mode ("mode": "target", "target": °C, optional "kp"/"ki"/"kd") */
+#define NVFD_TARGET_MIN            30
+#define NVFD_TARGET_MAX            95
+#define NVFD_TARGET_DEFAULT        70
+#define NVFD_PID_KP_DEFAULT       4.0
+#define NVFD_PID_KI_DEFAULT       0.2
+#define NVFD_PID_KD_DEFAULT       0.0
+#define NVFD_PID_GAIN_MAX       100.0
+
+/* Clocks mode ("mode": "clocks", optional "target", "clock_floor",
+ * "clock_margin" and gains): the setpoint follows the learned temperature
+ * where boost bins start to drop. A bin is NVFD_CLOCK_BIN_MHZ; the knee
+ * moves NVFD_CLOCK_KNEE_STEP °C per sample. Clocks held within a bin of
+ * a lower level for NVFD_CLOCK_PLATEAU_SAMPLES busy samples in a row, with
+ * no thermal slowdown, make that level the new peak and re-prime. */
+#define NVFD_CLOCK_FLOOR_SPAN      15   /* default floor: target - this */
+#define NVFD_CLOCK_MARGIN_DEFAULT   2
+#define NVFD_CLOCK_MARGIN_MAX      10
+#define NVFD_CLOCK_BIN_MHZ         15
+#define NVFD_CLOCK_KNEE_STEP     0.25
+#define NVFD_CLOCK_BUSY_UTIL       50   /* % */
+#define NVFD_CLOCK_PLATEAU_SAMPLES 120
+
+/* Efficiency mode ("mode": "efficiency", optional "target" as the most
+ * it lets the GPU reach, "fan_watts", "eff_step", "eff_dwell_s"). A dwell
+ * whose utilization spans more than NVFD_EFF_UTIL_BAND % is not judged. */
+#define NVFD_EFF_FAN_WATTS_DEFAULT  3.0   /* per fan at 100 % */
+#define NVFD_EFF_FAN_WATTS_MAX     50.0
+#define NVFD_EFF_STEP_DEFAULT        5
+#define NVFD_EFF_STEP_MAX           20
+#define NVFD_EFF_DWELL_S_DEFAULT   60.0
+#define NVFD_EFF_DWELL_S_MIN       10.0
+#define NVFD_EFF_DWELL_S_MAX      600.0
+#define NVFD_EFF_UTIL_BAND          10
+
+/* Thermal governor ("gov_temp", "gov_step", "gov_floor", "gov_interval_s",
+ * "gov_hysteresis"): off unless gov_temp is set. Steps and floor are % of
+ * the power limit the GPU had when nvfd started. */
+#define NVFD_GOV_STEP_DEFAULT        5
+#define NVFD_GOV_FLOOR_DEFAULT      60
+#define NVFD_GOV_INTERVAL_S_DEFAULT 5.0
+#define NVFD_GOV_HYSTERESIS_DEFAULT  3
+
+/* Airflow zones ("zones" in "daemon"): a member's reading older than this
+ * no longer counts towards its zone */
+#define NVFD_ZONE_STALE_S        10.0
+
+/* Node fan budget ("fan_budget" in "daemon", sum of fan %, 0 = off): a
+ * GPU's demand older than this no longer counts against it */
+#define NVFD_BUDGET_STALE_S      10.0
+
+/* NVML calls run on per-GPU worker threads. A GPU whose call has not
+ * returned within the timeout is quarantined and probed with backoff. */
+#define NVFD_NVML_TIMEOUT_MS     2000
+#define NVFD_QUARANTINE_MIN_S       5
+#define NVFD_QUARANTINE_MAX_S     300
+#define NVFD_SHUTDOWN_GRACE_MS   3000
+
+/* GPU health: failed readings in a row before a GPU is degraded, the
+ * re-probe backoff for a lost one, and how often the daemon checks
+ * whether GPUs were added or removed. Re-initializing a failed library
+ * backs off over the same range. */
+#define NVFD_HEALTH_DEGRADED_AFTER  3
+#define NVFD_HEALTH_RETRY_MIN_S   5.0
+#define NVFD_HEALTH_RETRY_MAX_S 300.0
+#define NVFD_RESCAN_S            60.0
+
+/* NVML events (clock changes, Xid errors, power source changes) wake a
+ * GPU at once. The waiter blocks at most NVFD_EVENT_WAIT_MS per call so
+ * it notices shutdown. A GPU whose clock events are registered is woken
+ * by throttling, so its steady poll interval may stretch to
+ * NVFD_EVENT_POLL_STRETCH times poll_max_ms. */
+#define NVFD_EVENT_WAIT_MS        500
+#define NVFD_EVENT_POLL_STRETCH   2.0
+
+/* Real-time options ("sched", "sched_priority", "cpus", "lock_memory" in
+ * "daemon"), applied once at startup. With lock_memory this much of the
+ * main stack is touched up front so the loop never faults growing it. */
+#define NVFD_RT_PRIORITY_DEFAULT   10
+#define NVFD_RT_CPUS_MAX          128
+#define NVFD_RT_STACK_PREFAULT  (256 * 1024)
+
+/* Stack for each worker and the event waiter. They only make NVML calls
+ * and scan /proc; glibc's default of 8 MiB per thread would all be locked
+ * with lock_memory. */
+#define NVFD_THREAD_STACK        (64 * 1024)
 
 typedef struct {
     int temperature;
     int fan_speed;
 } FanCurvePoint;
 
+/* How a curve fills in between its points */
+typedef enum {
+    CURVE_LINEAR,
+    CURVE_MONOTONE_CUBIC,   /* smooth, never overshoots the points */
+    CURVE_STEP              /* each point's speed until the next point */
+} CurveInterpolation;
+
+/* Temperature sources NVML exposes per device */
+typedef enum {
+    SENSOR_CORE = 0,
+    SENSOR_MEM,             /* memory junction (GDDR6X, HBM) */
+    SENSOR_COUNT
+} SensorId;
+
+#define SENSOR_TERMS_MAX 4
+
+/* What a curve or controller reads: the highest of its terms, each a
+ * sensor plus an offset, e.g. max(core, mem-10). No terms = the default. */
+typedef struct {
+    int count;
+    struct {
+        SensorId sensor;
+        int      offset;   /* °C */
+    } terms[SENSOR_TERMS_MAX];
+} SensorExpr;
+
 typedef struct {
-    FanCurvePoint points[MAX_CURVE_POINTS];
+    FanCurvePoint *points;   /* sorted by temperature, grown on demand */
     int point_count;
+    int capacity;
+    int    hysteresis;       /* °C the temperature must fall before slowing */
+    double hold_s;           /* no slowing down this long after a rise */
+    CurveInterpolation interpolation;
+    SensorExpr sensor;       /* input, no terms = the GPU's */
 } FanCurve;
 
 extern unsigned int device_count;
 extern volatile sig_atomic_t keep_running;
-extern volatile sig_atomic_t reload_config;
 
 #endif /* NVFD_H */
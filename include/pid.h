@@ -0,0 +1,30 @@
+#ifndef NVFD_PID_H
+#define NVFD_PID_H
+
+/* Gains map °C above the target to fan percent */
+typedef struct {
+    double kp;   /* % per °C */
+    double ki;   /* % per °C per second */
+    double kd;   /* % per °C/s, applied to the measurement */
+} PidGains;
+
+typedef struct {
+    int    active;      /* 0 = next update starts fresh */
+    double integral;    /* I-term contribution, fan percent */
+    double step;        /* what the last update added to integral */
+    double prev_temp;
+} PidState;
+
+void pid_reset(PidState *pid);
+
+/* Returns a fan speed within [out_min, out_max]. The first update after a
+ * reset starts from `initial` so switching modes does not jolt the fans. */
+int  pid_update(PidState *pid, const PidGains *gains, int target, int temp,
+                double dt, int out_min, int out_max, int initial);
+/* Tells the PID what a later stage (the slew limit) applied instead of
+ * what it asked for. Held back in the direction the integral just moved,
+ * that step is taken back, so it does not wind up against a limit it
+ * cannot see. */
+void pid_track(PidState *pid, int asked, int applied);
+
+#endif /* NVFD_PID_H */
@@ -0,0 +1,52 @@
+#ifndef NVFD_PROC_H
+#define NVFD_PROC_H
+
+#include <stddef.h>
+
+/* Processes running on a GPU, as seen by the process rules. The kernel's
+ * process name (/proc/<pid>/comm) is at most 15 characters. */
+#define PROC_LIST_MAX    64
+#define PROC_COMM_MAX    16
+#define PROC_CGROUP_MAX 256
+
+typedef struct {
+    unsigned int pid;
+    char         comm[PROC_COMM_MAX];
+    size_t       comm_len;
+    char         cgroup[PROC_CGROUP_MAX];   /* unified hierarchy path */
+    size_t       cgroup_len;
+} ProcInfo;
+
+typedef struct {
+    int          ok;        /* NVML answered; otherwise keep the last verdict */
+    ProcInfo     procs[PROC_LIST_MAX];
+    unsigned int count;
+} ProcessList;
+
+/* How a glob is matched, decided once when the configuration is loaded:
+ * most patterns are a plain compare, only the rest go through fnmatch() */
+typedef enum {
+    PROC_MATCH_ANY = 0,
+    PROC_MATCH_EXACT,
+    PROC_MATCH_PREFIX,      /* "name*" */
+    PROC_MATCH_SUFFIX,      /* "*name" */
+    PROC_MATCH_CONTAINS,    /* "*name*" */
+    PROC_MATCH_GLOB
+} ProcMatchKind;
+
+typedef struct {
+    ProcMatchKind kind;
+    char         *text;     /* the pattern as written, NULL = any */
+    const char   *core;     /* text without the stripped '*' */
+    size_t        len;
+} ProcPattern;
+
+/* NULL glob compiles to "match anything" */
+int  proc_pattern_compile(ProcPattern *p, const char *glob);
+void proc_pattern_free(ProcPattern *p);
+int  proc_pattern_match(const ProcPattern *p, const char *s, size_t len);
+
+/* Fills in name and, if cgroup is set, cgroup path; -1 if the process is gone */
+int  proc_read(unsigned int pid, int cgroup, ProcInfo *out);
+
+#endif /* NVFD_PROC_H */
@@ -0,0 +1,35 @@
+#ifndef NVFD_REALTIME_H
+#define NVFD_REALTIME_H
+
+#include "nvfd.h"
+
+/* Keeps the control loop on time on a loaded node: a real-time scheduling
+ * policy, housekeeping CPUs to run on and memory locked against paging.
+ * The main thread applies them once, before the workers and the event
+ * waiter start, so those threads inherit them. Isolated and nohz_full
+ * CPUs are always left out, configured or not. */
+
+typedef enum {
+    RT_SCHED_INHERIT = 0,   /* whatever the daemon was started with */
+    RT_SCHED_OTHER,
+    RT_SCHED_FIFO,
+    RT_SCHED_RR
+} RtSched;
+
+typedef struct {
+    RtSched sched;
+    int     priority;               /* 1-99, fifo and rr only */
+    char    cpus[NVFD_RT_CPUS_MAX]; /* CPU list like "0-1,8", "" = any */
+    int     lock_memory;
+} RealtimeParams;
+
+void rt_defaults(RealtimeParams *p);
+int  rt_parse_sched(const char *str, RtSched *sched);
+const char *rt_sched_name(RtSched sched);
+/* 0 if list is a CPU list like "0-3,8" */
+int  rt_valid_cpus(const char *list);
+int  rt_equal(const RealtimeParams *a, const RealtimeParams *b);
+/* Logs what it did and what it could not do; never fatal */
+void rt_apply(const RealtimeParams *p);
+
+#endif /* NVFD_REALTIME_H */
@@ -0,0 +1,20 @@
+#ifndef NVFD_SENSOR_H
+#define NVFD_SENSOR_H
+
+#include <stddef.h>
+#include "nvfd.h"
+
+/* Offsets in an expression are limited to +-SENSOR_OFFSET_MAX °C */
+#define SENSOR_OFFSET_MAX 50
+
+/* "core", "mem", "mem-10", "max(core, mem-10)"; -1 if invalid */
+int  sensor_parse(const char *text, SensorExpr *out);
+void sensor_format(const SensorExpr *expr, char *buf, size_t len);
+const char *sensor_name(SensorId sensor);
+
+/* Bit (1 << SensorId) for each sensor expr reads; no terms reads the core */
+unsigned int sensor_mask(const SensorExpr *expr);
+/* temps[] is indexed by SensorId, -1 = no reading; -1 if no term has one */
+int  sensor_eval(const SensorExpr *expr, const int *temps);
+
+#endif /* NVFD_SENSOR_H */
@@ -0,0 +1,51 @@
+#ifndef NVFD_SMOOTH_H
+#define NVFD_SMOOTH_H
+
+/* Shaping around the control law: a temperature filter in front of the
+ * curve/PID, and a slew-rate limit on the fan speed after it. */
+
+#define SMOOTH_WINDOW_MAX 9
+
+typedef enum {
+    FILTER_NONE = 0,
+    FILTER_EMA,
+    FILTER_MEDIAN
+} FilterKind;
+
+typedef struct {
+    FilterKind kind;
+    double     tau_s;          /* EMA time constant */
+    int        window;         /* median-of-N samples */
+    double     slew_up;        /* max fan %/s increase, 0 = unlimited */
+    double     slew_down;      /* max fan %/s decrease, 0 = unlimited */
+    int        critical_temp;  /* at or above: bypass filter and slew */
+} SmoothParams;
+
+typedef struct {
+    int    primed;
+    double value;
+    int    samples[SMOOTH_WINDOW_MAX];
+    int    count;
+    int    pos;
+} TempFilter;
+
+typedef struct {
+    int    primed;
+    double output;   /* fan percent, fractional between steps */
+} SlewLimiter;
+
+void smooth_defaults(SmoothParams *p);
+int  smooth_parse_filter(const char *str, FilterKind *kind);
+
+void temp_filter_reset(TempFilter *f);
+/* Returns the filtered temperature, rounded to whole degrees */
+int  temp_filter_update(TempFilter *f, const SmoothParams *p, int temp, double dt);
+
+void slew_reset(SlewLimiter *s);
+/* Moves towards target by at most the configured rate over dt seconds;
+ * bypass jumps straight to it */
+int  slew_update(SlewLimiter *s, const SmoothParams *p, int target, double dt,
+                 int bypass);
+int  slew_settled(const SlewLimiter *s, int target);
+
+#endif /* NVFD_SMOOTH_H */
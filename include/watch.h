@@ -0,0 +1,12 @@
+#ifndef NVFD_WATCH_H
+#define NVFD_WATCH_H
+
+/* Bits returned by watch_read() */
+#define WATCH_CONFIG   0x1
+#define WATCH_CURVE    0x2
+#define WATCH_PROFILES 0x4
+
+int watch_open(void);
+int watch_read(int fd);
+
+#endif /* NVFD_WATCH_H */
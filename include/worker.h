@@ -0,0 +1,78 @@
+#ifndef NVFD_WORKER_H
+#define NVFD_WORKER_H
+
+#include "fan.h"
+#include "gpu.h"
+#include "proc.h"
+
+/* One thread per GPU runs that GPU's NVML calls, so a device stuck in the
+ * driver only stalls its own worker. Control logic stays on the caller's
+ * thread: it submits a job, then collects the result once the pool's
+ * eventfd becomes readable. */
+
+typedef enum {
+    WORK_SAMPLE,   /* read the core temperature and throttle reasons, plus
+                    * other sensors, load and SM clock if asked */
+    WORK_WRITE,    /* fan_command_gpu_speed() */
+    WORK_RESET,    /* return fans to driver control */
+    WORK_PROCESSES,/* only the process scan below */
+    WORK_PROBE     /* gpu_reprobe() a lost GPU; fan state reset if back */
+} WorkKind;
+
+typedef struct {
+    WorkKind      kind;
+    int           load;       /* WORK_SAMPLE: also read power and utilization */
+    int           clocks;     /* WORK_SAMPLE: also read the SM clock */
+    unsigned int  sensors;    /* WORK_SAMPLE: sensor_mask() to read */
+    /* WORK_WRITE input; speeds (one per fan) and fans are owned by the
+     * worker until collected */
+    const unsigned int *speeds;
+    unsigned int  deadband;
+    unsigned int  reassert_s;
+    double        now;
+    FanState     *fans;
+    /* WORK_WRITE and WORK_RESET: power limit to set first, mW, 0 = leave */
+    int           power_set;
+    /* Any kind: also list the GPU's processes into procs, owned by the
+     * worker until collected */
+    ProcessList  *procs;
+    int           cgroups;    /* read each process's cgroup too */
+    /* Results */
+    int           temps[SENSOR_COUNT];  /* °C, -1 = no reading */
+    int           power;        /* mW, -1 = unavailable */
+    int           power_limit;  /* mW */
+    int           util;         /* %, -1 = unavailable */
+    int           sm_clock;     /* MHz, -1 = unavailable */
+    int           reasons_ok;
+    unsigned long long reasons; /* nvmlClocksThrottleReason* */
+    int           failures;
+    int           status;       /* nvmlReturn_t of the core reading or probe */
+    int           probe;        /* WORK_PROBE: gpu_reprobe() result */
+    GpuDevice     probed;       /* WORK_PROBE: for gpu_adopt() if probe is 0 */
+    int           power_ok;     /* power_set was accepted */
+    FanWriteStats stats;
+} WorkerJob;
+
+typedef struct WorkerPool WorkerPool;
+
+WorkerPool *worker_pool_create(unsigned int count);
+/* Leaks the pool and returns -1 instead of blocking if a worker is still
+ * inside NVML */
+int  worker_pool_destroy(WorkerPool *pool);
+
+/* Readable whenever at least one job has finished */
+int  worker_pool_fd(const WorkerPool *pool);
+void worker_pool_drain_fd(WorkerPool *pool);
+
+/* -1 while the GPU's previous job has not been collected */
+int  worker_submit(WorkerPool *pool, unsigned int gpu_index, const WorkerJob *job,
+                   double now);
+/* 1 and the finished job in *out, 0 if nothing is ready */
+int  worker_collect(WorkerPool *pool, unsigned int gpu_index, WorkerJob *out);
+/* 1 with the submit time in *since while a job is still running */
+int  worker_busy(WorkerPool *pool, unsigned int gpu_index, double *since);
+
+/* Blocks until the GPU's job finishes (result discarded) or deadline passes */
+int  worker_wait(WorkerPool *pool, unsigned int gpu_index, double deadline);
+
+#endif /* NVFD_WORKER_H */
@@ -0,0 +1,39 @@
+#ifndef NVFD_ZONE_H
+#define NVFD_ZONE_H
+
+#include "nvfd.h"
+
+/* Airflow zones: GPUs that share air are driven from one temperature, so
+ * the card upstream spins up for the one breathing its exhaust. Each
+ * member's reading is shifted by its offset, then the zone takes the
+ * hottest, or the weighted mean, and every member's policy follows it. */
+
+#define ZONE_MEMBERS_MAX 16
+
+typedef enum {
+    ZONE_MAX = 0,
+    ZONE_WEIGHTED
+} ZoneCombine;
+
+typedef struct {
+    char   key[NVML_DEVICE_UUID_V2_BUFFER_SIZE];  /* UUID or legacy "gpuN" */
+    int    gpu;       /* resolved index, -1 = not installed */
+    double weight;    /* weighted zones only */
+    int    offset;    /* °C added to the member's reading */
+} ZoneMember;
+
+typedef struct {
+    char        name[NVFD_PROFILE_NAME_MAX];
+    ZoneCombine combine;
+    ZoneMember  members[ZONE_MEMBERS_MAX];
+    int         member_count;
+} Zone;
+
+/* "max", "weighted" */
+int  zone_parse_combine(const char *name, ZoneCombine *combine);
+const char *zone_combine_name(ZoneCombine combine);
+
+/* temps[] has one reading per member, -1 = none; -1 if no member has one */
+int  zone_combine(const Zone *zone, const int *temps);
+
+#endif /* NVFD_ZONE_H */
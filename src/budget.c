@@ -0,0 +1,34 @@
+#include <stddef.h>
+#include "budget.h"
+
+void budget_allocate(BudgetDemand *d, unsigned int count, int budget) {
+    int left = budget;
+    for (unsigned int i = 0; i < count; i++) {
+        d[i].grant = -1;
+        left -= d[i].floor;
+    }
+
+    for (;;) {
+        BudgetDemand *next = NULL;
+        for (unsigned int i = 0; i < count; i++) {
+            if (d[i].grant < 0 && (!next || d[i].headroom < next->headroom))
+                next = &d[i];
+        }
+        if (!next)
+            break;
+
+        int extra = next->want - next->floor;
+        if (extra > left)
+            extra = left > 0 ? left : 0;
+        next->grant = next->floor + extra;
+        left -= extra;
+    }
+}
+
+int budget_share(const BudgetDemand *d, int wanted, int fan_floor) {
+    if (wanted <= fan_floor || d->grant >= d->want)
+        return wanted;
+    long long extra = (long long)(wanted - fan_floor) * (d->grant - d->floor) /
+                      (d->want - d->floor);
+    return fan_floor + (int)extra;
+}
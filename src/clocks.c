@@ -0,0 +1,85 @@
+#include <nvml.h>
+#include "clocks.h"
+#include "nvfd.h"
+
+int clock_thermal(unsigned long long reasons) {
+    return (reasons & (nvmlClocksThrottleReasonSwThermalSlowdown |
+                       nvmlClocksThrottleReasonHwThermalSlowdown)) != 0;
+}
+
+int clock_power(unsigned long long reasons) {
+    return (reasons & (nvmlClocksThrottleReasonSwPowerCap |
+                       nvmlClocksThrottleReasonHwPowerBrakeSlowdown)) != 0;
+}
+
+void clock_defaults(ClockParams *p, int target) {
+    p->floor = target - NVFD_CLOCK_FLOOR_SPAN;
+    if (p->floor < NVFD_TARGET_MIN)
+        p->floor = NVFD_TARGET_MIN;
+    p->margin = NVFD_CLOCK_MARGIN_DEFAULT;
+}
+
+void clock_reset(ClockLearner *c) {
+    c->primed = 0;
+    c->knee = 0.0;
+    c->peak_mhz = 0;
+    c->plateau_mhz = 0;
+    c->plateau_count = 0;
+}
+
+/* 1 once mhz has stayed within a bin of one level long enough */
+static int plateau_held(ClockLearner *c, unsigned int mhz) {
+    unsigned int gap = mhz > c->plateau_mhz ? mhz - c->plateau_mhz : c->plateau_mhz - mhz;
+    if (c->plateau_count > 0 && gap <= NVFD_CLOCK_BIN_MHZ) {
+        c->plateau_count++;
+    } else {
+        c->plateau_mhz = mhz;
+        c->plateau_count = 1;
+    }
+    return c->plateau_count >= NVFD_CLOCK_PLATEAU_SAMPLES;
+}
+
+int clock_update(ClockLearner *c, const ClockParams *p, int target, int temp,
+                 int sm_mhz, unsigned long long reasons, int util) {
+    double lo = p->floor + p->margin;
+    double hi = target + p->margin;
+
+    /* Until it learns otherwise, assume the GPU keeps its clocks to target */
+    if (!c->primed) {
+        c->knee = hi;
+        c->primed = 1;
+    }
+
+    /* Only a busy GPU that is not held back by its power limit says
+     * anything about temperature */
+    int busy = !(reasons & nvmlClocksThrottleReasonGpuIdle) &&
+               (util < 0 || util >= NVFD_CLOCK_BUSY_UTIL);
+    if (busy && !clock_power(reasons) && sm_mhz > 0) {
+        unsigned int mhz = (unsigned int)sm_mhz;
+        if (mhz > c->peak_mhz)
+            c->peak_mhz = mhz;
+        int below = mhz + NVFD_CLOCK_BIN_MHZ < c->peak_mhz;
+        int lost = clock_thermal(reasons) || below;
+
+        /* By now the knee has been walked down to the floor without the
+         * clocks coming back: the peak is stale, not the temperature */
+        if (!below || clock_thermal(reasons)) {
+            c->plateau_count = 0;
+        } else if (plateau_held(c, mhz)) {
+            c->peak_mhz = mhz;
+            c->knee = hi;
+            c->plateau_count = 0;
+            lost = 0;
+        }
+        if (lost && temp <= c->knee)
+            c->knee -= NVFD_CLOCK_KNEE_STEP;
+        else if (!lost && temp > c->knee)
+            c->knee += NVFD_CLOCK_KNEE_STEP;
+    }
+    if (c->knee < lo)
+        c->knee = lo;
+    if (c->knee > hi)
+        c->knee = hi;
+
+    return (int)(c->knee - p->margin + 0.5);
+}
@@ -1,9 +1,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
 #include <sys/stat.h>
 #include <errno.h>
 #include "config.h"
+#include "control.h"
+#include "curve.h"
+#include "gpu.h"
+#include "sensor.h"
+
+/* File named in parse errors; profiles share the policy parser */
+static const char *parse_file = NVFD_CONFIG_FILE;
 
 int config_ensure_dir(void) {
     struct stat st;
@@ -24,28 +32,350 @@ json_t *config_read(void) {
     return root;
 }
 
-int config_write_gpu(const char *gpu_key, const char *mode, int speed) {
-    config_ensure_dir();
+/* Optional integer setting: absent keeps def, wrong type or range fails */
+static int read_int(const json_t *obj, const char *key, int def, int min, int max,
+                    int *out, const char *ctx) {
+    json_t *value = json_object_get(obj, key);
+    if (!value) {
+        *out = def;
+        return 0;
+    }
 
-    json_error_t error;
-    json_t *root = json_load_file(NVFD_CONFIG_FILE, 0, &error);
-    if (!root)
-        root = json_object();
+    json_int_t v = json_integer_value(value);
+    if (!json_is_integer(value) || v < min || v > max) {
+        fprintf(stderr, "%s: %s.%s must be an integer %d-%d\n",
+                parse_file, ctx, key, min, max);
+        return -1;
+    }
+    *out = (int)v;
+    return 0;
+}
 
-    json_t *gpu_config = json_object();
-    json_object_set_new(gpu_config, "mode", json_string(mode));
-    if (strcmp(mode, "manual") == 0)
-        json_object_set_new(gpu_config, "speed", json_integer(speed));
+static int read_double(const json_t *obj, const char *key, double def,
+                       double min, double max, double *out, const char *ctx) {
+    json_t *value = json_object_get(obj, key);
+    if (!value) {
+        *out = def;
+        return 0;
+    }
+
+    double v = json_number_value(value);
+    if (!json_is_number(value) || v < min || v > max) {
+        fprintf(stderr, "%s: %s.%s must be a number %g-%g\n",
+                parse_file, ctx, key, min, max);
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static int read_gains(const json_t *obj, PidGains *gains, const char *ctx) {
+    return read_double(obj, "kp", NVFD_PID_KP_DEFAULT, 0.0, NVFD_PID_GAIN_MAX,
+                       &gains->kp, ctx) != 0 ||
+           read_double(obj, "ki", NVFD_PID_KI_DEFAULT, 0.0, NVFD_PID_GAIN_MAX,
+                       &gains->ki, ctx) != 0 ||
+           read_double(obj, "kd", NVFD_PID_KD_DEFAULT, 0.0, NVFD_PID_GAIN_MAX,
+                       &gains->kd, ctx) != 0 ? -1 : 0;
+}
+
+static int read_poll_range(const json_t *obj, int def_min, int def_max,
+                           int *poll_min, int *poll_max, const char *ctx) {
+    if (read_int(obj, "poll_min_ms", def_min, NVFD_POLL_MS_LOWER,
+                 NVFD_POLL_MS_UPPER, poll_min, ctx) != 0 ||
+        read_int(obj, "poll_max_ms", def_max, NVFD_POLL_MS_LOWER,
+                 NVFD_POLL_MS_UPPER, poll_max, ctx) != 0)
+        return -1;
+    if (*poll_min > *poll_max) {
+        fprintf(stderr, "%s: %s: poll_min_ms is greater than poll_max_ms\n",
+                parse_file, ctx);
+        return -1;
+    }
+    return 0;
+}
+
+/* Filter and slew settings; absent keys inherit from def */
+static int read_smooth(const json_t *obj, const SmoothParams *def, SmoothParams *out,
+                       const char *ctx) {
+    *out = *def;
+
+    json_t *filter = json_object_get(obj, "filter");
+    if (filter && (!json_is_string(filter) ||
+                   smooth_parse_filter(json_string_value(filter), &out->kind) != 0)) {
+        fprintf(stderr, "%s: %s.filter must be \"none\", \"ema\" or \"median\"\n",
+                parse_file, ctx);
+        return -1;
+    }
+
+    if (read_double(obj, "filter_tau_s", def->tau_s, 0.0, 60.0, &out->tau_s, ctx) != 0 ||
+        read_int(obj, "filter_window", def->window, 1, SMOOTH_WINDOW_MAX,
+                 &out->window, ctx) != 0 ||
+        read_double(obj, "slew_up", def->slew_up, 0.0, NVFD_SLEW_MAX,
+                    &out->slew_up, ctx) != 0 ||
+        read_double(obj, "slew_down", def->slew_down, 0.0, NVFD_SLEW_MAX,
+                    &out->slew_down, ctx) != 0 ||
+        read_int(obj, "critical_temp", def->critical_temp, NVFD_TARGET_MIN, 150,
+                 &out->critical_temp, ctx) != 0)
+        return -1;
+    return 0;
+}
+
+static int read_feedforward(const json_t *obj, const FeedForwardParams *def,
+                            FeedForwardParams *out, const char *ctx) {
+    if (read_double(obj, "ff_power_gain", def->power_gain, 0.0, NVFD_FF_GAIN_MAX,
+                    &out->power_gain, ctx) != 0 ||
+        read_double(obj, "ff_util_gain", def->util_gain, 0.0, NVFD_FF_GAIN_MAX,
+                    &out->util_gain, ctx) != 0 ||
+        read_double(obj, "ff_tau_s", def->tau_s, 0.0, 600.0, &out->tau_s, ctx) != 0 ||
+        read_double(obj, "ff_max", def->max, 0.0, 100.0, &out->max, ctx) != 0)
+        return -1;
+    return 0;
+}
+
+static int read_governor(const json_t *obj, const GovernorParams *def,
+                         GovernorParams *out, const char *ctx) {
+    if (read_int(obj, "gov_temp", def->temp, 0, 150, &out->temp, ctx) != 0 ||
+        read_int(obj, "gov_step", def->step, 1, 50, &out->step, ctx) != 0 ||
+        read_int(obj, "gov_floor", def->floor, 10, 100, &out->floor, ctx) != 0 ||
+        read_double(obj, "gov_interval_s", def->interval_s, 1.0, 600.0,
+                    &out->interval_s, ctx) != 0 ||
+        read_int(obj, "gov_hysteresis", def->hysteresis, 0, 20, &out->hysteresis,
+                 ctx) != 0)
+        return -1;
+    return 0;
+}
+
+/* A process name pattern longer than the kernel keeps could never match */
+static int comm_pattern_fits(const ProcPattern *p) {
+    return p->kind == PROC_MATCH_GLOB || p->len < PROC_COMM_MAX;
+}
+
+static int parse_rule(const json_t *obj, int index, ProcessRule *rule) {
+    json_t *process = json_object_get(obj, "process");
+    json_t *cgroup = json_object_get(obj, "cgroup");
+    json_t *profile = json_object_get(obj, "profile");
+
+    if (!json_is_object(obj) || (process && !json_is_string(process)) ||
+        (cgroup && !json_is_string(cgroup)) || (!process && !cgroup)) {
+        fprintf(stderr, "%s: daemon.rules[%d] needs a \"process\" or \"cgroup\" "
+                "pattern\n", NVFD_CONFIG_FILE, index);
+        return -1;
+    }
+    if (!json_is_string(profile) || !config_valid_profile_name(json_string_value(profile))) {
+        fprintf(stderr, "%s: daemon.rules[%d].profile must name a profile\n",
+                NVFD_CONFIG_FILE, index);
+        return -1;
+    }
+    snprintf(rule->name, sizeof(rule->name), "%s", json_string_value(profile));
+
+    if (proc_pattern_compile(&rule->process, json_string_value(process)) != 0 ||
+        proc_pattern_compile(&rule->cgroup, json_string_value(cgroup)) != 0)
+        return -1;
+    if (!comm_pattern_fits(&rule->process)) {
+        fprintf(stderr, "%s: daemon.rules[%d].process: process names are at most "
+                "%d characters\n", NVFD_CONFIG_FILE, index, PROC_COMM_MAX - 1);
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_rules(const json_t *daemon, ConfigSnapshot *snap) {
+    json_t *rules = json_object_get(daemon, "rules");
+    if (!rules)
+        return 0;
+    if (!json_is_array(rules)) {
+        fprintf(stderr, "%s: daemon.rules must be an array\n", NVFD_CONFIG_FILE);
+        return -1;
+    }
+
+    size_t n = json_array_size(rules);
+    if (n == 0)
+        return 0;
+    snap->rules = calloc(n, sizeof(*snap->rules));
+    if (!snap->rules)
+        return -1;
+    for (size_t i = 0; i < n; i++) {
+        ProcessRule *rule = &snap->rules[i];
+        snap->rule_count++;
+        if (parse_rule(json_array_get(rules, i), (int)i, rule) != 0)
+            return -1;
+        if (rule->cgroup.text)
+            snap->rule_cgroups = 1;
+    }
+    return 0;
+}
+
+/* A member is a GPU key, or an object with "gpu" and optional "weight"
+ * and "offset" */
+static int parse_member(const json_t *obj, const char *ctx, ZoneMember *member) {
+    json_t *gpu = json_is_object(obj) ? json_object_get(obj, "gpu") : (json_t *)obj;
+    const char *key = json_string_value(gpu);
+    if (!key || strlen(key) >= sizeof(member->key)) {
+        fprintf(stderr, "%s: %s: members must be GPU UUIDs or objects with "
+                "\"gpu\"\n", NVFD_CONFIG_FILE, ctx);
+        return -1;
+    }
+    strcpy(member->key, key);
+    member->gpu = -1;
+    member->weight = 1.0;
+    member->offset = 0;
+    if (!json_is_object(obj))
+        return 0;
+    return read_double(obj, "weight", 1.0, 0.01, 100.0, &member->weight, ctx) != 0 ||
+           read_int(obj, "offset", 0, -50, 50, &member->offset, ctx) != 0 ? -1 : 0;
+}
+
+static int parse_zone(const json_t *obj, int index, Zone *zone) {
+    char ctx[32];
+    snprintf(ctx, sizeof(ctx), "daemon.zones[%d]", index);
+
+    const char *name = json_string_value(json_object_get(obj, "name"));
+    json_t *members = json_object_get(obj, "members");
+    if (!json_is_object(obj) || !name || !config_valid_profile_name(name) ||
+        !json_is_array(members) || json_array_size(members) == 0) {
+        fprintf(stderr, "%s: %s needs a \"name\" and a list of \"members\"\n",
+                NVFD_CONFIG_FILE, ctx);
+        return -1;
+    }
+    snprintf(zone->name, sizeof(zone->name), "%s", name);
+
+    json_t *combine = json_object_get(obj, "combine");
+    if (combine && zone_parse_combine(json_string_value(combine), &zone->combine) != 0) {
+        fprintf(stderr, "%s: %s.combine must be \"max\" or \"weighted\"\n",
+                NVFD_CONFIG_FILE, ctx);
+        return -1;
+    }
 
-    json_object_set_new(root, gpu_key, gpu_config);
+    if (json_array_size(members) > ZONE_MEMBERS_MAX) {
+        fprintf(stderr, "%s: %s: at most %d members\n", NVFD_CONFIG_FILE, ctx,
+                ZONE_MEMBERS_MAX);
+        return -1;
+    }
+    for (size_t m = 0; m < json_array_size(members); m++) {
+        if (parse_member(json_array_get(members, m), ctx,
+                         &zone->members[zone->member_count]) != 0)
+            return -1;
+        zone->member_count++;
+    }
+    return 0;
+}
+
+static int parse_zones(const json_t *daemon, ConfigSnapshot *snap) {
+    json_t *zones = json_object_get(daemon, "zones");
+    if (!zones)
+        return 0;
+    if (!json_is_array(zones)) {
+        fprintf(stderr, "%s: daemon.zones must be an array\n", NVFD_CONFIG_FILE);
+        return -1;
+    }
 
+    size_t n = json_array_size(zones);
+    if (n == 0)
+        return 0;
+    snap->zones = calloc(n, sizeof(*snap->zones));
+    if (!snap->zones)
+        return -1;
+    for (size_t i = 0; i < n; i++) {
+        snap->zone_count++;
+        if (parse_zone(json_array_get(zones, i), (int)i, &snap->zones[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Scheduling, CPUs and memory locking for the daemon itself */
+static int read_realtime(const json_t *obj, RealtimeParams *out) {
+    rt_defaults(out);
+
+    json_t *sched = json_object_get(obj, "sched");
+    if (sched && rt_parse_sched(json_string_value(sched), &out->sched) != 0) {
+        fprintf(stderr, "%s: daemon.sched must be \"other\", \"fifo\" or \"rr\"\n",
+                NVFD_CONFIG_FILE);
+        return -1;
+    }
+    if (read_int(obj, "sched_priority", NVFD_RT_PRIORITY_DEFAULT, 1, 99,
+                 &out->priority, "daemon") != 0)
+        return -1;
+
+    json_t *cpus = json_object_get(obj, "cpus");
+    const char *list = json_string_value(cpus);
+    if (cpus && (!list || strlen(list) >= sizeof(out->cpus) || rt_valid_cpus(list) != 0)) {
+        fprintf(stderr, "%s: daemon.cpus must be a CPU list like \"0-1,8\"\n",
+                NVFD_CONFIG_FILE);
+        return -1;
+    }
+    if (list)
+        snprintf(out->cpus, sizeof(out->cpus), "%s", list);
+
+    json_t *lock = json_object_get(obj, "lock_memory");
+    if (lock && !json_is_boolean(lock)) {
+        fprintf(stderr, "%s: daemon.lock_memory must be true or false\n",
+                NVFD_CONFIG_FILE);
+        return -1;
+    }
+    out->lock_memory = json_is_true(lock);
+    return 0;
+}
+
+static int parse_daemon(const json_t *root, ConfigSnapshot *snap) {
+    json_t *daemon = json_object_get(root, "daemon");
+    if (daemon && !json_is_object(daemon)) {
+        fprintf(stderr, "%s: \"daemon\" must be an object\n", NVFD_CONFIG_FILE);
+        return -1;
+    }
+
+    if (read_poll_range(daemon, NVFD_POLL_MIN_MS_DEFAULT, NVFD_POLL_MAX_MS_DEFAULT,
+                        &snap->poll_min_ms, &snap->poll_max_ms, "daemon") != 0 ||
+        read_int(daemon, "deadband", NVFD_DEADBAND_DEFAULT, 0, 100,
+                 &snap->deadband, "daemon") != 0 ||
+        read_int(daemon, "reassert_s", NVFD_REASSERT_S_DEFAULT, 0, 3600,
+                 &snap->reassert_s, "daemon") != 0 ||
+        read_int(daemon, "fan_budget", 0, 0, 100 * 256, &snap->fan_budget,
+                 "daemon") != 0 ||
+        read_int(daemon, "rule_poll_s", NVFD_RULE_POLL_S_DEFAULT, 1, 3600,
+                 &snap->rule_poll_s, "daemon") != 0 ||
+        read_int(daemon, "rule_debounce_s", NVFD_RULE_DEBOUNCE_S_DEFAULT, 0, 3600,
+                 &snap->rule_debounce_s, "daemon") != 0 ||
+        read_realtime(daemon, &snap->realtime) != 0 ||
+        parse_rules(daemon, snap) != 0 || parse_zones(daemon, snap) != 0)
+        return -1;
+
+    SmoothParams smooth_default;
+    FeedForwardParams ff_default;
+    GovernorParams gov_default;
+    smooth_defaults(&smooth_default);
+    ff_defaults(&ff_default);
+    gov_defaults(&gov_default);
+    if (read_smooth(daemon, &smooth_default, &snap->smooth, "daemon") != 0 ||
+        read_feedforward(daemon, &ff_default, &snap->feedforward, "daemon") != 0 ||
+        read_governor(daemon, &gov_default, &snap->governor, "daemon") != 0)
+        return -1;
+    return 0;
+}
+
+/* Legacy index key ("gpu0"); policies are now stored under the UUID */
+static void legacy_key(unsigned int gpu_index, char *buf, size_t len) {
+    snprintf(buf, len, "gpu%u", gpu_index);
+}
+
+json_t *config_gpu_entry(const json_t *root, unsigned int gpu_index) {
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (dev && dev->uuid[0]) {
+        json_t *cfg = json_object_get(root, dev->uuid);
+        if (cfg)
+            return cfg;
+    }
+
+    char key[20];
+    legacy_key(gpu_index, key, sizeof(key));
+    return json_object_get(root, key);
+}
+
+static int write_root(json_t *root) {
     /* Atomic write */
     char tmp_path[256];
     snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", NVFD_CONFIG_FILE);
 
-    int ret = json_dump_file(root, tmp_path, JSON_INDENT(2));
-    json_decref(root);
-    if (ret != 0) {
+    if (json_dump_file(root, tmp_path, JSON_INDENT(2)) != 0) {
         remove(tmp_path);
         return -1;
     }
@@ -59,7 +389,81 @@ int config_write_gpu(const char *gpu_key, const char *mode, int speed) {
     return 0;
 }
 
-int config_migrate(void) {
+int config_write_gpu(unsigned int gpu_index, const char *mode, int value) {
+    config_ensure_dir();
+
+    /* A mode set by hand replaces any profile, in a running daemon too */
+    char err[256];
+    control_set_profile(NULL, (int)gpu_index, err, sizeof(err));
+
+    json_error_t error;
+    json_t *root = json_load_file(NVFD_CONFIG_FILE, 0, &error);
+    if (!root)
+        root = json_object();
+
+    char legacy[20];
+    legacy_key(gpu_index, legacy, sizeof(legacy));
+    const GpuDevice *dev = gpu_device(gpu_index);
+    const char *key = (dev && dev->uuid[0]) ? dev->uuid : legacy;
+
+    /* Keep any other per-GPU settings; only mode and its value change here */
+    json_t *gpu_config = json_object_get(root, key);
+    if (!json_is_object(gpu_config))
+        gpu_config = json_object_get(root, legacy);
+    if (json_is_object(gpu_config)) {
+        json_incref(gpu_config);
+    } else {
+        gpu_config = json_object();
+    }
+
+    json_object_set_new(gpu_config, "mode", json_string(mode));
+    json_object_del(gpu_config, "profile");
+    if (strcmp(mode, "manual") == 0)
+        json_object_set_new(gpu_config, "speed", json_integer(value));
+    else
+        json_object_del(gpu_config, "speed");
+    /* The target and gains stay put so switching back restores them */
+    if (strcmp(mode, "target") == 0)
+        json_object_set_new(gpu_config, "target", json_integer(value));
+
+    if (key != legacy)
+        json_object_del(root, legacy);
+    json_object_set_new(root, key, gpu_config);
+
+    int ret = write_root(root);
+    json_decref(root);
+    return ret;
+}
+
+/* Re-key "gpuN" entries by UUID so a reordered bus cannot swap policies */
+static void migrate_index_keys(void) {
+    json_error_t error;
+    json_t *root = json_load_file(NVFD_CONFIG_FILE, 0, &error);
+    if (!root)
+        return;
+
+    int changed = 0;
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        char key[20];
+        legacy_key(i, key, sizeof(key));
+        json_t *cfg = json_object_get(root, key);
+        if (!dev || !dev->uuid[0] || !cfg)
+            continue;
+
+        if (!json_object_get(root, dev->uuid))
+            json_object_set(root, dev->uuid, cfg);
+        json_object_del(root, key);
+        printf("Migrated config key: %s -> %s\n", key, dev->uuid);
+        changed = 1;
+    }
+
+    if (changed)
+        write_root(root);
+    json_decref(root);
+}
+
+static int migrate_legacy_files(void) {
     struct stat st;
 
     /* Migrate old curve file */
@@ -127,3 +531,539 @@ int config_migrate(void) {
 
     return 0;
 }
+
+int config_migrate(void) {
+    int ret = migrate_legacy_files();
+    migrate_index_keys();
+    return ret;
+}
+
+static double entry_gain(const json_t *entry, const char *key, double def) {
+    json_t *value = json_object_get(entry, key);
+    double v = json_number_value(value);
+    return json_is_number(value) && v >= 0.0 && v <= NVFD_PID_GAIN_MAX ? v : def;
+}
+
+void config_entry_target(const json_t *entry, int *target, PidGains *gains) {
+    json_t *value = json_object_get(entry, "target");
+    json_int_t t = json_integer_value(value);
+    *target = json_is_integer(value) && t >= NVFD_TARGET_MIN && t <= NVFD_TARGET_MAX
+              ? (int)t : NVFD_TARGET_DEFAULT;
+
+    gains->kp = entry_gain(entry, "kp", NVFD_PID_KP_DEFAULT);
+    gains->ki = entry_gain(entry, "ki", NVFD_PID_KI_DEFAULT);
+    gains->kd = entry_gain(entry, "kd", NVFD_PID_KD_DEFAULT);
+}
+
+int config_parse_mode(const char *str, FanMode *mode) {
+    if (!str || strcmp(str, "auto") == 0)
+        *mode = FAN_MODE_AUTO;
+    else if (strcmp(str, "manual") == 0)
+        *mode = FAN_MODE_MANUAL;
+    else if (strcmp(str, "curve") == 0)
+        *mode = FAN_MODE_CURVE;
+    else if (strcmp(str, "target") == 0)
+        *mode = FAN_MODE_TARGET;
+    else if (strcmp(str, "clocks") == 0)
+        *mode = FAN_MODE_CLOCKS;
+    else if (strcmp(str, "efficiency") == 0)
+        *mode = FAN_MODE_EFFICIENCY;
+    else
+        return -1;
+    return 0;
+}
+
+const char *config_mode_name(FanMode mode) {
+    switch (mode) {
+    case FAN_MODE_MANUAL: return "manual";
+    case FAN_MODE_CURVE:  return "curve";
+    case FAN_MODE_TARGET: return "target";
+    case FAN_MODE_CLOCKS: return "clocks";
+    case FAN_MODE_EFFICIENCY: return "efficiency";
+    default:              return "auto";
+    }
+}
+
+int config_valid_profile_name(const char *name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= NVFD_PROFILE_NAME_MAX || strcmp(name, "none") == 0)
+        return 0;
+    for (const char *c = name; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+              (*c >= '0' && *c <= '9') || *c == '_' || *c == '-'))
+            return 0;
+    }
+    return 1;
+}
+
+static int parse_policy(const char *key, json_t *cfg, const ConfigSnapshot *snap,
+                        GpuPolicy *policy) {
+    if (strlen(key) >= sizeof(policy->key)) {
+        fprintf(stderr, "%s: key \"%s\" too long\n", parse_file, key);
+        return -1;
+    }
+    if (!json_is_object(cfg)) {
+        fprintf(stderr, "%s: \"%s\" must be an object\n", parse_file, key);
+        return -1;
+    }
+
+    memset(policy, 0, sizeof(*policy));
+    strcpy(policy->key, key);
+
+    const char *mode = json_string_value(json_object_get(cfg, "mode"));
+    if (config_parse_mode(mode, &policy->mode) != 0) {
+        fprintf(stderr, "%s: %s: unknown mode \"%s\"\n", parse_file, key, mode);
+        return -1;
+    }
+
+    if (policy->mode == FAN_MODE_MANUAL) {
+        json_t *speed = json_object_get(cfg, "speed");
+        if (!json_is_integer(speed) || json_integer_value(speed) < 0 ||
+            json_integer_value(speed) > 100) {
+            fprintf(stderr, "%s: %s: manual speed must be an integer 0-100\n",
+                    parse_file, key);
+            return -1;
+        }
+        policy->speed = (int)json_integer_value(speed);
+    }
+
+    if (policy->mode == FAN_MODE_TARGET) {
+        json_t *target = json_object_get(cfg, "target");
+        if (!json_is_integer(target) || json_integer_value(target) < NVFD_TARGET_MIN ||
+            json_integer_value(target) > NVFD_TARGET_MAX) {
+            fprintf(stderr, "%s: %s: target must be an integer %d-%d\n",
+                    parse_file, key, NVFD_TARGET_MIN, NVFD_TARGET_MAX);
+            return -1;
+        }
+        policy->target = (int)json_integer_value(target);
+        if (read_gains(cfg, &policy->gains, key) != 0)
+            return -1;
+    }
+
+    if (policy->mode == FAN_MODE_CLOCKS) {
+        if (read_int(cfg, "target", NVFD_TARGET_DEFAULT, NVFD_TARGET_MIN,
+                     NVFD_TARGET_MAX, &policy->target, key) != 0 ||
+            read_gains(cfg, &policy->gains, key) != 0)
+            return -1;
+        ClockParams def;
+        clock_defaults(&def, policy->target);
+        if (read_int(cfg, "clock_floor", def.floor, NVFD_TARGET_MIN, policy->target,
+                     &policy->clocks.floor, key) != 0 ||
+            read_int(cfg, "clock_margin", def.margin, 0, NVFD_CLOCK_MARGIN_MAX,
+                     &policy->clocks.margin, key) != 0)
+            return -1;
+    }
+
+    if (policy->mode == FAN_MODE_EFFICIENCY) {
+        EfficiencyParams def;
+        eff_defaults(&def);
+        if (read_int(cfg, "target", NVFD_TARGET_DEFAULT, NVFD_TARGET_MIN,
+                     NVFD_TARGET_MAX, &policy->target, key) != 0 ||
+            read_double(cfg, "fan_watts", def.fan_watts, 0.0, NVFD_EFF_FAN_WATTS_MAX,
+                        &policy->efficiency.fan_watts, key) != 0 ||
+            read_int(cfg, "eff_step", def.step, 1, NVFD_EFF_STEP_MAX,
+                     &policy->efficiency.step, key) != 0 ||
+            read_double(cfg, "eff_dwell_s", def.dwell_s, NVFD_EFF_DWELL_S_MIN,
+                        NVFD_EFF_DWELL_S_MAX, &policy->efficiency.dwell_s, key) != 0)
+            return -1;
+    }
+
+    json_t *sensor = json_object_get(cfg, "sensor");
+    if (sensor) {
+        const char *text = json_string_value(sensor);
+        if (!text || sensor_parse(text, &policy->sensor) != 0) {
+            fprintf(stderr, "%s: %s: sensor must be \"core\", \"mem\" or e.g. "
+                    "\"max(core, mem-10)\"\n", parse_file, key);
+            return -1;
+        }
+    }
+
+    json_t *profile = json_object_get(cfg, "profile");
+    if (profile) {
+        const char *name = json_string_value(profile);
+        if (!name || !config_valid_profile_name(name)) {
+            fprintf(stderr, "%s: %s: profile must be a profile name\n", parse_file, key);
+            return -1;
+        }
+        strcpy(policy->profile, name);
+    }
+
+    if (read_int(cfg, "min_speed", 0, 0, 100, &policy->min_speed, key) != 0 ||
+        read_int(cfg, "max_speed", 100, 0, 100, &policy->max_speed, key) != 0)
+        return -1;
+    if (policy->min_speed > policy->max_speed) {
+        fprintf(stderr, "%s: %s: min_speed is greater than max_speed\n", parse_file, key);
+        return -1;
+    }
+
+    if (read_smooth(cfg, &snap->smooth, &policy->smooth, key) != 0 ||
+        read_feedforward(cfg, &snap->feedforward, &policy->feedforward, key) != 0 ||
+        read_governor(cfg, &snap->governor, &policy->governor, key) != 0)
+        return -1;
+    return read_poll_range(cfg, snap->poll_min_ms, snap->poll_max_ms,
+                           &policy->poll_min_ms, &policy->poll_max_ms, key);
+}
+
+/* Bind policies to GPU indices once so the control loop never looks up keys.
+ * A UUID entry wins over a legacy "gpuN" entry for the same device. */
+static int resolve_devices(ConfigSnapshot *snap) {
+    if (device_count == 0)
+        return 0;
+    snap->by_device = calloc(device_count, sizeof(*snap->by_device));
+    if (!snap->by_device)
+        return -1;
+
+    for (int i = 0; i < snap->policy_count; i++) {
+        unsigned int index;
+        char extra;
+        if (sscanf(snap->policies[i].key, "gpu%u%c", &index, &extra) == 1 &&
+            index < device_count && !snap->by_device[index])
+            snap->by_device[index] = &snap->policies[i];
+    }
+    for (int i = 0; i < snap->policy_count; i++) {
+        int index = gpu_find_uuid(snap->policies[i].key);
+        if (index >= 0)
+            snap->by_device[index] = &snap->policies[i];
+    }
+    return 0;
+}
+
+/* Same key rules as policies; a GPU can be in one zone only */
+static int resolve_zones(ConfigSnapshot *snap) {
+    if (device_count == 0 || snap->zone_count == 0)
+        return 0;
+    snap->zone_by_device = calloc(device_count, sizeof(*snap->zone_by_device));
+    if (!snap->zone_by_device)
+        return -1;
+
+    for (int z = 0; z < snap->zone_count; z++) {
+        Zone *zone = &snap->zones[z];
+        for (int m = 0; m < zone->member_count; m++) {
+            ZoneMember *member = &zone->members[m];
+            unsigned int index;
+            char extra;
+            member->gpu = gpu_find_uuid(member->key);
+            if (member->gpu < 0 && sscanf(member->key, "gpu%u%c", &index, &extra) == 1 &&
+                index < device_count)
+                member->gpu = (int)index;
+            if (member->gpu < 0)
+                continue; /* not installed right now */
+
+            if (snap->zone_by_device[member->gpu]) {
+                fprintf(stderr, "%s: GPU %d is in zone \"%s\" and zone \"%s\"\n",
+                        NVFD_CONFIG_FILE, member->gpu,
+                        snap->zone_by_device[member->gpu]->name, zone->name);
+                return -1;
+            }
+            snap->zone_by_device[member->gpu] = zone;
+        }
+    }
+    return 0;
+}
+
+static void free_compiled_curves(DeviceCurves **by_device) {
+    if (!*by_device)
+        return;
+    for (unsigned int i = 0; i < device_count; i++)
+        curve_device_free(&(*by_device)[i]);
+    free(*by_device);
+    *by_device = NULL;
+}
+
+/* Each GPU gets its curves resolved and compiled once, per fan */
+static int compile_curves(const CurveSet *set, DeviceCurves **by_device) {
+    free_compiled_curves(by_device);
+    if (device_count == 0)
+        return 0;
+    *by_device = calloc(device_count, sizeof(**by_device));
+    if (!*by_device)
+        return -1;
+
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        if (curve_compile_device(set, i, dev ? dev->fan_count : 0,
+                                 &(*by_device)[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int load_profile(const char *path, Profile *profile, const ConfigSnapshot *snap) {
+    json_error_t error;
+    json_t *root = json_load_file(path, 0, &error);
+    if (!json_is_object(root)) {
+        fprintf(stderr, "%s: line %d: %s\n", path, error.line,
+                root ? "expected an object" : error.text);
+        json_decref(root);
+        return -1;
+    }
+
+    parse_file = path;
+    int ret = parse_policy(profile->name, root, snap, &profile->policy);
+    parse_file = NVFD_CONFIG_FILE;
+    if (ret == 0 && profile->policy.profile[0]) {
+        fprintf(stderr, "%s: a profile cannot select another profile\n", path);
+        ret = -1;
+    }
+
+    json_t *curve = json_object_get(root, "curve");
+    if (ret == 0 && curve) {
+        if (!json_is_object(curve)) {
+            fprintf(stderr, "%s: \"curve\" must be an object\n", path);
+            ret = -1;
+        } else if (!(profile->curves = curve_parse(curve, path)) ||
+                   compile_curves(profile->curves, &profile->curves_by_device) != 0) {
+            ret = -1;
+        }
+    }
+    json_decref(root);
+    return ret;
+}
+
+static int profile_cmp(const void *a, const void *b) {
+    return strcmp(((const Profile *)a)->name, ((const Profile *)b)->name);
+}
+
+/* Every <name>.json in the profile directory; none is fine */
+static int load_profiles(ConfigSnapshot *snap) {
+    DIR *dir = opendir(NVFD_PROFILE_DIR);
+    if (!dir)
+        return 0;
+
+    int ret = 0;
+    int capacity = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (len <= 5 || strcmp(de->d_name + len - 5, ".json") != 0)
+            continue;
+
+        char name[NVFD_PROFILE_NAME_MAX];
+        char path[sizeof(NVFD_PROFILE_DIR) + NVFD_PROFILE_NAME_MAX + 8];
+        if (len - 5 >= sizeof(name)) {
+            fprintf(stderr, "%s/%s: profile name too long\n", NVFD_PROFILE_DIR, de->d_name);
+            ret = -1;
+            break;
+        }
+        memcpy(name, de->d_name, len - 5);
+        name[len - 5] = '\0';
+        if (!config_valid_profile_name(name)) {
+            fprintf(stderr, "%s/%s: profile names may only use letters, digits, "
+                    "'_' and '-'\n", NVFD_PROFILE_DIR, de->d_name);
+            ret = -1;
+            break;
+        }
+
+        if (snap->profile_count == capacity) {
+            int n = capacity ? capacity * 2 : 4;
+            Profile *grown = realloc(snap->profiles, (size_t)n * sizeof(*grown));
+            if (!grown) {
+                ret = -1;
+                break;
+            }
+            snap->profiles = grown;
+            capacity = n;
+        }
+        Profile *profile = &snap->profiles[snap->profile_count++];
+        memset(profile, 0, sizeof(*profile));
+        strcpy(profile->name, name);
+        snprintf(path, sizeof(path), "%s/%s", NVFD_PROFILE_DIR, de->d_name);
+        if (load_profile(path, profile, snap) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+    closedir(dir);
+
+    if (snap->profile_count > 1)
+        qsort(snap->profiles, (size_t)snap->profile_count, sizeof(*snap->profiles),
+              profile_cmp);
+    return ret;
+}
+
+/* A GPU entry or rule may only name a profile that exists */
+static int check_profile_refs(ConfigSnapshot *snap) {
+    for (int i = 0; i < snap->policy_count; i++) {
+        const GpuPolicy *policy = &snap->policies[i];
+        if (policy->profile[0] && !config_snapshot_profile(snap, policy->profile)) {
+            fprintf(stderr, "%s: %s: no profile \"%s\" in %s\n", NVFD_CONFIG_FILE,
+                    policy->key, policy->profile, NVFD_PROFILE_DIR);
+            return -1;
+        }
+    }
+    for (int i = 0; i < snap->rule_count; i++) {
+        ProcessRule *rule = &snap->rules[i];
+        rule->profile = config_snapshot_profile(snap, rule->name);
+        if (!rule->profile) {
+            fprintf(stderr, "%s: daemon.rules[%d]: no profile \"%s\" in %s\n",
+                    NVFD_CONFIG_FILE, i, rule->name, NVFD_PROFILE_DIR);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+ConfigSnapshot *config_snapshot_load(void) {
+    ConfigSnapshot *snap = config_snapshot_empty();
+    if (!snap)
+        return NULL;
+
+    json_t *root = NULL;
+    FILE *fp = fopen(NVFD_CONFIG_FILE, "r");
+    if (fp) {
+        json_error_t error;
+        root = json_loadf(fp, 0, &error);
+        fclose(fp);
+        if (!json_is_object(root)) {
+            fprintf(stderr, "%s: line %d: %s\n", NVFD_CONFIG_FILE, error.line,
+                    root ? "expected an object" : error.text);
+            goto invalid;
+        }
+    } else {
+        root = json_object(); /* no config file: every GPU in auto */
+    }
+
+    if (parse_daemon(root, snap) != 0)
+        goto invalid;
+
+    size_t n = json_object_size(root);
+    if (n > 0) {
+        snap->policies = calloc(n, sizeof(GpuPolicy));
+        if (!snap->policies)
+            goto invalid;
+    }
+
+    const char *key;
+    json_t *value;
+    json_object_foreach(root, key, value) {
+        if (strcmp(key, "daemon") == 0)
+            continue;
+        if (parse_policy(key, value, snap, &snap->policies[snap->policy_count]) != 0)
+            goto invalid;
+        snap->policy_count++;
+    }
+    json_decref(root);
+    root = NULL;
+
+    if (resolve_devices(snap) != 0 || resolve_zones(snap) != 0)
+        goto invalid;
+
+    if (curve_load(&snap->curves) != 0)
+        goto invalid;
+    if (compile_curves(snap->curves, &snap->curves_by_device) != 0)
+        goto invalid;
+    if (load_profiles(snap) != 0 || check_profile_refs(snap) != 0)
+        goto invalid;
+
+    return snap;
+
+invalid:
+    json_decref(root);
+    config_snapshot_free(snap);
+    return NULL;
+}
+
+ConfigSnapshot *config_snapshot_empty(void) {
+    ConfigSnapshot *snap = calloc(1, sizeof(ConfigSnapshot));
+    if (!snap)
+        return NULL;
+    snap->poll_min_ms = NVFD_POLL_MIN_MS_DEFAULT;
+    snap->poll_max_ms = NVFD_POLL_MAX_MS_DEFAULT;
+    snap->deadband = NVFD_DEADBAND_DEFAULT;
+    snap->reassert_s = NVFD_REASSERT_S_DEFAULT;
+    snap->rule_poll_s = NVFD_RULE_POLL_S_DEFAULT;
+    snap->rule_debounce_s = NVFD_RULE_DEBOUNCE_S_DEFAULT;
+    smooth_defaults(&snap->smooth);
+    ff_defaults(&snap->feedforward);
+    gov_defaults(&snap->governor);
+    rt_defaults(&snap->realtime);
+    if (compile_curves(NULL, &snap->curves_by_device) != 0) {
+        config_snapshot_free(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+void config_snapshot_free(ConfigSnapshot *snap) {
+    if (!snap)
+        return;
+    free(snap->by_device);
+    free(snap->policies);
+    free_compiled_curves(&snap->curves_by_device);
+    curve_set_free(snap->curves);
+    for (int i = 0; i < snap->profile_count; i++) {
+        free_compiled_curves(&snap->profiles[i].curves_by_device);
+        curve_set_free(snap->profiles[i].curves);
+    }
+    free(snap->profiles);
+    for (int i = 0; i < snap->rule_count; i++) {
+        proc_pattern_free(&snap->rules[i].process);
+        proc_pattern_free(&snap->rules[i].cgroup);
+    }
+    free(snap->rules);
+    free(snap->zones);
+    free(snap->zone_by_device);
+    free(snap);
+}
+
+const GpuPolicy *config_snapshot_policy(const ConfigSnapshot *snap, unsigned int gpu_index) {
+    if (!snap->by_device || gpu_index >= device_count)
+        return NULL;
+    return snap->by_device[gpu_index];
+}
+
+const Zone *config_snapshot_zone(const ConfigSnapshot *snap, unsigned int gpu_index,
+                                 int *member) {
+    if (!snap->zone_by_device || gpu_index >= device_count ||
+        !snap->zone_by_device[gpu_index])
+        return NULL;
+    const Zone *zone = snap->zone_by_device[gpu_index];
+    for (int m = 0; m < zone->member_count; m++) {
+        if (zone->members[m].gpu == (int)gpu_index) {
+            *member = m;
+            return zone;
+        }
+    }
+    return NULL;
+}
+
+const DeviceCurves *config_snapshot_curves(const ConfigSnapshot *snap,
+                                           unsigned int gpu_index) {
+    if (!snap->curves_by_device || gpu_index >= device_count)
+        return NULL;
+    return &snap->curves_by_device[gpu_index];
+}
+
+const Profile *config_snapshot_profile(const ConfigSnapshot *snap, const char *name) {
+    for (int i = 0; i < snap->profile_count; i++) {
+        if (strcmp(snap->profiles[i].name, name) == 0)
+            return &snap->profiles[i];
+    }
+    return NULL;
+}
+
+const DeviceCurves *config_profile_curves(const ConfigSnapshot *snap,
+                                          const Profile *profile,
+                                          unsigned int gpu_index) {
+    if (profile && profile->curves_by_device && gpu_index < device_count)
+        return &profile->curves_by_device[gpu_index];
+    return config_snapshot_curves(snap, gpu_index);
+}
+
+const ProcessRule *config_match_rules(const ConfigSnapshot *snap,
+                                      const ProcessList *list,
+                                      const ProcInfo **proc) {
+    for (int r = 0; r < snap->rule_count; r++) {
+        const ProcessRule *rule = &snap->rules[r];
+        for (unsigned int p = 0; p < list->count; p++) {
+            const ProcInfo *info = &list->procs[p];
+            if (proc_pattern_match(&rule->process, info->comm, info->comm_len) &&
+                proc_pattern_match(&rule->cgroup, info->cgroup, info->cgroup_len)) {
+                if (proc)
+                    *proc = info;
+                return rule;
+            }
+        }
+    }
+    return NULL;
+}
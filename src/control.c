@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#include "control.h"
+
+static void socket_addr(struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strncpy(addr->sun_path, NVFD_CONTROL_SOCKET, sizeof(addr->sun_path) - 1);
+}
+
+int control_open(void) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("control socket");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    socket_addr(&addr);
+    unlink(NVFD_CONTROL_SOCKET); /* left behind by a daemon that died */
+
+    /* Root only: requests change how the fans are driven */
+    mode_t old = umask(0077);
+    int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old);
+    if (ret != 0) {
+        perror("bind(" NVFD_CONTROL_SOCKET ")");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void control_close(int fd) {
+    if (fd < 0)
+        return;
+    close(fd);
+    unlink(NVFD_CONTROL_SOCKET);
+}
+
+int control_recv(int fd, ControlMsg *msg) {
+    for (;;) {
+        msg->from_len = sizeof(msg->from);
+        ssize_t len = recvfrom(fd, msg->text, sizeof(msg->text) - 1, 0,
+                               (struct sockaddr *)&msg->from, &msg->from_len);
+        if (len < 0)
+            return 0;
+        msg->text[len] = '\0';
+        /* Trailing newlines from hand-written requests (socat etc.) */
+        while (len > 0 && (msg->text[len - 1] == '\n' || msg->text[len - 1] == '\r'))
+            msg->text[--len] = '\0';
+        if (len > 0)
+            return 1;
+    }
+}
+
+void control_reply(int fd, const ControlMsg *msg, const char *text) {
+    /* An unbound sender cannot be answered */
+    if (msg->from_len <= sizeof(sa_family_t))
+        return;
+    sendto(fd, text, strlen(text), MSG_DONTWAIT,
+           (const struct sockaddr *)&msg->from, msg->from_len);
+}
+
+int control_request(const char *request, char *reply, size_t len) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    /* Autobind an abstract address so the daemon can answer */
+    struct sockaddr_un self = { .sun_family = AF_UNIX };
+    struct sockaddr_un addr;
+    socket_addr(&addr);
+    if (bind(fd, (struct sockaddr *)&self, sizeof(sa_family_t)) != 0 ||
+        sendto(fd, request, strlen(request), 0,
+               (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    int ready;
+    do {
+        ready = poll(&pfd, 1, NVFD_CONTROL_TIMEOUT_MS);
+    } while (ready < 0 && errno == EINTR);
+
+    ssize_t n = ready > 0 ? recv(fd, reply, len - 1, 0) : -1;
+    close(fd);
+    if (n < 0)
+        return -1;
+    reply[n] = '\0';
+    return 0;
+}
+
+int control_set_profile(const char *name, int gpu, char *err, size_t len) {
+    char request[64 + NVFD_PROFILE_NAME_MAX];
+    char reply[CONTROL_MSG_MAX];
+    char which[16] = "all";
+    if (gpu >= 0)
+        snprintf(which, sizeof(which), "%d", gpu);
+    snprintf(request, sizeof(request), "profile %s %s", name ? name : "none", which);
+
+    if (control_request(request, reply, sizeof(reply)) != 0)
+        return -1;
+    if (strcmp(reply, "ok") == 0)
+        return 0;
+    snprintf(err, len, "%s", strncmp(reply, "error ", 6) == 0 ? reply + 6 : reply);
+    return 1;
+}
+
+int control_active_profiles(char (*names)[NVFD_PROFILE_NAME_MAX], unsigned int count) {
+    char reply[CONTROL_MSG_MAX];
+    if (control_request("active", reply, sizeof(reply)) != 0)
+        return -1;
+
+    for (unsigned int i = 0; i < count; i++)
+        names[i][0] = '\0';
+    char *save;
+    for (char *line = strtok_r(reply, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        unsigned int index;
+        char name[NVFD_PROFILE_NAME_MAX];
+        if (sscanf(line, "%u %31s", &index, name) == 2 /* NAME_MAX - 1 */ && index < count &&
+            strcmp(name, "-") != 0)
+            snprintf(names[index], NVFD_PROFILE_NAME_MAX, "%s", name);
+    }
+    return 0;
+}
+
+int control_fan_budget(int *budget, int *granted, int *wanted, unsigned int count) {
+    char reply[CONTROL_MSG_MAX];
+    if (control_request("budget", reply, sizeof(reply)) != 0)
+        return -1;
+
+    for (unsigned int i = 0; i < count; i++)
+        granted[i] = wanted[i] = -1;
+    *budget = 0;
+    char *save;
+    for (char *line = strtok_r(reply, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        unsigned int index;
+        int grant, want;
+        if (sscanf(line, "budget %d", budget) == 1)
+            continue;
+        if (sscanf(line, "%u %d %d", &index, &grant, &want) == 3 && index < count) {
+            granted[index] = grant;
+            wanted[index] = want;
+        }
+    }
+    return 0;
+}
@@ -3,54 +3,428 @@
 #include <string.h>
 #include <jansson.h>
 #include "curve.h"
+#include "gpu.h"
+#include "sensor.h"
 
-static int compare_points(const void *a, const void *b) {
-    return ((const FanCurvePoint *)a)->temperature -
-           ((const FanCurvePoint *)b)->temperature;
+/* Fan indices a curve file may name */
+#define CURVE_FAN_MAX 255
+
+/* Built-in curve used when no curve file exists */
+static const FanCurvePoint default_points[] = {
+    {30, 30}, {40, 40}, {50, 55}, {60, 70}, {70, 90}, {75, 100}
+};
+#define DEFAULT_POINTS ((int)(sizeof(default_points) / sizeof(default_points[0])))
+
+static const FanCurve builtin_curve = {
+    .points = (FanCurvePoint *)default_points,
+    .point_count = DEFAULT_POINTS
+};
+
+void curve_init(FanCurve *curve) {
+    curve->points = NULL;
+    curve->point_count = 0;
+    curve->capacity = 0;
+    curve->hysteresis = 0;
+    curve->hold_s = 0.0;
+    curve->interpolation = CURVE_LINEAR;
+    memset(&curve->sensor, 0, sizeof(curve->sensor));
 }
 
-FanCurve *curve_read(void) {
-    json_error_t error;
-    json_t *root = json_load_file(NVFD_CURVE_FILE, 0, &error);
-    if (!root)
-        return NULL;
+void curve_free(FanCurve *curve) {
+    free(curve->points);
+    curve_init(curve);
+}
 
-    FanCurve *curve = malloc(sizeof(FanCurve));
-    if (!curve) {
-        json_decref(root);
+static int curve_reserve(FanCurve *curve, int count) {
+    if (count <= curve->capacity)
+        return 0;
+    int capacity = curve->capacity ? curve->capacity * 2 : 8;
+    while (capacity < count)
+        capacity *= 2;
+    FanCurvePoint *points = realloc(curve->points, (size_t)capacity * sizeof(*points));
+    if (!points)
+        return -1;
+    curve->points = points;
+    curve->capacity = capacity;
+    return 0;
+}
+
+int curve_copy(FanCurve *dst, const FanCurve *src) {
+    dst->point_count = 0;
+    if (!src || src->point_count == 0)
+        return 0;
+    dst->hysteresis = src->hysteresis;
+    dst->hold_s = src->hold_s;
+    dst->interpolation = src->interpolation;
+    dst->sensor = src->sensor;
+    if (curve_reserve(dst, src->point_count) != 0)
+        return -1;
+    memcpy(dst->points, src->points, (size_t)src->point_count * sizeof(*src->points));
+    dst->point_count = src->point_count;
+    return 0;
+}
+
+int curve_set_point(FanCurve *curve, int temp, int speed) {
+    int index = 0;
+    while (index < curve->point_count && curve->points[index].temperature < temp)
+        index++;
+
+    if (index < curve->point_count && curve->points[index].temperature == temp) {
+        curve->points[index].fan_speed = speed;
+        return index;
+    }
+
+    if (curve_reserve(curve, curve->point_count + 1) != 0)
+        return -1;
+    memmove(&curve->points[index + 1], &curve->points[index],
+            (size_t)(curve->point_count - index) * sizeof(*curve->points));
+    curve->points[index].temperature = temp;
+    curve->points[index].fan_speed = speed;
+    curve->point_count++;
+    return index;
+}
+
+void curve_remove_point(FanCurve *curve, int index) {
+    if (index < 0 || index >= curve->point_count)
+        return;
+    memmove(&curve->points[index], &curve->points[index + 1],
+            (size_t)(curve->point_count - index - 1) * sizeof(*curve->points));
+    curve->point_count--;
+}
+
+static const FanCurvePoint reset_points[] = {
+    {30, 30}, {40, 40}, {50, 55}, {60, 65}, {70, 85}, {80, 100}
+};
+
+int curve_fill_default(FanCurve *curve) {
+    FanCurve stock = {
+        .points = (FanCurvePoint *)reset_points,
+        .point_count = (int)(sizeof(reset_points) / sizeof(reset_points[0]))
+    };
+    return curve_copy(curve, &stock);
+}
+
+static void gpu_curve_free(GpuCurve *gc) {
+    curve_free(&gc->curve);
+    for (unsigned int f = 0; f < gc->fan_count; f++)
+        curve_free(&gc->fans[f]);
+    free(gc->fans);
+    gc->fans = NULL;
+    gc->fan_count = 0;
+}
+
+void curve_set_free(CurveSet *set) {
+    if (!set)
+        return;
+    curve_free(&set->def);
+    for (int i = 0; i < set->gpu_count; i++)
+        gpu_curve_free(&set->gpus[i]);
+    free(set->gpus);
+    free(set);
+}
+
+CurveSet *curve_set_new(void) {
+    CurveSet *set = calloc(1, sizeof(CurveSet));
+    if (set)
+        curve_init(&set->def);
+    return set;
+}
+
+static GpuCurve *add_gpu(CurveSet *set, const char *key) {
+    GpuCurve *gpus = realloc(set->gpus, (size_t)(set->gpu_count + 1) * sizeof(*gpus));
+    if (!gpus)
         return NULL;
+    set->gpus = gpus;
+
+    GpuCurve *gc = &set->gpus[set->gpu_count++];
+    memset(gc, 0, sizeof(*gc));
+    snprintf(gc->key, sizeof(gc->key), "%s", key);
+    curve_init(&gc->curve);
+    return gc;
+}
+
+static FanCurve *gpu_fan(GpuCurve *gc, unsigned int fan) {
+    if (fan >= gc->fan_count) {
+        FanCurve *fans = realloc(gc->fans, (fan + 1) * sizeof(*fans));
+        if (!fans)
+            return NULL;
+        for (unsigned int f = gc->fan_count; f <= fan; f++)
+            curve_init(&fans[f]);
+        gc->fans = fans;
+        gc->fan_count = fan + 1;
     }
-    curve->point_count = 0;
+    return &gc->fans[fan];
+}
 
+/* File named in parse errors; profiles embed curves of their own */
+static const char *parse_file = NVFD_CURVE_FILE;
+
+/* Evaluation options stored next to a curve's points */
+static int parse_option(const char *key, const json_t *value, FanCurve *curve,
+                        int strict, const char *ctx) {
+    if (strcmp(key, "interpolation") == 0) {
+        const char *name = json_string_value(value);
+        if (name && curve_parse_interpolation(name, &curve->interpolation) == 0)
+            return 0;
+        if (strict)
+            fprintf(stderr, "%s: %s: interpolation must be \"linear\", "
+                    "\"monotone_cubic\" or \"step\"\n", parse_file, ctx);
+    } else if (strcmp(key, "sensor") == 0) {
+        const char *text = json_string_value(value);
+        if (text && sensor_parse(text, &curve->sensor) == 0)
+            return 0;
+        if (strict)
+            fprintf(stderr, "%s: %s: sensor must be \"core\", \"mem\" or e.g. "
+                    "\"max(core, mem-10)\"\n", parse_file, ctx);
+    } else if (strcmp(key, "hysteresis") == 0) {
+        json_int_t v = json_integer_value(value);
+        if (json_is_integer(value) && v >= 0 && v <= CURVE_HYSTERESIS_MAX) {
+            curve->hysteresis = (int)v;
+            return 0;
+        }
+        if (strict)
+            fprintf(stderr, "%s: %s: hysteresis must be an integer 0-%d\n",
+                    parse_file, ctx, CURVE_HYSTERESIS_MAX);
+    } else {
+        double v = json_number_value(value);
+        if (json_is_number(value) && v >= 0.0 && v <= CURVE_HOLD_S_MAX) {
+            curve->hold_s = v;
+            return 0;
+        }
+        if (strict)
+            fprintf(stderr, "%s: %s: hold_s must be a number 0-%g\n",
+                    parse_file, ctx, CURVE_HOLD_S_MAX);
+    }
+    return strict ? -1 : 0;
+}
+
+/* Numeric keys are points, "interpolation", "sensor", "hysteresis" and
+ * "hold_s" options; the one key named skip holds nested entries. Strict
+ * parsing reports the first problem and fails, lenient parsing drops bad
+ * entries. */
+static int parse_points(const json_t *obj, const char *skip, FanCurve *curve,
+                        int strict, const char *ctx) {
     const char *key;
     json_t *value;
-    json_object_foreach(root, key, value) {
-        if (curve->point_count >= MAX_CURVE_POINTS)
-            break;
-        curve->points[curve->point_count].temperature = atoi(key);
-        curve->points[curve->point_count].fan_speed = (int)json_integer_value(value);
-        curve->point_count++;
+    json_object_foreach((json_t *)obj, key, value) {
+        if (skip && strcmp(key, skip) == 0)
+            continue;
+        if (strcmp(key, "interpolation") == 0 || strcmp(key, "sensor") == 0 ||
+            strcmp(key, "hysteresis") == 0 || strcmp(key, "hold_s") == 0) {
+            if (parse_option(key, value, curve, strict, ctx) != 0)
+                return -1;
+            continue;
+        }
+
+        char *end;
+        long temp = strtol(key, &end, 10);
+        if (*key == '\0' || *end != '\0' || temp < CURVE_TEMP_MIN || temp > CURVE_TEMP_MAX) {
+            if (!strict)
+                continue;
+            fprintf(stderr, "%s: %s: invalid temperature \"%s\"\n",
+                    parse_file, ctx, key);
+            return -1;
+        }
+        json_int_t speed = json_integer_value(value);
+        if (!json_is_integer(value) || speed < 0 || speed > 100) {
+            if (!strict)
+                continue;
+            fprintf(stderr, "%s: %s: %s°C: speed must be an integer 0-100\n",
+                    parse_file, ctx, key);
+            return -1;
+        }
+
+        int before = curve->point_count;
+        int index = curve_set_point(curve, (int)temp, (int)speed);
+        if (index < 0)
+            return -1;
+        if (strict && curve->point_count == before) {
+            fprintf(stderr, "%s: %s: duplicate point at %ld°C\n",
+                    parse_file, ctx, temp);
+            return -1;
+        }
     }
+    return 0;
+}
 
-    json_decref(root);
+static int parse_gpu(CurveSet *set, const char *key, const json_t *entry, int strict) {
+    if (strlen(key) >= sizeof(set->gpus[0].key) || !json_is_object(entry)) {
+        if (!strict)
+            return 0;
+        fprintf(stderr, "%s: gpus.%s must be an object\n", parse_file, key);
+        return -1;
+    }
+
+    GpuCurve *gc = add_gpu(set, key);
+    if (!gc || parse_points(entry, "fans", &gc->curve, strict, key) != 0)
+        return -1;
+
+    json_t *fans = json_object_get(entry, "fans");
+    if (!fans)
+        return 0;
+    if (!json_is_object(fans)) {
+        if (!strict)
+            return 0;
+        fprintf(stderr, "%s: %s.fans must be an object\n", parse_file, key);
+        return -1;
+    }
 
-    /* Ensure points are sorted by temperature */
-    qsort(curve->points, (size_t)curve->point_count, sizeof(FanCurvePoint),
-          compare_points);
+    const char *fan_key;
+    json_t *points;
+    json_object_foreach(fans, fan_key, points) {
+        char ctx[NVML_DEVICE_UUID_V2_BUFFER_SIZE + 16];
+        snprintf(ctx, sizeof(ctx), "%s fan %s", key, fan_key);
 
-    return curve;
+        char *end;
+        long fan = strtol(fan_key, &end, 10);
+        if (*fan_key == '\0' || *end != '\0' || fan < 0 || fan > CURVE_FAN_MAX ||
+            !json_is_object(points)) {
+            if (!strict)
+                continue;
+            fprintf(stderr, "%s: %s: expected a fan index 0-%d holding points\n",
+                    parse_file, ctx, CURVE_FAN_MAX);
+            return -1;
+        }
+        FanCurve *curve = gpu_fan(gc, (unsigned int)fan);
+        if (!curve || parse_points(points, NULL, curve, strict, ctx) != 0)
+            return -1;
+    }
+    return 0;
 }
 
-int curve_write(const FanCurve *curve) {
-    json_t *root = json_object();
-    if (!root)
+/* Top-level numeric keys are the default curve, so a plain legacy curve
+ * file is also a valid set; "gpus" holds the overrides */
+static CurveSet *parse_set(const json_t *root, int strict) {
+    CurveSet *set = curve_set_new();
+    if (!set)
+        return NULL;
+
+    if (parse_points(root, "gpus", &set->def, strict, "default curve") != 0)
+        goto invalid;
+
+    json_t *gpus = json_object_get(root, "gpus");
+    if (gpus && !json_is_object(gpus)) {
+        if (strict) {
+            fprintf(stderr, "%s: \"gpus\" must be an object\n", parse_file);
+            goto invalid;
+        }
+        gpus = NULL;
+    }
+
+    const char *key;
+    json_t *entry;
+    json_object_foreach(gpus, key, entry) {
+        if (parse_gpu(set, key, entry, strict) != 0)
+            goto invalid;
+    }
+    return set;
+
+invalid:
+    curve_set_free(set);
+    return NULL;
+}
+
+CurveSet *curve_parse(const json_t *root, const char *file) {
+    parse_file = file;
+    CurveSet *set = parse_set(root, 1);
+    parse_file = NVFD_CURVE_FILE;
+    return set;
+}
+
+CurveSet *curve_read(void) {
+    json_error_t error;
+    json_t *root = json_load_file(NVFD_CURVE_FILE, 0, &error);
+    if (!json_is_object(root)) {
+        json_decref(root);
+        return NULL;
+    }
+
+    CurveSet *set = parse_set(root, 0);
+    json_decref(root);
+    return set;
+}
+
+int curve_load(CurveSet **out) {
+    *out = NULL;
+
+    FILE *fp = fopen(NVFD_CURVE_FILE, "r");
+    if (!fp)
+        return 0; /* no curve file: built-in default applies */
+
+    json_error_t error;
+    json_t *root = json_loadf(fp, 0, &error);
+    fclose(fp);
+    if (!json_is_object(root)) {
+        fprintf(stderr, "%s: line %d: %s\n", NVFD_CURVE_FILE, error.line,
+                root ? "expected an object" : error.text);
+        json_decref(root);
         return -1;
+    }
 
+    CurveSet *set = parse_set(root, 1);
+    json_decref(root);
+    if (!set)
+        return -1;
+    *out = set;
+    return 0;
+}
+
+static void dump_points(json_t *obj, const FanCurve *curve) {
     for (int i = 0; i < curve->point_count; i++) {
         char key[8];
         snprintf(key, sizeof(key), "%d", curve->points[i].temperature);
-        json_object_set_new(root, key, json_integer(curve->points[i].fan_speed));
+        json_object_set_new(obj, key, json_integer(curve->points[i].fan_speed));
+    }
+    /* Options only mean something next to points */
+    if (curve->point_count > 0 && curve->interpolation != CURVE_LINEAR)
+        json_object_set_new(obj, "interpolation",
+                            json_string(curve_interpolation_name(curve->interpolation)));
+    if (curve->point_count > 0 && curve->sensor.count > 0) {
+        char text[64];
+        sensor_format(&curve->sensor, text, sizeof(text));
+        json_object_set_new(obj, "sensor", json_string(text));
     }
+    if (curve->point_count > 0 && curve->hysteresis > 0)
+        json_object_set_new(obj, "hysteresis", json_integer(curve->hysteresis));
+    if (curve->point_count > 0 && curve->hold_s > 0.0)
+        json_object_set_new(obj, "hold_s", json_real(curve->hold_s));
+}
+
+int curve_write(const CurveSet *set) {
+    json_t *root = json_object();
+    if (!root)
+        return -1;
+
+    dump_points(root, &set->def);
+
+    json_t *gpus = json_object();
+    for (int i = 0; i < set->gpu_count; i++) {
+        const GpuCurve *gc = &set->gpus[i];
+        json_t *entry = json_object();
+        dump_points(entry, &gc->curve);
+
+        json_t *fans = json_object();
+        for (unsigned int f = 0; f < gc->fan_count; f++) {
+            if (gc->fans[f].point_count == 0)
+                continue;
+            char key[12];
+            snprintf(key, sizeof(key), "%u", f);
+            json_t *points = json_object();
+            dump_points(points, &gc->fans[f]);
+            json_object_set_new(fans, key, points);
+        }
+        if (json_object_size(fans) > 0)
+            json_object_set(entry, "fans", fans);
+        json_decref(fans);
+
+        /* An override with nothing left in it just inherits */
+        if (json_object_size(entry) > 0)
+            json_object_set(gpus, gc->key, entry);
+        json_decref(entry);
+    }
+    if (json_object_size(gpus) > 0)
+        json_object_set(root, "gpus", gpus);
+    json_decref(gpus);
 
     /* Atomic write: write to .tmp then rename */
     char tmp_path[256];
@@ -73,105 +447,377 @@ int curve_write(const FanCurve *curve) {
     return 0;
 }
 
-void curve_edit(int temp, int speed) {
-    FanCurve *curve = curve_read();
-    if (!curve) {
-        curve = malloc(sizeof(FanCurve));
-        if (!curve) return;
-        curve->point_count = 0;
-    }
+static int find_gpu(const CurveSet *set, unsigned int gpu_index) {
+    if (!set)
+        return -1;
 
-    /* Find existing point or insertion position */
-    int index = -1;
-    for (int i = 0; i < curve->point_count; i++) {
-        if (curve->points[i].temperature == temp) {
-            index = i;
-            break;
-        } else if (curve->points[i].temperature > temp) {
-            index = i;
-            break;
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (dev && dev->uuid[0]) {
+        for (int i = 0; i < set->gpu_count; i++) {
+            if (strcmp(set->gpus[i].key, dev->uuid) == 0)
+                return i;
         }
     }
-    if (index == -1)
-        index = curve->point_count;
 
-    if (index < curve->point_count && curve->points[index].temperature == temp) {
-        /* Update existing point */
-        curve->points[index].fan_speed = speed;
-    } else {
-        if (curve->point_count >= MAX_CURVE_POINTS) {
-            printf("Error: Fan curve points have reached the maximum of %d.\n",
-                   MAX_CURVE_POINTS);
-            free(curve);
+    char legacy[20];
+    snprintf(legacy, sizeof(legacy), "gpu%u", gpu_index);
+    for (int i = 0; i < set->gpu_count; i++) {
+        if (strcmp(set->gpus[i].key, legacy) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const GpuCurve *curve_set_gpu(const CurveSet *set, unsigned int gpu_index) {
+    int i = find_gpu(set, gpu_index);
+    return i >= 0 ? &set->gpus[i] : NULL;
+}
+
+const FanCurve *curve_resolve(const CurveSet *set, unsigned int gpu_index, int fan) {
+    if (!set)
+        return NULL;
+
+    const GpuCurve *gc = curve_set_gpu(set, gpu_index);
+    if (gc && fan >= 0 && (unsigned int)fan < gc->fan_count &&
+        gc->fans[fan].point_count > 0)
+        return &gc->fans[fan];
+    if (gc && gc->curve.point_count > 0)
+        return &gc->curve;
+    return set->def.point_count > 0 ? &set->def : NULL;
+}
+
+FanCurve *curve_select(CurveSet *set, CurveSelector sel) {
+    if (sel.gpu < 0)
+        return &set->def;
+
+    int i = find_gpu(set, (unsigned int)sel.gpu);
+    const GpuDevice *dev = gpu_device((unsigned int)sel.gpu);
+    if (i < 0) {
+        char legacy[20];
+        snprintf(legacy, sizeof(legacy), "gpu%d", sel.gpu);
+        if (!add_gpu(set, dev && dev->uuid[0] ? dev->uuid : legacy))
+            return NULL;
+        i = set->gpu_count - 1;
+    } else if (dev && dev->uuid[0]) {
+        /* Store under the UUID so a reordered bus cannot swap curves */
+        snprintf(set->gpus[i].key, sizeof(set->gpus[i].key), "%s", dev->uuid);
+    }
+
+    GpuCurve *gc = &set->gpus[i];
+    FanCurve *curve = sel.fan < 0 ? &gc->curve : gpu_fan(gc, (unsigned int)sel.fan);
+    if (!curve || curve->point_count > 0)
+        return curve;
+
+    /* A new override starts as a copy of what it replaces */
+    const FanCurve *parent = sel.fan >= 0 && gc->curve.point_count > 0 ? &gc->curve
+                             : set->def.point_count > 0 ? &set->def : &builtin_curve;
+    return curve_copy(curve, parent) == 0 ? curve : NULL;
+}
+
+int curve_parse_selector(const char *str, CurveSelector *sel) {
+    sel->gpu = -1;
+    sel->fan = -1;
+    if (strcmp(str, "default") == 0)
+        return 0;
+
+    if (strncmp(str, "gpu", 3) == 0)
+        str += 3;
+
+    char *end;
+    long gpu = strtol(str, &end, 10);
+    if (end == str || gpu < 0 || gpu >= (long)device_count)
+        return -1;
+    sel->gpu = (int)gpu;
+    if (*end == '\0')
+        return 0;
+
+    if (*end != ':')
+        return -1;
+    const char *fan_str = end + 1;
+    long fan = strtol(fan_str, &end, 10);
+    const GpuDevice *dev = gpu_device((unsigned int)gpu);
+    if (end == fan_str || *end != '\0' || fan < 0 || !dev || fan >= (long)dev->fan_count)
+        return -1;
+    sel->fan = (int)fan;
+    return 0;
+}
+
+void curve_describe(CurveSelector sel, char *buf, size_t len) {
+    if (sel.gpu < 0)
+        snprintf(buf, len, "default curve");
+    else if (sel.fan < 0)
+        snprintf(buf, len, "GPU %d curve", sel.gpu);
+    else
+        snprintf(buf, len, "GPU %d fan %d curve", sel.gpu, sel.fan);
+}
+
+void curve_edit(CurveSelector sel, int temp, int speed) {
+    CurveSet *set = curve_read();
+    if (!set)
+        set = curve_set_new();
+    if (!set)
+        return;
+
+    char what[48];
+    curve_describe(sel, what, sizeof(what));
+
+    FanCurve *curve = curve_select(set, sel);
+    if (!curve || curve_set_point(curve, temp, speed) < 0) {
+        printf("Error: Out of memory editing the %s.\n", what);
+        curve_set_free(set);
+        return;
+    }
+
+    if (curve_write(set) == 0)
+        printf("Updated %s: %d°C -> %d%%\n", what, temp, speed);
+    curve_set_free(set);
+}
+
+void curve_reset(CurveSelector sel) {
+    CurveSet *set = curve_read();
+    if (!set)
+        set = curve_set_new();
+    if (!set)
+        return;
+
+    char what[48];
+    curve_describe(sel, what, sizeof(what));
+
+    int i = sel.gpu >= 0 ? find_gpu(set, (unsigned int)sel.gpu) : -1;
+    if (sel.gpu < 0) {
+        if (curve_fill_default(&set->def) != 0) {
+            curve_set_free(set);
             return;
         }
-        /* Insert new point */
-        for (int i = curve->point_count; i > index; i--)
-            curve->points[i] = curve->points[i - 1];
-        curve->points[index].temperature = temp;
-        curve->points[index].fan_speed = speed;
-        curve->point_count++;
+    } else if (i >= 0 && sel.fan < 0) {
+        gpu_curve_free(&set->gpus[i]);
+    } else if (i >= 0 && (unsigned int)sel.fan < set->gpus[i].fan_count) {
+        curve_free(&set->gpus[i].fans[sel.fan]);
     }
 
-    curve_write(curve);
-    printf("Updated fan curve: %d°C -> %d%%\n", temp, speed);
-    free(curve);
+    if (curve_write(set) == 0) {
+        if (sel.gpu < 0)
+            printf("Fan curve has been reset to default values.\n");
+        else
+            printf("Removed the %s; it now inherits.\n", what);
+    }
+    curve_set_free(set);
 }
 
-void curve_reset(void) {
-    FanCurve def = {
-        .points = {
-            {30, 30}, {40, 40}, {50, 55},
-            {60, 65}, {70, 85}, {80, 100}
-        },
-        .point_count = 6
-    };
-    curve_write(&def);
-    printf("Fan curve has been reset to default values.\n");
+static const char *const interpolation_names[] = {
+    [CURVE_LINEAR]         = "linear",
+    [CURVE_MONOTONE_CUBIC] = "monotone_cubic",
+    [CURVE_STEP]           = "step",
+};
+#define INTERPOLATION_COUNT \
+    ((int)(sizeof(interpolation_names) / sizeof(interpolation_names[0])))
+
+const char *curve_interpolation_name(CurveInterpolation mode) {
+    if ((int)mode < 0 || (int)mode >= INTERPOLATION_COUNT)
+        return "linear";
+    return interpolation_names[mode];
 }
 
-int curve_interpolate(int temp, const FanCurve *curve) {
-    if (curve->point_count == 0)
+int curve_parse_interpolation(const char *name, CurveInterpolation *mode) {
+    for (int i = 0; i < INTERPOLATION_COUNT; i++) {
+        if (strcmp(name, interpolation_names[i]) == 0) {
+            *mode = (CurveInterpolation)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static double secant(const FanCurvePoint *points, int i) {
+    return (double)(points[i + 1].fan_speed - points[i].fan_speed) /
+           (points[i + 1].temperature - points[i].temperature);
+}
+
+/* Fritsch-Butland slope at point k: zero at the ends and at local extrema,
+ * otherwise a weighted harmonic mean of the neighbouring secants. This keeps
+ * every segment monotone and needs only the adjacent points. */
+static double monotone_slope(const FanCurvePoint *points, int count, int k) {
+    if (k == 0 || k == count - 1)
+        return 0.0;
+    double d0 = secant(points, k - 1);
+    double d1 = secant(points, k);
+    if (d0 * d1 <= 0.0)
+        return 0.0;
+    double h0 = points[k].temperature - points[k - 1].temperature;
+    double h1 = points[k + 1].temperature - points[k].temperature;
+    double w0 = 2.0 * h1 + h0;
+    double w1 = h1 + 2.0 * h0;
+    return (w0 + w1) / (w0 / d0 + w1 / d1);
+}
+
+/* Cubic Hermite on segment i, rounded and kept within 0-100 */
+static int cubic_segment(const FanCurvePoint *points, int count, int i, int temp) {
+    double h = points[i + 1].temperature - points[i].temperature;
+    double s = (temp - points[i].temperature) / h;
+    double s2 = s * s, s3 = s2 * s;
+    double v = (2.0 * s3 - 3.0 * s2 + 1.0) * points[i].fan_speed
+             + (s3 - 2.0 * s2 + s) * h * monotone_slope(points, count, i)
+             + (-2.0 * s3 + 3.0 * s2) * points[i + 1].fan_speed
+             + (s3 - s2) * h * monotone_slope(points, count, i + 1);
+    int speed = (int)(v + 0.5);
+    return speed < 0 ? 0 : speed > 100 ? 100 : speed;
+}
+
+/* Speed between the points around temp, rounded to the nearest percent */
+static int interpolate_points(const FanCurvePoint *points, int count,
+                              CurveInterpolation mode, int temp) {
+    if (count == 0)
         return 30;
 
     /* Below first point: use first point's speed */
-    if (temp <= curve->points[0].temperature)
-        return curve->points[0].fan_speed;
+    if (temp <= points[0].temperature)
+        return points[0].fan_speed;
 
     /* Above last point: use last point's speed */
-    if (temp >= curve->points[curve->point_count - 1].temperature)
-        return curve->points[curve->point_count - 1].fan_speed;
-
-    /* Linear interpolation between points */
-    for (int i = 0; i < curve->point_count - 1; i++) {
-        if (temp >= curve->points[i].temperature &&
-            temp < curve->points[i + 1].temperature) {
-            int t_diff = curve->points[i + 1].temperature -
-                         curve->points[i].temperature;
-            int s_diff = curve->points[i + 1].fan_speed -
-                         curve->points[i].fan_speed;
-            int t_off  = temp - curve->points[i].temperature;
-            return curve->points[i].fan_speed + (t_off * s_diff) / t_diff;
-        }
+    if (temp >= points[count - 1].temperature)
+        return points[count - 1].fan_speed;
+
+    int i = 0;
+    while (temp >= points[i + 1].temperature)
+        i++;
+
+    if (mode == CURVE_STEP)
+        return points[i].fan_speed;
+    if (mode == CURVE_MONOTONE_CUBIC)
+        return cubic_segment(points, count, i, temp);
+
+    int t_diff = points[i + 1].temperature - points[i].temperature;
+    int s_diff = points[i + 1].fan_speed - points[i].fan_speed;
+    int num    = (temp - points[i].temperature) * s_diff;
+    int step   = num >= 0 ? (num + t_diff / 2) / t_diff
+                          : -((-num + t_diff / 2) / t_diff);
+    return points[i].fan_speed + step;
+}
+
+int curve_interpolate(int temp, const FanCurve *curve) {
+    return interpolate_points(curve->points, curve->point_count,
+                              curve->interpolation, temp);
+}
+
+void curve_compile(const FanCurve *curve, CurveTable *table) {
+    int builtin = !curve || curve->point_count == 0;
+    const FanCurvePoint *points = builtin ? default_points : curve->points;
+    int count = builtin ? DEFAULT_POINTS : curve->point_count;
+    CurveInterpolation mode = builtin ? CURVE_LINEAR : curve->interpolation;
+
+    for (int t = CURVE_TEMP_MIN; t <= CURVE_TEMP_MAX; t++)
+        table->speed[t - CURVE_TEMP_MIN] =
+            (unsigned char)interpolate_points(points, count, mode, t);
+    table->hysteresis = builtin ? 0 : curve->hysteresis;
+    table->hold_s = builtin ? 0.0 : curve->hold_s;
+    if (builtin)
+        memset(&table->sensor, 0, sizeof(table->sensor));
+    else
+        table->sensor = curve->sensor;
+}
+
+int curve_lookup(const CurveTable *table, int temp) {
+    if (temp < CURVE_TEMP_MIN)
+        temp = CURVE_TEMP_MIN;
+    else if (temp > CURVE_TEMP_MAX)
+        temp = CURVE_TEMP_MAX;
+    return table->speed[temp - CURVE_TEMP_MIN];
+}
+
+void curve_lookup_batch(const CurveTable *const *tables, const int *temps,
+                        unsigned int *speeds, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++)
+        speeds[i] = (unsigned int)curve_lookup(tables[i], temps[i]);
+}
+
+void curve_state_reset(CurveState *s) {
+    s->primed = 0;
+    s->speed = 0;
+    s->raised_at = 0.0;
+}
+
+int curve_hold(const CurveTable *table, CurveState *s, int speed, int temp,
+               double now) {
+    if (!s->primed || speed >= s->speed) {
+        if (!s->primed || speed > s->speed)
+            s->raised_at = now;
+        s->primed = 1;
+        s->speed = speed;
+        return speed;
     }
 
-    return curve->points[curve->point_count - 1].fan_speed;
+    if (now - s->raised_at < table->hold_s)
+        return s->speed;
+
+    /* Falling: a point is only crossed once temp is hysteresis below it */
+    int down = curve_lookup(table, temp + table->hysteresis);
+    if (down < s->speed)
+        s->speed = down;
+    return s->speed;
+}
+
+int curve_eval(const CurveTable *table, CurveState *s, int temp, double now) {
+    return curve_hold(table, s, curve_lookup(table, temp), temp, now);
 }
 
 int curve_default_interpolate(int temp) {
-    if (temp < 30) return 30;
-    if (temp >= 75) return 100;
-
-    int temps[]  = {30, 40, 50, 60, 70, 75};
-    int speeds[] = {30, 40, 55, 70, 90, 100};
-    int n = 6;
-
-    for (int i = 0; i < n - 1; i++) {
-        if (temp >= temps[i] && temp < temps[i + 1]) {
-            float slope = (float)(speeds[i + 1] - speeds[i]) /
-                          (float)(temps[i + 1] - temps[i]);
-            return speeds[i] + (int)(slope * (float)(temp - temps[i]));
+    static CurveTable table;
+    static int compiled;
+
+    if (!compiled) {
+        curve_compile(NULL, &table);
+        compiled = 1;
+    }
+    return curve_lookup(&table, temp);
+}
+
+int curve_compile_device(const CurveSet *set, unsigned int gpu_index,
+                         unsigned int fan_count, DeviceCurves *out) {
+    out->curve = curve_resolve(set, gpu_index, -1);
+    curve_compile(out->curve, &out->table);
+    out->sensors = out->table.sensor.count ? sensor_mask(&out->table.sensor) : 0;
+    out->fans = NULL;
+    out->fan_count = 0;
+    if (fan_count == 0)
+        return 0;
+
+    out->fans = malloc(fan_count * sizeof(*out->fans));
+    if (!out->fans)
+        return -1;
+    out->fan_count = fan_count;
+    for (unsigned int f = 0; f < fan_count; f++) {
+        const FanCurve *curve = curve_resolve(set, gpu_index, (int)f);
+        if (curve == out->curve)
+            out->fans[f] = out->table;
+        else
+            curve_compile(curve, &out->fans[f]);
+        if (out->fans[f].sensor.count)
+            out->sensors |= sensor_mask(&out->fans[f].sensor);
+    }
+    return 0;
+}
+
+void curve_device_free(DeviceCurves *dc) {
+    free(dc->fans);
+    dc->fans = NULL;
+    dc->fan_count = 0;
+}
+
+const CurveTable *curve_fan_table(const DeviceCurves *dc, unsigned int fan) {
+    return fan < dc->fan_count ? &dc->fans[fan] : &dc->table;
+}
+
+int curve_near_point(const FanCurve *curve, int temp, int margin) {
+    if (!curve || curve->point_count == 0) {
+        for (int i = 0; i < DEFAULT_POINTS; i++) {
+            if (abs(temp - default_points[i].temperature) <= margin)
+                return 1;
         }
+        return 0;
     }
-    return 100;
+    for (int i = 0; i < curve->point_count; i++) {
+        if (abs(temp - curve->points[i].temperature) <= margin)
+            return 1;
+    }
+    return 0;
 }
@@ -0,0 +1,1629 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include "daemon.h"
+#include "nvfd.h"
+#include "evloop.h"
+#include "gpu.h"
+#include "fan.h"
+#include "curve.h"
+#include "config.h"
+#include "watch.h"
+#include "control.h"
+#include "worker.h"
+#include "pid.h"
+#include "smooth.h"
+#include "feedforward.h"
+#include "clocks.h"
+#include "efficiency.h"
+#include "sensor.h"
+#include "governor.h"
+#include "budget.h"
+#include "events.h"
+#include "health.h"
+
+/* Per-GPU control and scheduling state */
+typedef struct {
+    int      managed;       /* nvfd currently owns the fans */
+    FanState fans;          /* owned by the worker while a job runs */
+    double   due;           /* deadline of the step in progress */
+    double   next_due;      /* monotonic seconds */
+    double   interval;      /* current poll interval, seconds */
+    int      quarantined;   /* an NVML call hung; probing with backoff */
+    double   backoff;       /* seconds */
+    Health   health;        /* a lost GPU is only re-probed */
+    int      resetting;     /* shutdown reset submitted */
+    int      last_temp;     /* -1 = no sample yet */
+    double   last_sample;
+    int      input;         /* last control input, raw and filtered, °C */
+    int      input_filtered;
+    double   slope;         /* smoothed °C per second */
+    PidState pid;           /* target and clocks modes */
+    int      setpoint;      /* °C the PID holds */
+    ClockLearner clocks;    /* clocks mode, kept across mode switches */
+    Efficiency  eff;        /* efficiency mode */
+    int      thermal;       /* last sample showed a thermal throttle reason */
+    double   thermal_since;
+    double   thermal_s;     /* time spent throttled while sampled */
+    double   power_s;
+    TempFilter  filter[SENSOR_COUNT]; /* in front of the curve/PID */
+    CurveState  *curve;     /* curve hysteresis and hold, one per fan */
+    SlewLimiter *slew;      /* after it, one per fan */
+    FeedForward ff;         /* load boost, added before the slew limit */
+    Governor gov;           /* power limit, kept across mode switches */
+    int         *wanted;    /* per fan, before the budget and slew limit */
+    unsigned char *direct;  /* per fan, bypasses the budget and slew limit */
+    BudgetDemand demand;    /* this GPU's share of the node's fan budget */
+    double   demand_at;     /* 0 = not counted */
+    unsigned int *speeds;   /* per fan, owned by the worker during a write */
+    const Profile *profile; /* in the current snapshot, NULL = config.json */
+    const Profile *chosen;  /* set by config.json or nvfd profile; rules
+                             * fall back to it */
+    ProcessList *procs;     /* owned by the worker during a scan */
+    double   procs_due;
+    const ProcessRule *ruled;     /* rule in force, NULL = none matched */
+    const ProcessRule *candidate; /* what the last scan matched */
+    double   candidate_since;
+} GpuControl;
+
+/* A power limit the governor had cut when NVML failed, so it could not
+ * be restored before the GPU table was probed again */
+typedef struct {
+    char uuid[NVML_DEVICE_UUID_V2_BUFFER_SIZE];
+    int  orig;
+    int  applied;
+} KeptPower;
+
+typedef struct {
+    EvLoop          loop;
+    ConfigSnapshot *config;    /* last good configuration, never NULL */
+    int             watch_fd;
+    int             control_fd;
+    GpuControl     *gpus;      /* one per detected GPU */
+    WorkerPool     *workers;   /* NVML calls, one thread per GPU */
+    FanWriteStats   fan_stats;
+    unsigned long long wakeups;
+    unsigned long long samples;
+    unsigned long long late;   /* GPUs serviced over one interval late */
+    unsigned long long timeouts;
+    BudgetDemand   *demands;   /* scratch for the budget, one per GPU */
+    EventWaiter    *events;    /* NULL = every GPU is only polled */
+    unsigned long long nvml_events;
+    int             events_stale; /* stopped to re-register a GPU */
+    int             nvml_down; /* the library failed; GPUs wait for rescan() */
+    int             changed;   /* GPUs were added, removed or swapped */
+    double          rescan_at;
+    double          rescan_backoff;
+    unsigned long long reinits;
+    KeptPower      *kept;      /* carried over a re-initialization */
+    unsigned int    kept_count;
+} DaemonState;
+
+/* Sized from the detected topology; fan state from each card's fan count */
+static int gpus_alloc(DaemonState *st) {
+    if (device_count == 0)
+        return 0;
+    st->gpus = calloc(device_count, sizeof(*st->gpus));
+    st->demands = calloc(device_count, sizeof(*st->demands));
+    if (!st->gpus || !st->demands)
+        return -1;
+
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        GpuControl *gc = &st->gpus[i];
+        gc->last_temp = -1;
+        if (!dev)
+            health_lost(&gc->health, 0.0);
+        gc->procs = malloc(sizeof(*gc->procs));
+        if (!gc->procs)
+            return -1;
+        if (fan_state_init(&gc->fans, dev ? dev->fan_count : 0) != 0)
+            return -1;
+        if (gc->fans.count == 0)
+            continue;
+        gc->curve = calloc(gc->fans.count, sizeof(*gc->curve));
+        gc->slew = calloc(gc->fans.count, sizeof(*gc->slew));
+        gc->speeds = calloc(gc->fans.count, sizeof(*gc->speeds));
+        gc->wanted = calloc(gc->fans.count, sizeof(*gc->wanted));
+        gc->direct = calloc(gc->fans.count, sizeof(*gc->direct));
+        if (!gc->curve || !gc->slew || !gc->speeds || !gc->wanted || !gc->direct)
+            return -1;
+    }
+    return 0;
+}
+
+static void gpus_free(DaemonState *st) {
+    if (!st->gpus)
+        return;
+    for (unsigned int i = 0; i < device_count; i++) {
+        fan_state_free(&st->gpus[i].fans);
+        free(st->gpus[i].curve);
+        free(st->gpus[i].slew);
+        free(st->gpus[i].speeds);
+        free(st->gpus[i].wanted);
+        free(st->gpus[i].direct);
+        free(st->gpus[i].procs);
+    }
+    free(st->gpus);
+    free(st->demands);
+    st->gpus = NULL;
+    st->demands = NULL;
+}
+
+/* A GPU running under a profile follows it instead of its config.json entry */
+static const GpuPolicy *gpu_policy(const DaemonState *st, unsigned int i) {
+    const Profile *profile = st->gpus[i].profile;
+    return profile ? &profile->policy : config_snapshot_policy(st->config, i);
+}
+
+static const DeviceCurves *gpu_curves(const DaemonState *st, unsigned int i) {
+    return config_profile_curves(st->config, st->gpus[i].profile, i);
+}
+
+static void filters_reset(GpuControl *gc) {
+    for (int s = 0; s < SENSOR_COUNT; s++)
+        temp_filter_reset(&gc->filter[s]);
+}
+
+/* The GPU's control input: its curve's sensor in curve mode, else the
+ * policy's; no terms means the core */
+static const SensorExpr *gpu_input(const GpuPolicy *policy, const DeviceCurves *curves) {
+    if (policy->mode == FAN_MODE_CURVE && curves->table.sensor.count > 0)
+        return &curves->table.sensor;
+    return &policy->sensor;
+}
+
+/* A board without the sensors an expression names falls back to the core */
+static int read_input(const SensorExpr *expr, const int *temps) {
+    int temp = sensor_eval(expr, temps);
+    return temp >= 0 ? temp : temps[SENSOR_CORE];
+}
+
+/* GPUs due this close together are serviced in the same wakeup */
+#define SCHEDULE_SLACK 0.010
+
+static void poll_range(const ConfigSnapshot *cfg, const GpuPolicy *policy,
+                       double *min_s, double *max_s) {
+    int lo = policy ? policy->poll_min_ms : cfg->poll_min_ms;
+    int hi = policy ? policy->poll_max_ms : cfg->poll_max_ms;
+    *min_s = lo / 1000.0;
+    *max_s = hi / 1000.0;
+}
+
+static void update_slope(GpuControl *gc, int temp, double now) {
+    if (gc->last_temp >= 0 && now > gc->last_sample) {
+        double rate = (temp - gc->last_temp) / (now - gc->last_sample);
+        gc->slope = 0.5 * gc->slope + 0.5 * rate;
+    }
+    gc->last_temp = temp;
+    gc->last_sample = now;
+}
+
+/* Fast while ramping, near a knee, off target or settling; doubling back
+ * off while steady */
+static double next_interval(const GpuControl *gc, const GpuPolicy *policy,
+                            const FanCurve *curve, int temp, int settling,
+                            double min_s, double max_s) {
+    if (policy->mode == FAN_MODE_MANUAL)
+        return max_s; /* output does not depend on temperature */
+
+    int busy;
+    if (policy->mode == FAN_MODE_TARGET || policy->mode == FAN_MODE_CLOCKS)
+        busy = abs(temp - gc->setpoint) > NVFD_POLL_KNEE_MARGIN;
+    else if (policy->mode == FAN_MODE_EFFICIENCY)
+        busy = temp + NVFD_POLL_KNEE_MARGIN >= policy->target;
+    else
+        busy = curve_near_point(curve, temp, NVFD_POLL_KNEE_MARGIN);
+    if (busy || settling || gc->slope >= NVFD_POLL_FAST_SLOPE || gc->slope <= -NVFD_POLL_FAST_SLOPE)
+        return min_s;
+
+    double next = gc->interval * 2.0;
+    if (next < min_s)
+        next = min_s;
+    return next > max_s ? max_s : next;
+}
+
+static void schedule_after(GpuControl *gc, double interval, double now) {
+    gc->interval = interval;
+    /* Advance from the deadline, not from now, so cadence holds */
+    double next = gc->due + interval;
+    gc->next_due = next > now ? next : now + interval;
+}
+
+static void submit(DaemonState *st, unsigned int i, const WorkerJob *job, double now) {
+    GpuControl *gc = &st->gpus[i];
+
+    if (worker_submit(st->workers, i, job, now) != 0) {
+        gc->next_due = now + st->config->poll_min_ms / 1000.0;
+        return;
+    }
+    /* Look again once the call should have returned */
+    gc->next_due = now + NVFD_NVML_TIMEOUT_MS / 1000.0;
+}
+
+/* A limit below the driver default is an admin's cap or one a killed nvfd
+ * left behind; nothing tells them apart, so it is kept and said */
+static void note_power_limits(void) {
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        if (dev && dev->power_orig > 0 && dev->power_orig < dev->power_default)
+            syslog(LOG_NOTICE, "GPU %u: power limit %d W, below the %d W default; "
+                   "governing from it", i, dev->power_orig / 1000,
+                   dev->power_default / 1000);
+    }
+}
+
+/* The original power limit if the governor changed it, else 0 */
+static int restore_power(GpuControl *gc, unsigned int i) {
+    const GpuDevice *dev = gpu_device(i);
+    if (!gc->gov.applied || !dev)
+        return 0;
+    syslog(LOG_NOTICE, "GPU %u: restoring the power limit to %d W", i,
+           dev->power_orig / 1000);
+    gc->gov.limit = 0;
+    return dev->power_orig;
+}
+
+/* Starts a control step: the NVML part runs on the GPU's worker */
+static void begin_step(DaemonState *st, unsigned int i, double now) {
+    const ConfigSnapshot *cfg = st->config;
+    const GpuPolicy *policy = gpu_policy(st, i);
+    GpuControl *gc = &st->gpus[i];
+    double min_s, max_s;
+    poll_range(cfg, policy, &min_s, &max_s);
+
+    WorkerJob job;
+    memset(&job, 0, sizeof(job));
+    if (gc->health.state == HEALTH_LOST) {
+        if (now < gc->health.retry_at) {
+            gc->next_due = gc->health.retry_at;
+            return;
+        }
+        job.kind = WORK_PROBE;
+        job.fans = &gc->fans;
+        submit(st, i, &job, now);
+        return;
+    }
+
+    if (cfg->rule_count > 0 && now >= gc->procs_due) {
+        job.procs = gc->procs;
+        job.cgroups = cfg->rule_cgroups;
+        gc->procs_due = now + cfg->rule_poll_s;
+    }
+
+    /* No config, auto mode or failing readings: let driver control fans */
+    int degraded = gc->health.state == HEALTH_DEGRADED;
+    if (!policy || policy->mode == FAN_MODE_AUTO || (degraded && gc->managed)) {
+        gc->last_temp = -1;
+        gc->demand_at = 0.0;
+        pid_reset(&gc->pid);
+        eff_reset(&gc->eff);
+        filters_reset(gc);
+        for (unsigned int f = 0; f < gc->fans.count; f++) {
+            curve_state_reset(&gc->curve[f]);
+            slew_reset(&gc->slew[f]);
+        }
+        ff_reset(&gc->ff);
+        if (gc->managed || (gc->gov.applied && !gc->gov.failed)) {
+            if (gc->managed)
+                syslog(LOG_INFO, "GPU %u: restoring driver fan control", i);
+            job.kind = WORK_RESET;
+            job.fans = &gc->fans;
+            job.power_set = restore_power(gc, i);
+        } else if (job.procs) {
+            job.kind = WORK_PROCESSES;
+        } else {
+            schedule_after(gc, max_s, now);
+            return;
+        }
+    } else {
+        job.kind = WORK_SAMPLE;
+        job.sensors = sensor_mask(&policy->sensor) | gpu_curves(st, i)->sensors;
+        job.clocks = policy->mode == FAN_MODE_CLOCKS;
+        job.load = job.clocks || policy->mode == FAN_MODE_EFFICIENCY ||
+                   (policy->mode != FAN_MODE_MANUAL && ff_enabled(&policy->feedforward));
+        st->samples++;
+    }
+    submit(st, i, &job, now);
+}
+
+/* The card's fan range narrowed to the policy's */
+static int speed_range(unsigned int i, const GpuPolicy *policy, unsigned int *lo,
+                       unsigned int *hi) {
+    if (fan_get_range(i, lo, hi) != 0)
+        return -1;
+    if ((int)*lo < policy->min_speed)
+        *lo = (unsigned int)policy->min_speed;
+    if ((int)*hi > policy->max_speed)
+        *hi = (unsigned int)policy->max_speed;
+    if (*lo > *hi)
+        *lo = *hi;
+    return 0;
+}
+
+static int target_speed(GpuControl *gc, unsigned int i, const GpuPolicy *policy,
+                        const CurveTable *curve, int temp, const WorkerJob *sample,
+                        double dt) {
+    unsigned int lo, hi;
+    /* Limit the PID itself so its integral does not wind up against them */
+    if (speed_range(i, policy, &lo, &hi) != 0)
+        return 100;
+
+    gc->setpoint = policy->target;
+    if (policy->mode == FAN_MODE_CLOCKS) {
+        gc->setpoint = clock_update(&gc->clocks, &policy->clocks, policy->target,
+                                    sample->temps[SENSOR_CORE], sample->sm_clock,
+                                    sample->reasons_ok ? sample->reasons : 0,
+                                    sample->util);
+        /* Already losing clocks to heat: all the fan allowed, and the PID
+         * takes over from there once the throttle clears */
+        if (gc->thermal) {
+            pid_reset(&gc->pid);
+            return (int)hi;
+        }
+    }
+
+    /* Take over from whatever the fans run at now, else from the curve */
+    int initial = gc->fans.count > 0 && gc->fans.speed[0] >= 0
+                  ? gc->fans.speed[0]
+                  : curve_lookup(curve, temp);
+
+    return pid_update(&gc->pid, &policy->gains, gc->setpoint, temp, dt,
+                      (int)lo, (int)hi, initial);
+}
+
+/* Searches about the curve's speed for the least board plus fan power */
+static int efficient_speed(GpuControl *gc, unsigned int i, const GpuPolicy *policy,
+                           const CurveTable *curve, int temp, const WorkerJob *sample,
+                           double dt, double now) {
+    int curve_speed = curve_lookup(curve, temp);
+    unsigned int lo, hi;
+    if (speed_range(i, policy, &lo, &hi) != 0)
+        return curve_speed;
+    return eff_update(&gc->eff, &policy->efficiency, policy->target, temp,
+                      sample->power, sample->util, gc->fans.count, curve_speed,
+                      (int)lo, (int)hi, dt, now);
+}
+
+static double load_boost(GpuControl *gc, const GpuPolicy *policy,
+                         const WorkerJob *sample, double dt) {
+    if (policy->mode == FAN_MODE_MANUAL || !ff_enabled(&policy->feedforward)) {
+        ff_reset(&gc->ff);
+        return 0.0;
+    }
+
+    double power_pct = sample->power >= 0 && sample->power_limit > 0
+                       ? 100.0 * sample->power / sample->power_limit : -1.0;
+    return ff_update(&gc->ff, &policy->feedforward, power_pct, sample->util, dt);
+}
+
+/* The zone's raw and filtered temperature from each member's latest
+ * input; members not sampled lately (auto, quarantined) drop out */
+static void zone_inputs(const DaemonState *st, const Zone *zone, double now,
+                        int *raw, int *filtered) {
+    int raws[ZONE_MEMBERS_MAX], filtereds[ZONE_MEMBERS_MAX];
+    for (int m = 0; m < zone->member_count; m++) {
+        int j = zone->members[m].gpu;
+        const GpuControl *gc = j >= 0 ? &st->gpus[j] : NULL;
+        int fresh = gc && gc->last_temp >= 0 && !gc->quarantined &&
+                    now - gc->last_sample <= NVFD_ZONE_STALE_S;
+        raws[m] = fresh ? gc->input : -1;
+        filtereds[m] = fresh ? gc->input_filtered : -1;
+    }
+    *raw = zone_combine(zone, raws);
+    *filtered = zone_combine(zone, filtereds);
+}
+
+/* GPUs whose latest demand still counts against the node's fan budget */
+static int budget_counted(const GpuControl *gc, double now) {
+    return gc->demand_at > 0.0 && now - gc->demand_at <= NVFD_BUDGET_STALE_S;
+}
+
+/* Shares the node's fan budget out by headroom, each GPU's latest demand
+ * against the others'. Scales this GPU's wanted speeds down to its grant;
+ * 1 if that took anything away. */
+static int apply_budget(DaemonState *st, unsigned int i, const GpuPolicy *policy,
+                        int ctl_temp, int fan_floor, double now) {
+    GpuControl *gc = &st->gpus[i];
+    int budget = st->config->fan_budget;
+    if (budget <= 0 || gc->fans.count == 0) {
+        gc->demand_at = 0.0;
+        return 0;
+    }
+
+    BudgetDemand *d = &gc->demand;
+    d->want = d->floor = 0;
+    for (unsigned int f = 0; f < gc->fans.count; f++) {
+        d->want += gc->wanted[f];
+        d->floor += gc->direct[f] || gc->wanted[f] < fan_floor ? gc->wanted[f] : fan_floor;
+    }
+    d->headroom = policy->smooth.critical_temp - ctl_temp;
+    gc->demand_at = now;
+
+    unsigned int n = 0, self = 0;
+    for (unsigned int j = 0; j < device_count; j++) {
+        const GpuControl *other = &st->gpus[j];
+        if (!budget_counted(other, now))
+            continue;
+        if (j == i)
+            self = n;
+        st->demands[n++] = other->demand;
+    }
+    budget_allocate(st->demands, n, budget);
+    d->grant = st->demands[self].grant;
+    if (d->grant >= d->want)
+        return 0;
+
+    for (unsigned int f = 0; f < gc->fans.count; f++) {
+        if (!gc->direct[f])
+            gc->wanted[f] = budget_share(d, gc->wanted[f], fan_floor);
+    }
+    return 1;
+}
+
+/* Past what the fans can do, the power limit is the lever left. Returns
+ * the limit to set with the next write, 0 = leave it. */
+static int govern_power(GpuControl *gc, unsigned int i, const GpuPolicy *policy,
+                        int temp, int saturated, double now) {
+    const GpuDevice *dev = gpu_device(i);
+    if (!dev || gc->gov.failed)
+        return 0;
+
+    int limit = gov_update(&gc->gov, &policy->governor, temp, saturated,
+                           dev->power_orig, dev->power_min, now);
+    if (limit == gc->gov.applied)
+        return 0;
+    if (limit == 0) {
+        syslog(LOG_NOTICE, "GPU %u: %d C, power limit back to %d W", i, temp,
+               dev->power_orig / 1000);
+        return dev->power_orig;
+    }
+    if (gc->gov.applied == 0 || limit < gc->gov.applied)
+        syslog(LOG_NOTICE, "GPU %u: %d C with fans at their ceiling, power limit "
+               "down to %d W", i, temp, limit / 1000);
+    else
+        syslog(LOG_NOTICE, "GPU %u: %d C, power limit up to %d W", i, temp,
+               limit / 1000);
+    return limit;
+}
+
+/* Throttle time counts in every mode the daemon samples in */
+static void account_throttle(GpuControl *gc, unsigned int i, const WorkerJob *sample,
+                             double dt, double now) {
+    if (!sample->reasons_ok)
+        return;
+
+    int thermal = clock_thermal(sample->reasons);
+    if (gc->thermal)
+        gc->thermal_s += dt;
+    if (clock_power(sample->reasons))
+        gc->power_s += dt;
+
+    if (thermal && !gc->thermal) {
+        syslog(LOG_NOTICE, "GPU %u: thermal throttling at %d C (reasons 0x%llx)",
+               i, sample->temps[SENSOR_CORE], sample->reasons);
+        gc->thermal_since = now;
+    } else if (!thermal && gc->thermal) {
+        syslog(LOG_NOTICE, "GPU %u: thermal throttling over after %.1f s",
+               i, now - gc->thermal_since);
+    }
+    gc->thermal = thermal;
+}
+
+/* Throttling shows up as a clock event, so steady polls can be further apart */
+static int clock_events(const DaemonState *st, unsigned int i) {
+    return (events_registered(st->events, i) & nvmlEventTypeClock) != 0;
+}
+
+static void finish_sample(DaemonState *st, unsigned int i, const WorkerJob *sample,
+                          double now) {
+    const ConfigSnapshot *cfg = st->config;
+    const GpuPolicy *policy = gpu_policy(st, i);
+    GpuControl *gc = &st->gpus[i];
+    double min_s, max_s;
+    poll_range(cfg, policy, &min_s, &max_s);
+
+    /* Switched to auto while sampling; the next step resets the fans */
+    if (!policy || policy->mode == FAN_MODE_AUTO) {
+        schedule_after(gc, min_s, now);
+        return;
+    }
+    const DeviceCurves *curves = gpu_curves(st, i);
+    const SensorExpr *input = gpu_input(policy, curves);
+    int temp = read_input(input, sample->temps);
+    if (temp < 0) {
+        schedule_after(gc, gc->health.state == HEALTH_DEGRADED ? max_s : min_s, now);
+        return;
+    }
+    double dt = gc->last_temp >= 0 ? now - gc->last_sample : 0.0;
+    update_slope(gc, temp, now);
+    account_throttle(gc, i, sample, dt, now);
+
+    /* Each sensor is filtered on its own so that expressions combine
+     * filtered readings. Past the critical temperature the raw reading
+     * drives the fans directly, without filter lag or slew limits. */
+    const SmoothParams *sp = &policy->smooth;
+    int filtered[SENSOR_COUNT];
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        if (sample->temps[s] >= 0) {
+            filtered[s] = temp_filter_update(&gc->filter[s], sp, sample->temps[s], dt);
+        } else {
+            temp_filter_reset(&gc->filter[s]);
+            filtered[s] = -1;
+        }
+    }
+    gc->input = temp;
+    gc->input_filtered = read_input(input, filtered);
+
+    /* In a zone every member follows the zone's temperature instead */
+    int member;
+    const Zone *zone = config_snapshot_zone(cfg, i, &member);
+    int ctl_raw = temp, ctl_filtered = gc->input_filtered;
+    if (zone)
+        zone_inputs(st, zone, now, &ctl_raw, &ctl_filtered);
+    int critical = ctl_raw >= sp->critical_temp;
+    int ctl_temp = critical ? ctl_raw : ctl_filtered;
+
+    int pid_mode = policy->mode == FAN_MODE_TARGET || policy->mode == FAN_MODE_CLOCKS;
+    int wanted = 0;
+    if (policy->mode == FAN_MODE_MANUAL)
+        wanted = policy->speed;
+    else if (pid_mode)
+        wanted = target_speed(gc, i, policy, &curves->table, ctl_temp, sample, dt);
+    else if (policy->mode == FAN_MODE_EFFICIENCY)
+        wanted = efficient_speed(gc, i, policy, &curves->table, ctl_temp, sample, dt, now);
+    if (!pid_mode)
+        pid_reset(&gc->pid);
+    if (policy->mode != FAN_MODE_EFFICIENCY)
+        eff_reset(&gc->eff);
+
+    double boost = load_boost(gc, policy, sample, dt);
+    int settling = boost >= 1.0 || gc->thermal;
+
+    /* Fans may follow curves of their own; everything else is per GPU */
+    for (unsigned int f = 0; f < gc->fans.count; f++) {
+        int fan_wanted = wanted;
+        int fan_critical = critical;
+        if (policy->mode == FAN_MODE_CURVE && zone) {
+            fan_wanted = curve_eval(curve_fan_table(curves, f), &gc->curve[f],
+                                    ctl_temp, now);
+        } else if (policy->mode == FAN_MODE_CURVE) {
+            const CurveTable *table = curve_fan_table(curves, f);
+            const SensorExpr *expr = table->sensor.count > 0 ? &table->sensor : input;
+            int fan_temp = read_input(expr, sample->temps);
+            fan_critical = critical || fan_temp >= sp->critical_temp;
+            if (!fan_critical)
+                fan_temp = read_input(expr, filtered);
+            fan_wanted = curve_eval(table, &gc->curve[f], fan_temp, now);
+        } else {
+            curve_state_reset(&gc->curve[f]);
+        }
+        fan_wanted += (int)(boost + 0.5);
+        if (fan_wanted > 100)
+            fan_wanted = 100;
+        if (!fan_critical && fan_wanted < policy->min_speed)
+            fan_wanted = policy->min_speed;
+        if (!fan_critical && fan_wanted > policy->max_speed)
+            fan_wanted = policy->max_speed;
+
+        /* A manual speed is a direct order, not a control output, and a
+         * throttling GPU in clocks mode gets its fans at once */
+        gc->wanted[f] = fan_wanted;
+        gc->direct[f] = fan_critical || policy->mode == FAN_MODE_MANUAL ||
+                        (policy->mode == FAN_MODE_CLOCKS && gc->thermal);
+    }
+
+    /* Saturated: every fan already at the card's maximum, max_speed, or
+     * what the node's budget allows it */
+    unsigned int lo = 0, hi = 100;
+    fan_get_range(i, &lo, &hi);
+    int ceiling = (int)hi < policy->max_speed ? (int)hi : policy->max_speed;
+    int fan_floor = (int)lo > policy->min_speed ? (int)lo : policy->min_speed;
+    int limited = apply_budget(st, i, policy, ctl_temp, fan_floor, now);
+    int saturated = gc->fans.count > 0;
+
+    for (unsigned int f = 0; f < gc->fans.count; f++) {
+        gc->speeds[f] = (unsigned int)slew_update(&gc->slew[f], sp, gc->wanted[f], dt,
+                                                  gc->direct[f]);
+        /* Keep sampling fast while the output is still catching up or a
+         * boost is still decaying */
+        if (!slew_settled(&gc->slew[f], gc->wanted[f]))
+            settling = 1;
+        if (!limited && (int)gc->speeds[f] < ceiling)
+            saturated = 0;
+    }
+    /* Every fan follows the same PID output; the first speaks for all */
+    if (pid_mode && gc->fans.count > 0 && !gc->direct[0])
+        pid_track(&gc->pid, gc->wanted[0], (int)gc->speeds[0]);
+    if (clock_events(st, i))
+        max_s *= NVFD_EVENT_POLL_STRETCH;
+    gc->interval = next_interval(gc, policy, curves->curve, ctl_temp, settling,
+                                 min_s, max_s);
+
+    WorkerJob job;
+    memset(&job, 0, sizeof(job));
+    job.kind = WORK_WRITE;
+    job.speeds = gc->speeds;
+    job.deadband = (unsigned int)cfg->deadband;
+    job.reassert_s = (unsigned int)cfg->reassert_s;
+    job.now = now;
+    job.fans = &gc->fans;
+    job.power_set = govern_power(gc, i, policy, temp, saturated, now);
+    submit(st, i, &job, now);
+}
+
+static const char *configured_profile(const ConfigSnapshot *cfg, unsigned int i) {
+    const GpuPolicy *policy = config_snapshot_policy(cfg, i);
+    return policy ? policy->profile : "";
+}
+
+/* Drops what the previous policy left in the controllers */
+static void switch_profile(DaemonState *st, unsigned int i, const Profile *profile) {
+    GpuControl *gc = &st->gpus[i];
+    if (gc->profile == profile)
+        return;
+
+    gc->profile = profile;
+    pid_reset(&gc->pid);
+    eff_reset(&gc->eff);
+    ff_reset(&gc->ff);
+    for (unsigned int f = 0; f < gc->fans.count; f++)
+        curve_state_reset(&gc->curve[f]);
+    gc->next_due = 0.0;
+    gc->interval = 0.0;
+    syslog(LOG_INFO, "GPU %u: %s%s", i, profile ? "profile " : "following config.json",
+           profile ? profile->name : "");
+}
+
+/* Follows what runs on the GPU. A new verdict must hold for
+ * rule_debounce_s before it takes effect, so a short job or a restart
+ * does not flip the fans between policies. Only a change of verdict
+ * switches: a profile chosen by hand meanwhile stays until then. */
+static void apply_rules(DaemonState *st, unsigned int i, const ProcessList *procs,
+                        double now) {
+    GpuControl *gc = &st->gpus[i];
+    if (!procs->ok)
+        return; /* NVML could not say; keep the current verdict */
+
+    const ProcInfo *proc = NULL;
+    const ProcessRule *match = config_match_rules(st->config, procs, &proc);
+    if (match != gc->candidate) {
+        gc->candidate = match;
+        gc->candidate_since = now;
+    }
+    if (match == gc->ruled || now - gc->candidate_since < st->config->rule_debounce_s)
+        return;
+
+    gc->ruled = match;
+    if (match) {
+        syslog(LOG_INFO, "GPU %u: %s (pid %u) matches a rule", i, proc->comm, proc->pid);
+        switch_profile(st, i, match->profile);
+    } else {
+        syslog(LOG_INFO, "GPU %u: no process matches a rule any more", i);
+        switch_profile(st, i, gc->chosen);
+    }
+}
+
+/* A refused limit (no root, or a board without power management) stops
+ * the governor for this GPU until the next reload */
+static void finish_power(GpuControl *gc, unsigned int i, const WorkerJob *job) {
+    const GpuDevice *dev = gpu_device(i);
+    if (job->power_set <= 0 || !dev)
+        return;
+    if (!job->power_ok) {
+        syslog(LOG_WARNING, "GPU %u: cannot set the power limit to %d W; "
+               "governor off", i, job->power_set / 1000);
+        gc->gov.failed = 1;
+        gc->gov.limit = gc->gov.applied;
+        return;
+    }
+    gc->gov.applied = job->power_set == dev->power_orig ? 0 : job->power_set;
+}
+
+/* The library itself failed, e.g. the driver was reloaded: every handle
+ * is stale, so the GPUs wait until rescan() has initialized NVML again */
+static void nvml_failed(DaemonState *st, nvmlReturn_t status, double now) {
+    if (st->nvml_down)
+        return;
+    syslog(LOG_ERR, "NVML failed (%s); re-initializing", nvmlErrorString(status));
+    st->nvml_down = 1;
+    st->rescan_at = now;
+    st->rescan_backoff = NVFD_HEALTH_RETRY_MIN_S;
+}
+
+/* 0 if the sample is not worth using: the GPU or the library is gone */
+static int track_health(DaemonState *st, unsigned int i, const WorkerJob *job,
+                        double now) {
+    GpuControl *gc = &st->gpus[i];
+    nvmlReturn_t status = (nvmlReturn_t)job->status;
+    GpuFault fault = gpu_fault(status);
+    HealthState was = gc->health.state;
+    double since = gc->health.since;
+
+    if (fault == GPU_FAULT_LIBRARY) {
+        nvml_failed(st, status, now);
+        return 0;
+    }
+    HealthState state = health_sample(&gc->health, fault, now);
+    if (state == HEALTH_LOST) {
+        syslog(LOG_ERR, "GPU %u: lost (%s); probing again in %.0f s", i,
+               nvmlErrorString(status), gc->health.backoff);
+        gc->managed = 0;
+        gc->last_temp = -1;
+        gc->demand_at = 0.0;
+        gc->next_due = gc->health.retry_at;
+        return 0;
+    }
+    if (state == HEALTH_DEGRADED && was != HEALTH_DEGRADED)
+        syslog(LOG_WARNING, "GPU %u: %d readings failed in a row (%s); "
+               "restoring driver fan control", i, gc->health.failures,
+               nvmlErrorString(status));
+    else if (state == HEALTH_OK && was == HEALTH_DEGRADED)
+        syslog(LOG_NOTICE, "GPU %u: readings back after %.0f s", i, now - since);
+    return 1;
+}
+
+/* Polling only from here on, e.g. after the waiter failed */
+static void events_close(DaemonState *st) {
+    if (!st->events)
+        return;
+    evloop_del_fd(&st->loop, events_fd(st->events));
+    if (events_stop(st->events) != 0)
+        syslog(LOG_WARNING, "NVML event waiter stuck; leaving it behind");
+    st->events = NULL;
+}
+
+/* A lost GPU that answers again starts over; one that turns out to be a
+ * different card means the GPUs have to be enumerated again */
+static void finish_probe(DaemonState *st, unsigned int i, const WorkerJob *job,
+                         double now) {
+    GpuControl *gc = &st->gpus[i];
+    nvmlReturn_t status = (nvmlReturn_t)job->status;
+    double since = gc->health.since;
+
+    if (gpu_fault(status) == GPU_FAULT_LIBRARY) {
+        nvml_failed(st, status, now);
+        return;
+    }
+    if (job->probe > 0) {
+        syslog(LOG_NOTICE, "GPU %u: another GPU answers at this index; "
+               "re-enumerating", i);
+        st->changed = 1;
+        st->rescan_at = now;
+        gc->next_due = now + gc->health.backoff;
+        return;
+    }
+    if (job->probe == 0) {
+        /* The waiter reads the table and matches events by handle, which
+         * may have changed: stop it, and start it again with the new one */
+        if (st->events) {
+            events_close(st);
+            st->events_stale = 1;
+        }
+        gpu_adopt(i, &job->probed);
+        health_probe(&gc->health, 1, now);
+        syslog(LOG_NOTICE, "GPU %u: back after %.0f s", i, now - since);
+        gc->last_temp = -1;
+        pid_reset(&gc->pid);
+        eff_reset(&gc->eff);
+        gov_reset(&gc->gov);
+        filters_reset(gc);
+        for (unsigned int f = 0; f < gc->fans.count; f++) {
+            curve_state_reset(&gc->curve[f]);
+            slew_reset(&gc->slew[f]);
+        }
+        ff_reset(&gc->ff);
+        gc->next_due = now;
+        return;
+    }
+    health_probe(&gc->health, 0, now);
+    gc->next_due = gc->health.retry_at;
+}
+
+static void finish_job(DaemonState *st, unsigned int i, const WorkerJob *job, double now) {
+    GpuControl *gc = &st->gpus[i];
+    double min_s, max_s;
+    poll_range(st->config, gpu_policy(st, i), &min_s, &max_s);
+
+    if (job->kind == WORK_WRITE) {
+        st->fan_stats.writes += job->stats.writes;
+        st->fan_stats.skipped += job->stats.skipped;
+        st->fan_stats.failures += job->stats.failures;
+        gc->managed = 1;
+    }
+    finish_power(gc, i, job);
+
+    if (gc->quarantined) {
+        /* The hung call finally returned; its result is stale, so resample */
+        syslog(LOG_NOTICE, "GPU %u: NVML responding again, leaving quarantine", i);
+        gc->quarantined = 0;
+        gc->last_temp = -1;
+        filters_reset(gc);
+        ff_reset(&gc->ff);
+        gc->next_due = now;
+        return;
+    }
+
+    switch (job->kind) {
+    case WORK_SAMPLE:
+        if (track_health(st, i, job, now))
+            finish_sample(st, i, job, now);
+        break;
+    case WORK_WRITE:
+        schedule_after(gc, gc->interval, now);
+        break;
+    case WORK_RESET:
+        gc->managed = 0;
+        schedule_after(gc, max_s, now);
+        break;
+    case WORK_PROCESSES:
+        schedule_after(gc, max_s, now);
+        break;
+    case WORK_PROBE:
+        finish_probe(st, i, job, now);
+        break;
+    }
+    if (job->procs)
+        apply_rules(st, i, job->procs, now);
+}
+
+static void collect_results(DaemonState *st) {
+    double now = evloop_now();
+    WorkerJob job;
+
+    for (unsigned int i = 0; i < device_count; i++) {
+        if (worker_collect(st->workers, i, &job))
+            finish_job(st, i, &job, now);
+    }
+}
+
+/* A call still outstanding past its deadline quarantines the GPU; others
+ * keep their cadence while it is probed again with exponential backoff */
+static void check_stuck(DaemonState *st, unsigned int i, double since, double now) {
+    GpuControl *gc = &st->gpus[i];
+    double timeout = NVFD_NVML_TIMEOUT_MS / 1000.0;
+
+    if (now - since < timeout) {
+        gc->next_due = since + timeout;
+        return;
+    }
+
+    if (!gc->quarantined) {
+        gc->quarantined = 1;
+        gc->backoff = NVFD_QUARANTINE_MIN_S;
+        st->timeouts++;
+        syslog(LOG_WARNING, "GPU %u: NVML call stuck for %.1f s, quarantining",
+               i, now - since);
+    } else {
+        gc->backoff *= 2.0;
+        if (gc->backoff > NVFD_QUARANTINE_MAX_S)
+            gc->backoff = NVFD_QUARANTINE_MAX_S;
+    }
+    gc->next_due = now + gc->backoff;
+}
+
+static void arm_earliest(DaemonState *st) {
+    double earliest = 0.0;
+
+    for (unsigned int i = 0; i < device_count && !st->nvml_down; i++) {
+        if (earliest == 0.0 || st->gpus[i].next_due < earliest)
+            earliest = st->gpus[i].next_due;
+    }
+    if (st->rescan_at > 0.0 && (earliest == 0.0 || st->rescan_at < earliest))
+        earliest = st->rescan_at;
+    if (earliest > 0.0)
+        evloop_arm(&st->loop, earliest);
+}
+
+/* Quarantined and lost GPUs keep their own schedule */
+static int held_back(const GpuControl *gc) {
+    return gc->quarantined || gc->health.state == HEALTH_LOST;
+}
+
+static void pull_all(DaemonState *st, double now) {
+    int due = 0;
+    for (unsigned int i = 0; i < device_count && !due; i++)
+        due = st->gpus[i].next_due <= now + SCHEDULE_SLACK;
+    for (unsigned int i = 0; due && i < device_count; i++) {
+        GpuControl *gc = &st->gpus[i];
+        if (!held_back(gc) && gc->next_due > now)
+            gc->next_due = now;
+    }
+}
+
+/* A zone is sampled and written as one batch: when one member is due,
+ * so are the others, unless quarantined. Under a node fan budget the
+ * whole node is one batch, so each tick splits it over fresh demands. */
+static void pull_zones(DaemonState *st, double now) {
+    if (st->config->fan_budget > 0) {
+        pull_all(st, now);
+        return;
+    }
+    for (int z = 0; z < st->config->zone_count; z++) {
+        const Zone *zone = &st->config->zones[z];
+        int due = 0;
+        for (int m = 0; m < zone->member_count && !due; m++) {
+            int j = zone->members[m].gpu;
+            due = j >= 0 && st->gpus[j].next_due <= now + SCHEDULE_SLACK;
+        }
+        for (int m = 0; due && m < zone->member_count; m++) {
+            int j = zone->members[m].gpu;
+            if (j >= 0 && !held_back(&st->gpus[j]) && st->gpus[j].next_due > now)
+                st->gpus[j].next_due = now;
+        }
+    }
+}
+
+/* Services every GPU that is due and arms the timer for the next one */
+static void run_due(DaemonState *st) {
+    collect_results(st);
+
+    /* Stale handles: nothing to do until rescan() */
+    if (st->nvml_down) {
+        arm_earliest(st);
+        return;
+    }
+    double now = evloop_now();
+    pull_zones(st, now);
+    for (unsigned int i = 0; i < device_count; i++) {
+        GpuControl *gc = &st->gpus[i];
+        if (gc->next_due > now + SCHEDULE_SLACK)
+            continue;
+
+        double since;
+        if (worker_busy(st->workers, i, &since)) {
+            check_stuck(st, i, since, now);
+            continue;
+        }
+
+        if (gc->next_due > 0.0 && now - gc->next_due > gc->interval)
+            st->late++;
+        gc->due = gc->next_due;
+        begin_step(st, i, now);
+    }
+
+    arm_earliest(st);
+}
+
+/* Makes every GPU due now, e.g. after the configuration changed */
+static void reschedule_all(DaemonState *st) {
+    for (unsigned int i = 0; i < device_count; i++) {
+        st->gpus[i].next_due = 0.0;
+        st->gpus[i].interval = 0.0;
+    }
+    run_due(st);
+}
+
+/* An NVML event makes its GPU due now, though no sooner than poll_min_ms
+ * after its last sample; that sample sees what changed */
+static void on_events(EvLoop *loop, int fd, uint32_t events, void *arg) {
+    (void)loop;
+    (void)fd;
+    (void)events;
+    DaemonState *st = arg;
+    GpuEvent queue[EVENTS_QUEUE_MAX];
+    unsigned long long dropped;
+    unsigned int n = events_read(st->events, queue, EVENTS_QUEUE_MAX, &dropped);
+    double now = evloop_now();
+
+    st->nvml_events += n + dropped;
+    for (unsigned int k = 0; k < n; k++) {
+        const GpuEvent *ev = &queue[k];
+        GpuControl *gc = &st->gpus[ev->gpu_index];
+        if (ev->type & nvmlEventTypeXidCriticalError)
+            syslog(LOG_WARNING, "GPU %u: Xid %llu reported by the driver",
+                   ev->gpu_index, ev->data);
+        else if (ev->type & nvmlEventTypePowerSourceChange)
+            syslog(LOG_NOTICE, "GPU %u: %s", ev->gpu_index, events_name(ev->type));
+        if (held_back(gc))
+            continue;
+
+        double min_s, max_s;
+        poll_range(st->config, gpu_policy(st, ev->gpu_index), &min_s, &max_s);
+        double earliest = gc->last_temp >= 0 ? gc->last_sample + min_s : now;
+        if (earliest < now)
+            earliest = now;
+        if (gc->next_due > earliest) {
+            gc->next_due = earliest;
+            gc->interval = 0.0;
+        }
+    }
+
+    if (events_failed(st->events)) {
+        syslog(LOG_WARNING, "NVML stopped delivering events; polling only");
+        events_close(st);
+    }
+    run_due(st);
+}
+
+/* Without events every GPU is still polled */
+static void start_events(DaemonState *st) {
+    st->events = events_start();
+    if (st->events &&
+        evloop_add_fd(&st->loop, events_fd(st->events), EPOLLIN, on_events, st) != 0) {
+        events_stop(st->events);
+        st->events = NULL;
+    }
+    if (st->events) {
+        unsigned int count = 0;
+        for (unsigned int i = 0; i < device_count; i++)
+            count += events_registered(st->events, i) != 0;
+        syslog(LOG_INFO, "NVML events registered for %u of %u GPUs", count, device_count);
+    } else {
+        syslog(LOG_INFO, "NVML events unavailable; polling only");
+    }
+}
+
+/* Re-registers once finish_probe() has swapped a handle */
+static void restart_events(DaemonState *st) {
+    if (!st->events_stale)
+        return;
+    st->events_stale = 0;
+    start_events(st);
+}
+
+static void on_workers(EvLoop *loop, int fd, uint32_t events, void *arg) {
+    (void)loop;
+    (void)fd;
+    (void)events;
+    DaemonState *st = arg;
+
+    worker_pool_drain_fd(st->workers);
+    collect_results(st);
+    restart_events(st);
+    arm_earliest(st);
+}
+
+/* Resets fans through the workers so a hung GPU cannot block shutdown */
+static void reset_all(DaemonState *st) {
+    double now = evloop_now();
+    double deadline = now + NVFD_SHUTDOWN_GRACE_MS / 1000.0;
+    WorkerJob job;
+
+    for (unsigned int i = 0; i < device_count; i++) {
+        GpuControl *gc = &st->gpus[i];
+        worker_collect(st->workers, i, &job);
+        memset(&job, 0, sizeof(job));
+        job.kind = WORK_RESET;
+        job.fans = &gc->fans;
+        job.power_set = restore_power(gc, i);
+        gc->resetting = worker_submit(st->workers, i, &job, now) == 0;
+        if (!gc->resetting)
+            syslog(LOG_WARNING, "GPU %u: unresponsive, leaving fans as they are", i);
+    }
+    for (unsigned int i = 0; i < device_count; i++) {
+        if (st->gpus[i].resetting && worker_wait(st->workers, i, deadline) != 0)
+            syslog(LOG_WARNING, "GPU %u: timed out resetting fans", i);
+    }
+}
+
+/* The rule in cfg that picks the same profile as old, NULL if none does */
+static const ProcessRule *rebind_rule(const ConfigSnapshot *cfg, const ProcessRule *old) {
+    for (int r = 0; old && r < cfg->rule_count; r++) {
+        if (strcmp(cfg->rules[r].name, old->name) == 0)
+            return &cfg->rules[r];
+    }
+    return NULL;
+}
+
+/* Points each GPU at its profile in st->config, which replaced prev (NULL at
+ * startup). A choice made at run time, by hand or by a rule, survives
+ * reloads unless the GPU's configured "profile" changed or the rule that
+ * made it is gone. */
+static void rebind_profiles(DaemonState *st, const ConfigSnapshot *prev) {
+    for (unsigned int i = 0; i < device_count; i++) {
+        GpuControl *gc = &st->gpus[i];
+        const char *want = configured_profile(st->config, i);
+        int kept = prev && strcmp(want, configured_profile(prev, i)) == 0;
+        if (kept)
+            want = gc->chosen ? gc->chosen->name : "";
+
+        gc->chosen = want[0] ? config_snapshot_profile(st->config, want) : NULL;
+        if (want[0] && !gc->chosen)
+            syslog(LOG_WARNING, "GPU %u: profile %s is gone; following config.json",
+                   i, want);
+
+        const ProcessRule *ruled = rebind_rule(st->config, gc->ruled);
+        const Profile *profile = NULL;
+        if (kept && gc->profile && (ruled || !gc->ruled))
+            profile = config_snapshot_profile(st->config, gc->profile->name);
+        if (!profile)
+            profile = gc->chosen;
+        gc->ruled = ruled;
+        gc->candidate = ruled;
+
+        /* Compare names: the old pointer belongs to prev */
+        if (profile && gc->profile && strcmp(profile->name, gc->profile->name) == 0)
+            gc->profile = profile;
+        else
+            switch_profile(st, i, profile);
+    }
+}
+
+/* 1 while a worker or an abandoned event waiter is inside NVML: both read
+ * the device table, and the worker its GPU's fan state */
+static int threads_in_nvml(DaemonState *st) {
+    double since;
+    for (unsigned int i = 0; st->workers && i < device_count; i++) {
+        if (worker_busy(st->workers, i, &since)) {
+            syslog(LOG_WARNING, "GPU %u: worker inside NVML for %.0f s; "
+                   "re-initializing once it returns", i, evloop_now() - since);
+            return 1;
+        }
+    }
+    if (events_left_behind() > 0) {
+        syslog(LOG_WARNING, "NVML event waiter still inside NVML; "
+               "re-initializing once it returns");
+        return 1;
+    }
+    return 0;
+}
+
+/* Before the GPU table goes: the limits still cut, which probing again
+ * would take for the ones to restore */
+static void keep_power(DaemonState *st) {
+    if (!st->gpus)
+        return;
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        if (!st->gpus[i].gov.applied || !dev || !dev->uuid[0])
+            continue;
+        KeptPower *kept = realloc(st->kept, (st->kept_count + 1) * sizeof(*kept));
+        if (!kept)
+            return;
+        st->kept = kept;
+        kept += st->kept_count++;
+        memcpy(kept->uuid, dev->uuid, sizeof(kept->uuid));
+        kept->orig = dev->power_orig;
+        kept->applied = st->gpus[i].gov.applied;
+    }
+}
+
+/* After it is back: the governor goes on from the cut limits */
+static void readopt_power(DaemonState *st) {
+    for (unsigned int k = 0; k < st->kept_count; k++) {
+        int i = gpu_find_uuid(st->kept[k].uuid);
+        const GpuDevice *dev = i >= 0 ? gpu_device((unsigned int)i) : NULL;
+        if (!dev || dev->power_orig <= 0)
+            continue;
+        gpu_keep_power((unsigned int)i, st->kept[k].orig);
+        st->gpus[i].gov.applied = st->kept[k].applied;
+        st->gpus[i].gov.limit = st->kept[k].applied;
+    }
+    free(st->kept);
+    st->kept = NULL;
+    st->kept_count = 0;
+}
+
+/* Tears down everything sized by the GPU count, initializes NVML again and
+ * builds it back for what NVML finds now. Runtime profile choices start
+ * over from config.json. -1 leaves no GPUs until the next attempt. */
+static int reinit_nvml(DaemonState *st) {
+    events_close(st);
+    if (!st->nvml_down)
+        reset_all(st);
+    /* Shutting NVML down and freeing the table under them is not safe;
+     * rescan() tries again after its backoff */
+    if (threads_in_nvml(st))
+        return -1;
+    if (st->workers)
+        evloop_del_fd(&st->loop, worker_pool_fd(st->workers));
+    worker_pool_destroy(st->workers);   /* every worker is idle */
+    st->workers = NULL;
+    if (st->nvml_down)
+        keep_power(st);
+    gpus_free(st);
+
+    /* Snapshots are sized by device_count: free before it changes and use
+     * one compiled for no GPUs, valid for any count, until the new load */
+    config_snapshot_free(st->config);
+    gpu_shutdown();
+    st->config = config_snapshot_empty();
+    if (!st->config) {
+        syslog(LOG_ERR, "Out of memory re-initializing NVML; stopping");
+        keep_running = 0;
+        evloop_stop(&st->loop);
+        return -1;
+    }
+    if (gpu_init() != 0)
+        return -1;
+
+    st->workers = gpus_alloc(st) == 0 ? worker_pool_create(device_count) : NULL;
+    if (!st->workers ||
+        evloop_add_fd(&st->loop, worker_pool_fd(st->workers), EPOLLIN,
+                      on_workers, st) != 0) {
+        worker_pool_destroy(st->workers);
+        st->workers = NULL;
+        gpus_free(st);
+        gpu_shutdown();
+        return -1;
+    }
+    readopt_power(st);
+
+    ConfigSnapshot *next = config_snapshot_load();
+    if (next) {
+        config_snapshot_free(st->config);
+        st->config = next;
+    } else {
+        syslog(LOG_WARNING, "Invalid configuration; leaving all GPUs in auto");
+    }
+    rebind_profiles(st, NULL);
+    st->events_stale = 0;
+    start_events(st);
+    return 0;
+}
+
+/* Enumerates the GPUs again once the library failed or they changed, and
+ * otherwise checks every NVFD_RESCAN_S whether NVML counts a different
+ * number of them */
+static void rescan(DaemonState *st, double now) {
+    if (!st->nvml_down && !st->changed) {
+        unsigned int count;
+        nvmlReturn_t r = gpu_count_now(&count);
+        if (gpu_fault(r) == GPU_FAULT_LIBRARY) {
+            nvml_failed(st, r, now);
+        } else if (r == NVML_SUCCESS && count != device_count) {
+            syslog(LOG_NOTICE, "NVML counts %u GPUs instead of %u; re-enumerating",
+                   count, device_count);
+            st->changed = 1;
+        } else {
+            st->rescan_at = now + NVFD_RESCAN_S;
+            return;
+        }
+    }
+
+    if (reinit_nvml(st) == 0) {
+        st->nvml_down = 0;
+        st->changed = 0;
+        st->reinits++;
+        st->rescan_backoff = NVFD_HEALTH_RETRY_MIN_S;
+        st->rescan_at = now + NVFD_RESCAN_S;
+        syslog(LOG_NOTICE, "NVML re-initialized, %u GPUs", device_count);
+        return;
+    }
+    st->nvml_down = 1;
+    st->rescan_at = now + st->rescan_backoff;
+    syslog(LOG_WARNING, "NVML re-initialization failed; retrying in %.0f s",
+           st->rescan_backoff);
+    st->rescan_backoff *= 2.0;
+    if (st->rescan_backoff > NVFD_HEALTH_RETRY_MAX_S)
+        st->rescan_backoff = NVFD_HEALTH_RETRY_MAX_S;
+}
+
+static void on_timer(EvLoop *loop, void *arg) {
+    (void)loop;
+    DaemonState *st = arg;
+    double now = evloop_now();
+
+    st->wakeups++;
+    if (st->rescan_at > 0.0 && now >= st->rescan_at)
+        rescan(st, now);
+    run_due(st);
+    restart_events(st);
+}
+
+/* Parse once, swap on success; a bad edit leaves the running config alone */
+static void reload(DaemonState *st, const char *reason) {
+    ConfigSnapshot *next = config_snapshot_load();
+    if (!next) {
+        syslog(LOG_WARNING, "Ignoring invalid configuration (%s); keeping previous",
+               reason);
+        return;
+    }
+
+    ConfigSnapshot *prev = st->config;
+    st->config = next;
+    if (!rt_equal(&prev->realtime, &next->realtime))
+        syslog(LOG_NOTICE, "sched, sched_priority, cpus and lock_memory take "
+               "effect at the next start");
+    for (unsigned int i = 0; i < device_count; i++) {
+        gov_reset(&st->gpus[i].gov);
+        eff_reset(&st->gpus[i].eff);
+    }
+    syslog(LOG_INFO, "Configuration reloaded (%s)", reason);
+    rebind_profiles(st, prev);
+    config_snapshot_free(prev);
+
+    /* Apply the new configuration right away instead of on the next poll */
+    reschedule_all(st);
+}
+
+static void on_watch(EvLoop *loop, int fd, uint32_t events, void *arg) {
+    (void)loop;
+    (void)events;
+    DaemonState *st = arg;
+
+    int changed = watch_read(fd);
+    if (changed & WATCH_CONFIG)
+        reload(st, "config.json changed");
+    else if (changed & WATCH_CURVE)
+        reload(st, "curve.json changed");
+    else if (changed & WATCH_PROFILES)
+        reload(st, "profiles changed");
+}
+
+/* "profile <name|none> <gpu|all>": profiles are already compiled, so this
+ * only swaps pointers */
+static void handle_profile(DaemonState *st, char *args, char *reply, size_t len) {
+    char *save;
+    char *name = strtok_r(args, " ", &save);
+    char *which = strtok_r(NULL, " ", &save);
+    if (!name || !which || strtok_r(NULL, " ", &save)) {
+        snprintf(reply, len, "error usage: profile <name|none> <gpu|all>");
+        return;
+    }
+
+    const Profile *profile = NULL;
+    if (strcmp(name, "none") != 0) {
+        profile = config_snapshot_profile(st->config, name);
+        if (!profile) {
+            snprintf(reply, len, "error no profile \"%s\"", name);
+            return;
+        }
+    }
+
+    unsigned int first = 0, last = device_count;
+    if (strcmp(which, "all") != 0) {
+        char *end;
+        unsigned long index = strtoul(which, &end, 10);
+        if (*which == '\0' || *end != '\0' || index >= device_count) {
+            snprintf(reply, len, "error invalid GPU \"%s\"", which);
+            return;
+        }
+        first = (unsigned int)index;
+        last = first + 1;
+    }
+
+    for (unsigned int i = first; i < last; i++) {
+        st->gpus[i].chosen = profile;
+        switch_profile(st, i, profile);
+    }
+    snprintf(reply, len, "ok");
+}
+
+static void budget_reply(const DaemonState *st, char *reply, size_t len) {
+    double now = evloop_now();
+    int used = snprintf(reply, len, "budget %d\n", st->config->fan_budget);
+    for (unsigned int i = 0; i < device_count && used > 0 && (size_t)used < len; i++) {
+        const GpuControl *gc = &st->gpus[i];
+        if (budget_counted(gc, now))
+            used += snprintf(reply + used, len - (size_t)used, "%u %d %d\n",
+                             i, gc->demand.grant, gc->demand.want);
+    }
+}
+
+static void on_control(EvLoop *loop, int fd, uint32_t events, void *arg) {
+    (void)loop;
+    (void)events;
+    DaemonState *st = arg;
+    ControlMsg msg;
+    char reply[CONTROL_MSG_MAX];
+
+    while (control_recv(fd, &msg)) {
+        if (strncmp(msg.text, "profile ", 8) == 0) {
+            handle_profile(st, msg.text + 8, reply, sizeof(reply));
+        } else if (strcmp(msg.text, "budget") == 0) {
+            budget_reply(st, reply, sizeof(reply));
+        } else if (strcmp(msg.text, "active") == 0) {
+            size_t used = 0;
+            reply[0] = '\0';
+            for (unsigned int i = 0; i < device_count && used < sizeof(reply); i++) {
+                const Profile *profile = st->gpus[i].profile;
+                int n = snprintf(reply + used, sizeof(reply) - used, "%u %s\n",
+                                 i, profile ? profile->name : "-");
+                if (n > 0)
+                    used += (size_t)n;
+            }
+        } else {
+            snprintf(reply, sizeof(reply), "error unknown request");
+        }
+        control_reply(fd, &msg, reply);
+    }
+    run_due(st);
+}
+
+static void log_stats(const DaemonState *st) {
+    syslog(LOG_INFO, "Fan writes: %llu issued, %llu suppressed, %llu failed",
+           st->fan_stats.writes, st->fan_stats.skipped, st->fan_stats.failures);
+    syslog(LOG_INFO, "Scheduler: %llu wakeups, %llu samples, %llu late, "
+           "%llu NVML timeouts",
+           st->wakeups, st->samples, st->late, st->timeouts);
+    const EvJitter *jitter = &st->loop.jitter;
+    if (jitter->count > 0)
+        syslog(LOG_INFO, "Loop jitter: mean %.2f ms, p99 under %.2f ms, max %.2f ms "
+               "over %llu timer wakeups", jitter->sum / jitter->count * 1000.0,
+               evloop_jitter_quantile(jitter, 0.99) * 1000.0, jitter->max * 1000.0,
+               jitter->count);
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+        syslog(LOG_INFO, "Process: %ld major and %ld minor page faults, "
+               "%ld involuntary context switches", ru.ru_majflt, ru.ru_minflt,
+               ru.ru_nivcsw);
+    if (st->events || st->nvml_events > 0)
+        syslog(LOG_INFO, "NVML events: %llu received", st->nvml_events);
+    if (st->nvml_down)
+        syslog(LOG_INFO, "NVML down, next re-initialization in %.0f s",
+               st->rescan_at - evloop_now());
+    if (st->reinits > 0)
+        syslog(LOG_INFO, "NVML re-initialized %llu times", st->reinits);
+    for (int z = 0; z < st->config->zone_count; z++) {
+        const Zone *zone = &st->config->zones[z];
+        int raw, filtered;
+        zone_inputs(st, zone, evloop_now(), &raw, &filtered);
+        syslog(LOG_INFO, "Zone %s: %d C (%s of %d members)", zone->name, raw,
+               zone_combine_name(zone->combine), zone->member_count);
+    }
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuControl *gc = &st->gpus[i];
+        const GpuDevice *dev = gpu_device(i);
+        if (gc->health.state == HEALTH_LOST)
+            syslog(LOG_INFO, "GPU %u: lost for %.0f s, next probe in %.0f s", i,
+                   evloop_now() - gc->health.since, gc->health.retry_at - evloop_now());
+        else if (gc->health.state == HEALTH_DEGRADED)
+            syslog(LOG_INFO, "GPU %u: degraded, %d readings failed in a row",
+                   i, gc->health.failures);
+        else if (gc->quarantined)
+            syslog(LOG_INFO, "GPU %u: quarantined, next probe in %.0f s",
+                   i, gc->backoff);
+        else if (gc->managed)
+            syslog(LOG_INFO, "GPU %u: poll %.0f ms, slope %+.2f C/s",
+                   i, gc->interval * 1000.0, gc->slope);
+        if (gc->thermal_s > 0.0 || gc->power_s > 0.0)
+            syslog(LOG_INFO, "GPU %u: throttled %.0f s by temperature, %.0f s by power",
+                   i, gc->thermal_s, gc->power_s);
+        if (st->config->fan_budget > 0 && budget_counted(gc, evloop_now()))
+            syslog(LOG_INFO, "GPU %u: fans %d%% of %d%% wanted, %d C of headroom",
+                   i, gc->demand.grant, gc->demand.want, gc->demand.headroom);
+        if (gc->gov.cuts > 0 && (gc->gov.applied || dev))
+            syslog(LOG_INFO, "GPU %u: power limit %d W, %llu cuts, %llu raises",
+                   i, (gc->gov.applied ? gc->gov.applied : dev->power_orig) / 1000,
+                   gc->gov.cuts, gc->gov.restores);
+        if (gc->clocks.primed)
+            syslog(LOG_INFO, "GPU %u: clocks drop from %.1f C, peak %u MHz",
+                   i, gc->clocks.knee, gc->clocks.peak_mhz);
+        if (gc->eff.searching)
+            syslog(LOG_INFO, "GPU %u: efficiency fans %d%%, %.1f W with fans, "
+                   "%.1f W on the curve at %d%%", i, gc->eff.speed, gc->eff.total,
+                   gc->eff.curve_w, gc->eff.curve_speed);
+        if (gc->eff.judged_s > 0.0)
+            syslog(LOG_INFO, "GPU %u: %.2f Wh saved against the curve over %.0f s "
+                   "(%llu load changes)", i, gc->eff.saved_j / 3600.0,
+                   gc->eff.judged_s, gc->eff.restarts);
+    }
+}
+
+static void on_signal(EvLoop *loop, int signum, void *arg) {
+    DaemonState *st = arg;
+
+    if (signum == SIGTERM || signum == SIGINT) {
+        keep_running = 0;
+        evloop_stop(loop);
+    } else if (signum == SIGHUP) {
+        reload(st, "SIGHUP");
+    } else if (signum == SIGUSR1) {
+        log_stats(st);
+    }
+}
+
+int daemon_run(void) {
+    DaemonState st;
+    memset(&st, 0, sizeof(st));
+    st.watch_fd = -1;
+    st.control_fd = -1;
+
+    openlog("nvfd", LOG_PID, LOG_DAEMON);
+    config_ensure_dir();
+
+    if (gpus_alloc(&st) != 0) {
+        syslog(LOG_ERR, "Out of memory allocating state for %u GPUs", device_count);
+        gpus_free(&st);
+        closelog();
+        return -1;
+    }
+
+    note_power_limits();
+
+    st.config = config_snapshot_load();
+    if (!st.config) {
+        /* Same as having no config: drivers keep the fans until it is fixed */
+        syslog(LOG_WARNING, "Invalid configuration at startup; leaving all GPUs in auto");
+        st.config = config_snapshot_empty();
+        if (!st.config) {
+            gpus_free(&st);
+            closelog();
+            return -1;
+        }
+    }
+
+    /* Before any thread starts: the workers and the event waiter inherit it */
+    rt_apply(&st.config->realtime);
+    st.workers = worker_pool_create(device_count);
+    if (!st.workers) {
+        syslog(LOG_ERR, "Failed to start NVML workers");
+        config_snapshot_free(st.config);
+        gpus_free(&st);
+        closelog();
+        return -1;
+    }
+    rebind_profiles(&st, NULL);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+
+    if (evloop_init(&st.loop, &signals, on_timer, on_signal, &st) != 0 ||
+        evloop_add_fd(&st.loop, worker_pool_fd(st.workers), EPOLLIN,
+                      on_workers, &st) != 0) {
+        evloop_close(&st.loop);
+        config_snapshot_free(st.config);
+        worker_pool_destroy(st.workers);
+        gpus_free(&st);
+        closelog();
+        return -1;
+    }
+
+    /* Without inotify the daemon still works; changes then need SIGHUP */
+    st.watch_fd = watch_open();
+    if (st.watch_fd >= 0 &&
+        evloop_add_fd(&st.loop, st.watch_fd, EPOLLIN, on_watch, &st) != 0) {
+        close(st.watch_fd);
+        st.watch_fd = -1;
+    }
+    if (st.watch_fd < 0)
+        syslog(LOG_WARNING, "Config watch unavailable; use SIGHUP to reload");
+
+    st.control_fd = control_open();
+    if (st.control_fd >= 0 &&
+        evloop_add_fd(&st.loop, st.control_fd, EPOLLIN, on_control, &st) != 0) {
+        control_close(st.control_fd);
+        st.control_fd = -1;
+    }
+    if (st.control_fd < 0)
+        syslog(LOG_WARNING, "Control socket unavailable; profiles can only be "
+               "set in config.json");
+
+    start_events(&st);
+
+    printf("Entering daemon mode (adaptive polling %d-%d ms)...\n",
+           st.config->poll_min_ms, st.config->poll_max_ms);
+
+    /* Every GPU is due immediately; the scheduler takes it from there */
+    st.rescan_backoff = NVFD_HEALTH_RETRY_MIN_S;
+    st.rescan_at = evloop_now() + NVFD_RESCAN_S;
+    run_due(&st);
+    int ret = evloop_run(&st.loop);
+    if (!st.config) {
+        /* Re-initializing ran out of memory; nothing is left to reset */
+        evloop_close(&st.loop);
+        closelog();
+        return -1;
+    }
+
+    log_stats(&st);
+
+    /* Reset all fans to auto on clean shutdown */
+    syslog(LOG_INFO, "Shutting down, resetting fans to auto...");
+    reset_all(&st);
+
+    events_close(&st);
+    if (st.watch_fd >= 0)
+        close(st.watch_fd);
+    control_close(st.control_fd);
+    evloop_close(&st.loop);
+    config_snapshot_free(st.config);
+    /* A worker stuck in NVML may still write to its GPU's fan state */
+    if (worker_pool_destroy(st.workers) == 0)
+        gpus_free(&st);
+    free(st.kept);
+    closelog();
+    return ret;
+}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <locale.h>
+#include <sys/stat.h>
 #include <ncurses.h>
 #include <jansson.h>
 
@@ -11,7 +12,11 @@
 #include "fan.h"
 #include "curve.h"
 #include "config.h"
+#include "control.h"
 #include "editor.h"
+#include "evloop.h"
+#include "pid.h"
+#include "sensor.h"
 
 /* Color pairs */
 #define DC_TITLE     1
@@ -32,19 +37,33 @@ typedef struct {
     /* Per-GPU cached data */
     char     name[NVML_DEVICE_NAME_BUFFER_SIZE];
     int      temp;
+    int      temps[SENSOR_COUNT];  /* temp and what else the board reports */
     int      utilization;
     unsigned long long mem_used;
     unsigned long long mem_total;
     int      power;        /* milliwatts */
     int      power_limit;  /* milliwatts */
     int      fan_count;
-    int      fan_speed[MAX_FAN_COUNT];
-    char     mode[16];     /* "auto", "manual", "curve" */
+    int     *fan_speed;    /* fan_count entries */
+    CurveState *curve_state;  /* per fan, curve hysteresis and hold */
+    char     mode[16];     /* "auto", "manual", "curve", "target", "clocks",
+                            * "efficiency" */
     int      manual_speed; /* config speed for manual mode */
+    int      target;       /* config temperature for target mode */
+    PidGains gains;
+    int      min_speed;    /* limits of the policy in effect */
+    int      max_speed;
+    const Profile *profile;  /* overrides the config.json entry */
+    const Profile *init_profile;
+    PidState pid;
+    double   pid_at;       /* time of the last PID update */
+    char     init_mode[16];
+    int      init_speed;
+    int      init_target;
 } GpuData;
 
 typedef struct {
-    GpuData  gpus[MAX_GPU_COUNT];
+    GpuData *gpus;         /* one per detected GPU */
     unsigned int gpu_count;
     unsigned int selected_gpu;
     int      running;
@@ -52,8 +71,20 @@ typedef struct {
     int      term_cols;
     int      dirty;
     int      sync_all;  /* 0=single GPU control, 1=all GPUs sync */
-    char     init_mode[MAX_GPU_COUNT][16];
-    int      init_speed[MAX_GPU_COUNT];
+    ConfigSnapshot *config;   /* profiles, compiled once at startup */
+    CurveSet *curves;      /* NULL = built-in default curve */
+    DeviceCurves *curve_dev;  /* compiled, one per GPU */
+    struct stat curve_stat; /* curve.json as last compiled */
+    int      curve_loaded;
+    /* Scratch for batch lookups, one entry per fan of every GPU */
+    unsigned int fan_total;
+    const CurveTable **curve_tables;
+    int     *curve_temps;
+    unsigned int *curve_speeds;
+    /* The daemon's split of the node fan budget, 0 = none or no daemon */
+    int      fan_budget;
+    int     *budget_granted;   /* per GPU, -1 = not counted */
+    int     *budget_wanted;
 } DashboardState;
 
 static void init_colors(void) {
@@ -74,19 +105,115 @@ static void init_colors(void) {
     }
 }
 
-static void dashboard_refresh_data(DashboardState *st) {
+/* Per-GPU data is sized once from the detected topology */
+static int dashboard_alloc(DashboardState *st) {
+    if (device_count == 0)
+        return 0;
+    st->gpus = calloc(device_count, sizeof(*st->gpus));
+    if (!st->gpus)
+        return -1;
     st->gpu_count = device_count;
+    st->curve_dev = calloc(device_count, sizeof(*st->curve_dev));
+    st->budget_granted = calloc(device_count, sizeof(int));
+    st->budget_wanted = calloc(device_count, sizeof(int));
+    if (!st->curve_dev || !st->budget_granted || !st->budget_wanted)
+        return -1;
+
+    for (unsigned int i = 0; i < st->gpu_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        if (!dev || dev->fan_count == 0)
+            continue;
+        st->gpus[i].fan_speed = calloc(dev->fan_count, sizeof(int));
+        st->gpus[i].curve_state = calloc(dev->fan_count, sizeof(CurveState));
+        if (!st->gpus[i].fan_speed || !st->gpus[i].curve_state)
+            return -1;
+        st->fan_total += dev->fan_count;
+    }
+
+    if (st->fan_total > 0) {
+        st->curve_tables = calloc(st->fan_total, sizeof(*st->curve_tables));
+        st->curve_temps = calloc(st->fan_total, sizeof(int));
+        st->curve_speeds = calloc(st->fan_total, sizeof(unsigned int));
+        if (!st->curve_tables || !st->curve_temps || !st->curve_speeds)
+            return -1;
+    }
+    return 0;
+}
+
+static void dashboard_free_curves(DashboardState *st) {
+    if (st->curve_dev) {
+        for (unsigned int i = 0; i < st->gpu_count; i++)
+            curve_device_free(&st->curve_dev[i]);
+    }
+    curve_set_free(st->curves);
+    st->curves = NULL;
+}
+
+static void dashboard_free(DashboardState *st) {
+    for (unsigned int i = 0; i < st->gpu_count; i++) {
+        free(st->gpus[i].fan_speed);
+        free(st->gpus[i].curve_state);
+    }
+    dashboard_free_curves(st);
+    free(st->curve_dev);
+    free(st->curve_tables);
+    free(st->curve_temps);
+    free(st->curve_speeds);
+    free(st->budget_granted);
+    free(st->budget_wanted);
+    free(st->gpus);
+    config_snapshot_free(st->config);
+    st->config = NULL;
+    st->curve_dev = NULL;
+    st->gpus = NULL;
+    st->gpu_count = 0;
+}
+
+/* Recompile only when curve.json has been replaced; every save renames a
+ * new file into place, so the inode changes along with the mtime */
+static void dashboard_load_curve(DashboardState *st) {
+    struct stat sb;
+    if (stat(NVFD_CURVE_FILE, &sb) != 0)
+        memset(&sb, 0, sizeof(sb));
+
+    if (st->curve_loaded && sb.st_ino == st->curve_stat.st_ino &&
+        sb.st_mtim.tv_sec == st->curve_stat.st_mtim.tv_sec &&
+        sb.st_mtim.tv_nsec == st->curve_stat.st_mtim.tv_nsec)
+        return;
+
+    dashboard_free_curves(st);
+    st->curves = curve_read();
+    for (unsigned int i = 0; i < st->gpu_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        unsigned int fans = dev && st->gpus[i].fan_speed ? dev->fan_count : 0;
+        if (curve_compile_device(st->curves, i, fans, &st->curve_dev[i]) != 0)
+            curve_device_free(&st->curve_dev[i]); /* GPU table still usable */
+    }
+    st->curve_stat = sb;
+    st->curve_loaded = 1;
+}
+
+static void dashboard_refresh_data(DashboardState *st) {
     getmaxyx(stdscr, st->term_rows, st->term_cols);
 
     json_t *root = config_read();
+    dashboard_load_curve(st);
+
+    /* Only the daemon knows the split; ask only if there is a budget */
+    if (!st->config || st->config->fan_budget <= 0 ||
+        control_fan_budget(&st->fan_budget, st->budget_granted, st->budget_wanted,
+                           st->gpu_count) != 0)
+        st->fan_budget = 0;
 
     for (unsigned int i = 0; i < st->gpu_count; i++) {
         GpuData *g = &st->gpus[i];
-        nvmlDevice_t device;
+        const GpuDevice *dev = gpu_device(i);
 
-        if (gpu_get_handle(i, &device) != 0) {
+        if (!dev) {
             snprintf(g->name, sizeof(g->name), "GPU %u (error)", i);
             g->temp = -1;
+            for (int s = 0; s < SENSOR_COUNT; s++)
+                g->temps[s] = -1;
             g->utilization = -1;
             g->mem_used = 0;
             g->mem_total = 0;
@@ -96,8 +223,10 @@ static void dashboard_refresh_data(DashboardState *st) {
             continue;
         }
 
-        gpu_get_name(device, g->name, sizeof(g->name));
-        g->temp = gpu_get_temperature(device);
+        nvmlDevice_t device = dev->handle;
+        memcpy(g->name, dev->name, sizeof(g->name));
+        gpu_read_sensors(dev, ~0u, g->temps);
+        g->temp = g->temps[SENSOR_CORE];
         g->utilization = gpu_get_utilization(device);
         if (gpu_get_memory(device, &g->mem_used, &g->mem_total) != 0) {
             g->mem_used = 0;
@@ -105,17 +234,13 @@ static void dashboard_refresh_data(DashboardState *st) {
         }
         g->power = gpu_get_power(device);
         g->power_limit = gpu_get_power_limit(device);
-        g->fan_count = fan_get_count(device);
-        if (g->fan_count > MAX_FAN_COUNT)
-            g->fan_count = MAX_FAN_COUNT;
+        g->fan_count = g->fan_speed ? (int)dev->fan_count : 0;
 
         for (int f = 0; f < g->fan_count; f++)
             g->fan_speed[f] = fan_get_speed(device, (unsigned int)f);
 
         /* Read mode from config */
-        char gpu_key[20];
-        snprintf(gpu_key, sizeof(gpu_key), "gpu%d", i);
-        json_t *cfg = json_object_get(root, gpu_key);
+        json_t *cfg = config_gpu_entry(root, i);
 
         if (json_is_object(cfg)) {
             const char *mode = json_string_value(json_object_get(cfg, "mode"));
@@ -134,6 +259,30 @@ static void dashboard_refresh_data(DashboardState *st) {
             g->mode[sizeof(g->mode) - 1] = '\0';
             g->manual_speed = 0;
         }
+        config_entry_target(cfg, &g->target, &g->gains);
+        g->min_speed = 0;
+        g->max_speed = 100;
+        json_t *lo = json_object_get(cfg, "min_speed");
+        json_t *hi = json_object_get(cfg, "max_speed");
+        if (json_is_integer(lo) && json_integer_value(lo) >= 0 && json_integer_value(lo) <= 100)
+            g->min_speed = (int)json_integer_value(lo);
+        if (json_is_integer(hi) && json_integer_value(hi) >= g->min_speed &&
+            json_integer_value(hi) <= 100)
+            g->max_speed = (int)json_integer_value(hi);
+
+        /* A profile replaces what config.json says about this GPU */
+        if (g->profile) {
+            const GpuPolicy *policy = &g->profile->policy;
+            snprintf(g->mode, sizeof(g->mode), "%s", config_mode_name(policy->mode));
+            g->manual_speed = policy->speed;
+            if (policy->mode == FAN_MODE_TARGET || policy->mode == FAN_MODE_CLOCKS ||
+                policy->mode == FAN_MODE_EFFICIENCY) {
+                g->target = policy->target;
+                g->gains = policy->gains;
+            }
+            g->min_speed = policy->min_speed;
+            g->max_speed = policy->max_speed;
+        }
     }
 
     json_decref(root);
@@ -183,6 +332,18 @@ static void draw_title(const DashboardState *st) {
         attroff(COLOR_PAIR(DC_CURVE) | A_BOLD);
     }
 
+    if (st->fan_budget > 0 && st->term_cols >= 80) {
+        int granted = 0;
+        for (unsigned int i = 0; i < st->gpu_count; i++)
+            granted += st->budget_granted[i] > 0 ? st->budget_granted[i] : 0;
+        attron(COLOR_PAIR(DC_LABEL));
+        printw("  Fan budget ");
+        attroff(COLOR_PAIR(DC_LABEL));
+        attron(COLOR_PAIR(DC_VALUE) | A_BOLD);
+        printw("%d/%d%%", granted, st->fan_budget);
+        attroff(COLOR_PAIR(DC_VALUE) | A_BOLD);
+    }
+
     attron(COLOR_PAIR(DC_STATUS));
     mvprintw(0, st->term_cols - 10, "[q] Quit");
     attroff(COLOR_PAIR(DC_STATUS));
@@ -206,6 +367,24 @@ static int total_full_height(const DashboardState *st) {
     return h;
 }
 
+/* The zone a GPU shares air with, and the zone's temperature from its
+ * members' readings; NULL if the GPU is not in one */
+static const Zone *gpu_zone(const DashboardState *st, unsigned int gpu_index, int *temp) {
+    int member;
+    const Zone *zone = st->config ? config_snapshot_zone(st->config, gpu_index, &member)
+                                  : NULL;
+    if (!zone)
+        return NULL;
+
+    int temps[ZONE_MEMBERS_MAX];
+    for (int m = 0; m < zone->member_count; m++) {
+        int j = zone->members[m].gpu;
+        temps[m] = j >= 0 && (unsigned int)j < st->gpu_count ? st->gpus[j].temp : -1;
+    }
+    *temp = zone_combine(zone, temps);
+    return zone;
+}
+
 static int draw_gpu_section(const DashboardState *st, int row, unsigned int gpu_index) {
     const GpuData *g = &st->gpus[gpu_index];
     int col_label = 3;
@@ -221,6 +400,28 @@ static int draw_gpu_section(const DashboardState *st, int row, unsigned int gpu_
     attron(COLOR_PAIR(DC_TITLE) | A_BOLD);
     mvprintw(row, col_label - 1, "GPU %u: %s", gpu_index, g->name);
     attroff(COLOR_PAIR(DC_TITLE) | A_BOLD);
+    if (g->profile) {
+        attron(COLOR_PAIR(DC_CURVE) | A_BOLD);
+        printw("  [profile %s]", g->profile->name);
+        attroff(COLOR_PAIR(DC_CURVE) | A_BOLD);
+    }
+    if (st->fan_budget > 0 && st->budget_granted[gpu_index] >= 0) {
+        int cut = st->budget_granted[gpu_index] < st->budget_wanted[gpu_index];
+        attron(COLOR_PAIR(cut ? DC_CURVE : DC_MODE_DIM) | A_BOLD);
+        printw("  [budget %d/%d%%]", st->budget_granted[gpu_index],
+               st->budget_wanted[gpu_index]);
+        attroff(COLOR_PAIR(cut ? DC_CURVE : DC_MODE_DIM) | A_BOLD);
+    }
+    int zone_temp;
+    const Zone *zone = gpu_zone(st, gpu_index, &zone_temp);
+    if (zone) {
+        attron(COLOR_PAIR(DC_CURVE) | A_BOLD);
+        printw("  [zone %s", zone->name);
+        if (zone_temp >= 0)
+            printw(" %d\xc2\xb0""C", zone_temp);
+        printw("]");
+        attroff(COLOR_PAIR(DC_CURVE) | A_BOLD);
+    }
     row++;
 
     /* Temperature */
@@ -232,6 +433,14 @@ static int draw_gpu_section(const DashboardState *st, int row, unsigned int gpu_
     attroff(COLOR_PAIR(DC_VALUE) | A_BOLD);
     if (g->temp >= 0)
         draw_bar(row, col_bar, BAR_WIDTH, g->temp, DC_BAR_FILL);
+    if (g->temps[SENSOR_MEM] >= 0 && st->term_cols >= col_bar + BAR_WIDTH + 14) {
+        attron(COLOR_PAIR(DC_LABEL));
+        mvprintw(row, col_bar + BAR_WIDTH + 3, "mem ");
+        attroff(COLOR_PAIR(DC_LABEL));
+        attron(COLOR_PAIR(DC_VALUE) | A_BOLD);
+        printw("%3d\xc2\xb0""C", g->temps[SENSOR_MEM]);
+        attroff(COLOR_PAIR(DC_VALUE) | A_BOLD);
+    }
     row++;
 
     /* GPU utilization */
@@ -296,11 +505,11 @@ static int draw_gpu_section(const DashboardState *st, int row, unsigned int gpu_
     mvprintw(row, col_label, "Mode:");
     attroff(COLOR_PAIR(DC_LABEL));
 
-    const char *modes[] = {"auto", "manual", "curve"};
-    const char *labels[] = {"Auto", "Manual", "Curve"};
+    const char *modes[] = {"auto", "manual", "curve", "target", "clocks", "efficiency"};
+    const char *labels[] = {"Auto", "Manual", "Curve", "Target", "Clocks", "Efficiency"};
     int mcol = col_label + 7;
 
-    for (int m = 0; m < 3; m++) {
+    for (int m = 0; m < 6; m++) {
         if (strcmp(g->mode, modes[m]) == 0) {
             attron(COLOR_PAIR(DC_MODE_SEL) | A_BOLD | A_REVERSE);
             mvprintw(row, mcol, " %s ", labels[m]);
@@ -321,12 +530,57 @@ static int draw_gpu_section(const DashboardState *st, int row, unsigned int gpu_
         attroff(COLOR_PAIR(DC_VALUE) | A_BOLD);
     }
 
+    /* Setpoint for target mode */
+    if (strcmp(g->mode, "target") == 0) {
+        mcol += 4;
+        attron(COLOR_PAIR(DC_VALUE) | A_BOLD);
+        mvprintw(row, mcol, "Hold: %d\xc2\xb0""C", g->target);
+        attroff(COLOR_PAIR(DC_VALUE) | A_BOLD);
+    }
+    if (strcmp(g->mode, "clocks") == 0 || strcmp(g->mode, "efficiency") == 0) {
+        mcol += 4;
+        attron(COLOR_PAIR(DC_VALUE) | A_BOLD);
+        mvprintw(row, mcol, "Max: %d\xc2\xb0""C", g->target);
+        attroff(COLOR_PAIR(DC_VALUE) | A_BOLD);
+    }
+
     row++;
     return row;
 }
 
-static void draw_curve_info(int start_row, int current_temp) {
-    FanCurve *curve = curve_read();
+/* A profile with a curve of its own brings its own compiled tables */
+static const DeviceCurves *gpu_curves(const DashboardState *st, unsigned int gpu_index) {
+    const Profile *profile = st->gpus[gpu_index].profile;
+    if (profile && profile->curves_by_device)
+        return &profile->curves_by_device[gpu_index];
+    return &st->curve_dev[gpu_index];
+}
+
+/* What a curve follows: the zone, else its own sensor, else the GPU
+ * curve's, else the core */
+static int curve_input(const DashboardState *st, unsigned int gpu_index,
+                       const DeviceCurves *dc, const CurveTable *table) {
+    const GpuData *g = &st->gpus[gpu_index];
+    int zone_temp;
+    if (gpu_zone(st, gpu_index, &zone_temp) && zone_temp >= 0)
+        return zone_temp;
+
+    const SensorExpr *expr = table->sensor.count > 0 ? &table->sensor : &dc->table.sensor;
+    int temp = sensor_eval(expr, g->temps);
+    return temp >= 0 ? temp : g->temp;
+}
+
+static void draw_curve_info(const DashboardState *st, unsigned int gpu_index,
+                            int start_row, int current_temp) {
+    const DeviceCurves *dc = gpu_curves(st, gpu_index);
+    const FanCurve *curve = dc->curve;
+    const Profile *profile = st->gpus[gpu_index].profile;
+    int from_profile = profile && profile->curves;
+    const GpuCurve *own = curve_set_gpu(from_profile ? profile->curves : st->curves,
+                                        gpu_index);
+    int fan_curves = 0;
+    for (unsigned int f = 0; own && f < own->fan_count; f++)
+        fan_curves += own->fans[f].point_count > 0;
 
     attron(COLOR_PAIR(DC_LABEL) | A_BOLD);
     mvprintw(start_row, 3, "Fan Curve:");
@@ -334,14 +588,23 @@ static void draw_curve_info(int start_row, int current_temp) {
 
     if (!curve) {
         attron(COLOR_PAIR(DC_MODE_DIM));
-        printw("  (no curve file - using default)");
+        printw("  (built-in default curve)");
         attroff(COLOR_PAIR(DC_MODE_DIM));
         return;
     }
 
+    attron(COLOR_PAIR(DC_MODE_DIM));
+    printw(" %s%s", from_profile ? "profile, " : "",
+           own && curve == &own->curve ? "GPU's own" : "default");
+    if (curve->interpolation != CURVE_LINEAR)
+        printw(", %s", curve_interpolation_name(curve->interpolation));
+    if (fan_curves > 0)
+        printw(" + %d fan curve%s", fan_curves, fan_curves != 1 ? "s" : "");
+    attroff(COLOR_PAIR(DC_MODE_DIM));
+
     /* Show current temp → interpolated speed */
     if (current_temp >= 0) {
-        int cur_speed = curve_interpolate(current_temp, curve);
+        int cur_speed = curve_lookup(&dc->table, current_temp);
         attron(COLOR_PAIR(DC_CURSOR) | A_BOLD);
         mvprintw(start_row, 40, "Now: %d\xc2\xb0""C \xe2\x86\x92 %d%%",
                  current_temp, cur_speed);
@@ -406,8 +669,6 @@ static void draw_curve_info(int start_row, int current_temp) {
     attron(COLOR_PAIR(DC_MODE_DIM));
     mvprintw(start_row, 5, "Press [e] to open curve editor");
     attroff(COLOR_PAIR(DC_MODE_DIM));
-
-    free(curve);
 }
 
 static void draw_status_bar(const DashboardState *st) {
@@ -442,10 +703,19 @@ static void draw_status_bar(const DashboardState *st) {
         offset += 17;
     }
 
+    if (strcmp(g->mode, "target") == 0) {
+        mvprintw(row, offset, "  [\xe2\x86\x91\xe2\x86\x93] Target \xc2\xb1""1");
+        offset += 18;
+    }
+
     if (strcmp(g->mode, "curve") == 0) {
         mvprintw(row, offset, "  [e] Edit Curve");
         offset += 16;
     }
+    if (st->config && st->config->profile_count > 0) {
+        mvprintw(row, offset, "  [p] Profile");
+        offset += 13;
+    }
 
     mvprintw(row, offset, "  [q] Quit");
 
@@ -453,11 +723,29 @@ static void draw_status_bar(const DashboardState *st) {
     attroff(COLOR_PAIR(DC_STATUS) | A_REVERSE);
 }
 
+static int tab_width(unsigned int gpu_index) {
+    return snprintf(NULL, 0, " GPU %u ", gpu_index);
+}
+
+/* Scroll the tabs so the selected GPU stays visible with many GPUs */
+static unsigned int tab_first_visible(const DashboardState *st) {
+    int avail = st->term_cols - 2;
+    unsigned int first = st->selected_gpu;
+    int used = tab_width(first);
+    while (first > 0 && used + tab_width(first - 1) <= avail) {
+        first--;
+        used += tab_width(first);
+    }
+    return first;
+}
+
 static void draw_tab_bar(const DashboardState *st, int row) {
     int col = 1;
-    for (unsigned int i = 0; i < st->gpu_count; i++) {
+    for (unsigned int i = tab_first_visible(st); i < st->gpu_count; i++) {
         char label[16];
         int len = snprintf(label, sizeof(label), " GPU %u ", i);
+        if (col + len > st->term_cols - 1)
+            break;
         if (i == st->selected_gpu) {
             attron(COLOR_PAIR(DC_MODE_SEL) | A_BOLD | A_REVERSE);
             mvprintw(row, col, "%s", label);
@@ -477,7 +765,8 @@ static void draw_gpu_with_curve(const DashboardState *st, int *row, unsigned int
         (*row)++;
         draw_separator(*row, st->term_cols);
         (*row)++;
-        draw_curve_info(*row, st->gpus[gpu_index].temp);
+        const DeviceCurves *dc = gpu_curves(st, gpu_index);
+        draw_curve_info(st, gpu_index, *row, curve_input(st, gpu_index, dc, &dc->table));
         *row += 4;
     }
 }
@@ -519,72 +808,129 @@ static void draw_screen(const DashboardState *st) {
     refresh();
 }
 
-static void apply_mode(unsigned int gpu_index, const char *mode, int speed) {
-    char gpu_key[20];
-    snprintf(gpu_key, sizeof(gpu_key), "gpu%d", gpu_index);
-    config_write_gpu(gpu_key, mode, speed);
+/* Runs the GPU under profile (NULL = config.json) here and, when it is
+ * running, in the daemon too so the two do not fight over the fans */
+static void set_profile(DashboardState *st, unsigned int gpu_index, const Profile *profile) {
+    GpuData *g = &st->gpus[gpu_index];
+    if (g->profile == profile)
+        return;
+    g->profile = profile;
+    for (int f = 0; f < g->fan_count; f++)
+        curve_state_reset(&g->curve_state[f]);
+    pid_reset(&g->pid);
+
+    char err[256];
+    control_set_profile(profile ? profile->name : NULL, (int)gpu_index, err, sizeof(err));
+
+    /* The profile's mode takes effect without waiting for the next refresh */
+    if (profile && profile->policy.mode == FAN_MODE_AUTO)
+        fan_reset_to_auto(gpu_index);
+    else if (profile && profile->policy.mode == FAN_MODE_MANUAL)
+        fan_set_gpu_speed(gpu_index, (unsigned int)profile->policy.speed);
+}
+
+/* Setting a mode by hand leaves the profile */
+static void apply_mode(DashboardState *st, unsigned int gpu_index, const char *mode, int value) {
+    set_profile(st, gpu_index, NULL);
+    config_write_gpu(gpu_index, mode, value);
 
     if (strcmp(mode, "auto") == 0) {
         fan_reset_to_auto(gpu_index);
     } else if (strcmp(mode, "manual") == 0) {
+        const GpuData *g = &st->gpus[gpu_index];
+        int speed = value < g->min_speed ? g->min_speed
+                  : value > g->max_speed ? g->max_speed : value;
         fan_set_gpu_speed(gpu_index, (unsigned int)speed);
     }
-    /* curve mode: apply immediately in TUI */
-    if (strcmp(mode, "curve") == 0) {
-        nvmlDevice_t device;
-        if (gpu_get_handle(gpu_index, &device) == 0) {
-            int temp = gpu_get_temperature(device);
-            if (temp >= 0) {
-                FanCurve *curve = curve_read();
-                int fan_speed;
-                if (curve) {
-                    fan_speed = curve_interpolate(temp, curve);
-                    free(curve);
-                } else {
-                    fan_speed = curve_default_interpolate(temp);
-                }
-                fan_set_gpu_speed(gpu_index, (unsigned int)fan_speed);
-            }
-        }
-    }
+    /* curve and target modes: apply_curve_fans() and apply_target_fans()
+     * take over on the next refresh */
+}
+
+/* Efficiency mode starts from the curve; its search needs minutes of
+ * steady load, so it is left to the daemon */
+static int follows_curve(const GpuData *g) {
+    return strcmp(g->mode, "curve") == 0 || strcmp(g->mode, "efficiency") == 0;
 }
 
-static void apply_curve_fans(const DashboardState *st) {
-    /* Check if any GPU is in curve mode first */
-    int any_curve = 0;
+/* Evaluates every fan of every curve-mode GPU in one batch against the
+ * cached compiled curves */
+static void apply_curve_fans(DashboardState *st) {
+    unsigned int n = 0;
     for (unsigned int i = 0; i < st->gpu_count; i++) {
-        if (strcmp(st->gpus[i].mode, "curve") == 0) {
-            any_curve = 1;
-            break;
+        GpuData *g = &st->gpus[i];
+        if (!follows_curve(g)) {
+            for (int f = 0; f < g->fan_count; f++)
+                curve_state_reset(&g->curve_state[f]);
+            continue;
+        }
+        if (g->temp < 0)
+            continue;
+        const DeviceCurves *dc = gpu_curves(st, i);
+        for (int f = 0; f < g->fan_count; f++) {
+            st->curve_tables[n] = curve_fan_table(dc, (unsigned int)f);
+            st->curve_temps[n] = curve_input(st, i, dc, st->curve_tables[n]);
+            n++;
         }
     }
-    if (!any_curve)
+    if (n == 0)
         return;
 
-    /* Read curve once, apply to all curve-mode GPUs */
-    FanCurve *curve = curve_read();
+    curve_lookup_batch(st->curve_tables, st->curve_temps, st->curve_speeds, n);
 
+    double now = evloop_now();
+    n = 0;
     for (unsigned int i = 0; i < st->gpu_count; i++) {
-        if (strcmp(st->gpus[i].mode, "curve") != 0)
+        GpuData *g = &st->gpus[i];
+        if (!follows_curve(g) || g->temp < 0 || g->fan_count == 0)
             continue;
+        for (int f = 0; f < g->fan_count; f++) {
+            unsigned int k = n + (unsigned int)f;
+            int speed = curve_hold(st->curve_tables[k], &g->curve_state[f],
+                                   (int)st->curve_speeds[k], st->curve_temps[k], now);
+            if (speed < g->min_speed)
+                speed = g->min_speed;
+            if (speed > g->max_speed)
+                speed = g->max_speed;
+            st->curve_speeds[k] = (unsigned int)speed;
+        }
+        fan_set_gpu_speeds(i, &st->curve_speeds[n]);
+        n += (unsigned int)g->fan_count;
+    }
+}
 
-        nvmlDevice_t device;
-        if (gpu_get_handle(i, &device) != 0)
-            continue;
+/* The dashboard runs the target-mode PID itself while it is open. Clocks
+ * mode holds its ceiling here; learning the knee is left to the daemon. */
+static void apply_target_fans(DashboardState *st) {
+    double now = evloop_now();
 
-        int temp = gpu_get_temperature(device);
-        if (temp < 0)
+    for (unsigned int i = 0; i < st->gpu_count; i++) {
+        GpuData *g = &st->gpus[i];
+        if (strcmp(g->mode, "target") != 0 && strcmp(g->mode, "clocks") != 0) {
+            pid_reset(&g->pid);
             continue;
+        }
 
-        int fan_speed;
-        if (curve)
-            fan_speed = curve_interpolate(temp, curve);
-        else
-            fan_speed = curve_default_interpolate(temp);
-        fan_set_gpu_speed(i, (unsigned int)fan_speed);
+        unsigned int lo, hi;
+        int temp = g->temp, zone_temp;
+        if (gpu_zone(st, i, &zone_temp) && zone_temp >= 0)
+            temp = zone_temp;
+        if (temp < 0 || fan_get_range(i, &lo, &hi) != 0)
+            continue;
+        if ((int)lo < g->min_speed)
+            lo = (unsigned int)g->min_speed;
+        if ((int)hi > g->max_speed)
+            hi = (unsigned int)g->max_speed;
+        if (lo > hi)
+            lo = hi;
+
+        int initial = g->fan_count > 0 && g->fan_speed[0] >= 0
+                      ? g->fan_speed[0] : curve_lookup(&gpu_curves(st, i)->table, temp);
+        double dt = g->pid.active ? now - g->pid_at : 0.0;
+        int speed = pid_update(&g->pid, &g->gains, g->target, temp, dt,
+                               (int)lo, (int)hi, initial);
+        g->pid_at = now;
+        fan_set_gpu_speed(i, (unsigned int)speed);
     }
-
-    free(curve);
 }
 
 /* Returns: 1=save, 0=discard, -1=cancel */
@@ -612,6 +958,28 @@ static int prompt_save_dashboard(int rows) {
     }
 }
 
+/* Value written alongside a mode change: speed for manual, °C for target */
+static int mode_value(const GpuData *g, const char *mode) {
+    if (strcmp(mode, "manual") == 0)
+        return g->manual_speed < 30 ? 50 : g->manual_speed;
+    if (strcmp(mode, "target") == 0)
+        return g->target;
+    return 0;
+}
+
+static void adjust_target(DashboardState *st, int delta) {
+    int t = st->gpus[st->selected_gpu].target + delta;
+    if (t < NVFD_TARGET_MIN) t = NVFD_TARGET_MIN;
+    if (t > NVFD_TARGET_MAX) t = NVFD_TARGET_MAX;
+    if (st->sync_all) {
+        for (unsigned int i = 0; i < st->gpu_count; i++)
+            apply_mode(st, i, "target", t);
+    } else {
+        apply_mode(st, st->selected_gpu, "target", t);
+    }
+    st->dirty = 1;
+}
+
 static void handle_input(DashboardState *st, int ch) {
     GpuData *g = &st->gpus[st->selected_gpu];
 
@@ -625,8 +993,13 @@ static void handle_input(DashboardState *st, int ch) {
                 st->running = 0;
             } else if (choice == 0) {
                 /* Discard: restore initial config and fan state */
-                for (unsigned int i = 0; i < st->gpu_count; i++)
-                    apply_mode(i, st->init_mode[i], st->init_speed[i]);
+                for (unsigned int i = 0; i < st->gpu_count; i++) {
+                    const GpuData *gi = &st->gpus[i];
+                    apply_mode(st, i, gi->init_mode,
+                               strcmp(gi->init_mode, "target") == 0
+                               ? gi->init_target : gi->init_speed);
+                    set_profile(st, i, gi->init_profile);
+                }
                 st->running = 0;
             }
             /* choice == -1: cancel, stay in dashboard */
@@ -660,89 +1033,120 @@ static void handle_input(DashboardState *st, int ch) {
             new_mode = "manual";
         else if (strcmp(g->mode, "manual") == 0)
             new_mode = "curve";
+        else if (strcmp(g->mode, "curve") == 0)
+            new_mode = "target";
+        else if (strcmp(g->mode, "target") == 0)
+            new_mode = "clocks";
+        else if (strcmp(g->mode, "clocks") == 0)
+            new_mode = "efficiency";
         else
             new_mode = "auto";
         if (target_all) {
-            for (unsigned int i = 0; i < st->gpu_count; i++) {
-                int spd = 0;
-                if (strcmp(new_mode, "manual") == 0) {
-                    spd = st->gpus[i].manual_speed;
-                    if (spd < 30) spd = 50;
-                }
-                apply_mode(i, new_mode, spd);
-            }
+            for (unsigned int i = 0; i < st->gpu_count; i++)
+                apply_mode(st, i, new_mode, mode_value(&st->gpus[i], new_mode));
         } else {
-            int spd = g->manual_speed;
-            if (strcmp(new_mode, "manual") == 0 && spd < 30) spd = 50;
-            apply_mode(st->selected_gpu, new_mode,
-                       strcmp(new_mode, "manual") == 0 ? spd : 0);
+            apply_mode(st, st->selected_gpu, new_mode, mode_value(g, new_mode));
         }
         st->dirty = 1;
         break;
     }
 
     case KEY_UP:
-        if (strcmp(g->mode, "manual") == 0) {
+        if (strcmp(g->mode, "target") == 0)
+            adjust_target(st, 1);
+        else if (strcmp(g->mode, "manual") == 0) {
             int spd = g->manual_speed + 5;
             if (spd > 100) spd = 100;
             if (st->sync_all) {
                 for (unsigned int i = 0; i < st->gpu_count; i++)
-                    apply_mode(i, "manual", spd);
+                    apply_mode(st, i, "manual", spd);
             } else {
-                apply_mode(st->selected_gpu, "manual", spd);
+                apply_mode(st, st->selected_gpu, "manual", spd);
             }
             st->dirty = 1;
         }
         break;
 
     case KEY_DOWN:
-        if (strcmp(g->mode, "manual") == 0) {
+        if (strcmp(g->mode, "target") == 0)
+            adjust_target(st, -1);
+        else if (strcmp(g->mode, "manual") == 0) {
             int spd = g->manual_speed - 5;
             if (spd < 30) spd = 30;
             if (st->sync_all) {
                 for (unsigned int i = 0; i < st->gpu_count; i++)
-                    apply_mode(i, "manual", spd);
+                    apply_mode(st, i, "manual", spd);
             } else {
-                apply_mode(st->selected_gpu, "manual", spd);
+                apply_mode(st, st->selected_gpu, "manual", spd);
             }
             st->dirty = 1;
         }
         break;
 
     case KEY_PPAGE:
-        if (strcmp(g->mode, "manual") == 0) {
+        if (strcmp(g->mode, "target") == 0)
+            adjust_target(st, 5);
+        else if (strcmp(g->mode, "manual") == 0) {
             int spd = g->manual_speed + 10;
             if (spd > 100) spd = 100;
             if (st->sync_all) {
                 for (unsigned int i = 0; i < st->gpu_count; i++)
-                    apply_mode(i, "manual", spd);
+                    apply_mode(st, i, "manual", spd);
             } else {
-                apply_mode(st->selected_gpu, "manual", spd);
+                apply_mode(st, st->selected_gpu, "manual", spd);
             }
             st->dirty = 1;
         }
         break;
 
     case KEY_NPAGE:
-        if (strcmp(g->mode, "manual") == 0) {
+        if (strcmp(g->mode, "target") == 0)
+            adjust_target(st, -5);
+        else if (strcmp(g->mode, "manual") == 0) {
             int spd = g->manual_speed - 10;
             if (spd < 30) spd = 30;
             if (st->sync_all) {
                 for (unsigned int i = 0; i < st->gpu_count; i++)
-                    apply_mode(i, "manual", spd);
+                    apply_mode(st, i, "manual", spd);
             } else {
-                apply_mode(st->selected_gpu, "manual", spd);
+                apply_mode(st, st->selected_gpu, "manual", spd);
             }
             st->dirty = 1;
         }
         break;
 
+    case 'p':
+    case 'P': {
+        /* No profile, then each profile in name order */
+        if (!st->config || st->config->profile_count == 0)
+            break;
+        const Profile *first = st->config->profiles;
+        const Profile *next = !g->profile ? first
+                            : g->profile + 1 < first + st->config->profile_count
+                            ? g->profile + 1 : NULL;
+        if (st->sync_all) {
+            for (unsigned int i = 0; i < st->gpu_count; i++)
+                set_profile(st, i, next);
+        } else {
+            set_profile(st, st->selected_gpu, next);
+        }
+        st->dirty = 1;
+        break;
+    }
     case 'e':
     case 'E':
         if (strcmp(g->mode, "curve") != 0)
             break;
         config_ensure_dir();
-        editor_run();
+        /* Edit the curve this GPU follows: its own, else the default */
+        {
+            const GpuCurve *own = curve_set_gpu(st->curves, st->selected_gpu);
+            CurveSelector sel = { -1, -1 };
+            if (own && own->curve.point_count > 0)
+                sel.gpu = (int)st->selected_gpu;
+            editor_run(sel);
+        }
+        st->curve_loaded = 0;
         /* Restore dashboard ncurses settings */
         init_colors();
         timeout(1000);
@@ -761,6 +1165,31 @@ int dashboard_run(void) {
     st.selected_gpu = 0;
     st.dirty = 0;
 
+    if (device_count == 0) {
+        fprintf(stderr, "Error: No GPUs detected\n");
+        return -1;
+    }
+    if (dashboard_alloc(&st) != 0) {
+        fprintf(stderr, "Error: Out of memory for %u GPUs\n", device_count);
+        dashboard_free(&st);
+        return -1;
+    }
+
+    /* Profiles are compiled once; problems are reported before the screen
+     * takes over, and the dashboard then runs without them */
+    st.config = config_snapshot_load();
+    if (st.config && st.config->profile_count > 0) {
+        char (*active)[NVFD_PROFILE_NAME_MAX] = calloc(st.gpu_count, sizeof(*active));
+        int from_daemon = active && control_active_profiles(active, st.gpu_count) == 0;
+        for (unsigned int i = 0; i < st.gpu_count; i++) {
+            const GpuPolicy *policy = config_snapshot_policy(st.config, i);
+            const char *name = from_daemon ? active[i] : policy ? policy->profile : "";
+            st.gpus[i].profile = name[0] ? config_snapshot_profile(st.config, name) : NULL;
+            st.gpus[i].init_profile = st.gpus[i].profile;
+        }
+        free(active);
+    }
+
     /* Must set locale before initscr() for UTF-8 support */
     setlocale(LC_ALL, "");
 
@@ -777,14 +1206,17 @@ int dashboard_run(void) {
     /* Capture initial state for save/discard on quit */
     dashboard_refresh_data(&st);
     for (unsigned int i = 0; i < st.gpu_count; i++) {
-        strncpy(st.init_mode[i], st.gpus[i].mode, sizeof(st.init_mode[i]) - 1);
-        st.init_mode[i][sizeof(st.init_mode[i]) - 1] = '\0';
-        st.init_speed[i] = st.gpus[i].manual_speed;
+        GpuData *g = &st.gpus[i];
+        strncpy(g->init_mode, g->mode, sizeof(g->init_mode) - 1);
+        g->init_mode[sizeof(g->init_mode) - 1] = '\0';
+        g->init_speed = g->manual_speed;
+        g->init_target = g->target;
     }
 
     while (st.running && keep_running) {
         dashboard_refresh_data(&st);
         apply_curve_fans(&st);
+        apply_target_fans(&st);
         draw_screen(&st);
         int ch = getch();
         if (ch != ERR)
@@ -792,5 +1224,6 @@ int dashboard_run(void) {
     }
 
     endwin();
+    dashboard_free(&st);
     return 0;
 }
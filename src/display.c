@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <jansson.h>
 #include "display.h"
@@ -6,6 +7,8 @@
 #include "fan.h"
 #include "curve.h"
 #include "config.h"
+#include "control.h"
+#include "sensor.h"
 
 void display_help(void) {
     printf("NVIDIA Fan Daemon (NVFD) v%s\n\n", NVFD_VERSION);
@@ -18,13 +21,27 @@ void display_help(void) {
     printf("+-----------------------------+-----------------------------------------+\n");
     printf("| nvfd curve                  | Enable custom fan curve for all GPUs    |\n");
     printf("+-----------------------------+-----------------------------------------+\n");
-    printf("| nvfd curve <temp> <speed>   | Edit fan curve point                    |\n");
+    printf("| nvfd curve <temp> <speed>   | Edit default fan curve point            |\n");
     printf("+-----------------------------+-----------------------------------------+\n");
-    printf("| nvfd curve show             | Show current fan curve                  |\n");
+    printf("| nvfd curve <sel> <t> <spd>  | Edit a GPU or fan curve point           |\n");
     printf("+-----------------------------+-----------------------------------------+\n");
-    printf("| nvfd curve edit             | Interactive curve editor (ncurses)      |\n");
+    printf("| nvfd curve show [sel]       | Show fan curve(s)                       |\n");
     printf("+-----------------------------+-----------------------------------------+\n");
-    printf("| nvfd curve reset            | Reset fan curve to default              |\n");
+    printf("| nvfd curve edit [sel]       | Interactive curve editor (ncurses)      |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd curve reset [sel]      | Reset default, or drop a GPU/fan curve  |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd target <temp>          | Hold all GPUs at a temperature (PID)    |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd target <gpu> <temp>    | Hold one GPU at a temperature           |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd clocks [gpu]           | Cool to keep boost clocks (learned)     |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd efficiency [gpu]       | Fan speed for least board + fan power   |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd profile                | List profiles and the active ones       |\n");
+    printf("+-----------------------------+-----------------------------------------+\n");
+    printf("| nvfd profile <name> [gpu]   | Switch the daemon to a profile ('none') |\n");
     printf("+-----------------------------+-----------------------------------------+\n");
     printf("| nvfd <speed>                | Set fixed fan speed for all GPUs (30-100)|\n");
     printf("+-----------------------------+-----------------------------------------+\n");
@@ -36,39 +53,60 @@ void display_help(void) {
     printf("+-----------------------------+-----------------------------------------+\n");
     printf("| nvfd -h                     | Show this help message                  |\n");
     printf("+-----------------------------+-----------------------------------------+\n");
+    printf("<sel> is a GPU index (1), a GPU fan (1:0), or 'default'.\n");
 }
 
 void display_status(void) {
     json_t *root = config_read();
+    char (*active)[NVFD_PROFILE_NAME_MAX] = device_count > 0
+        ? calloc(device_count, sizeof(*active)) : NULL;
+    if (active && control_active_profiles(active, device_count) != 0) {
+        free(active);
+        active = NULL;
+    }
 
     printf("\n==================================================\n");
     printf("NVFD v%s - GPU Status\n", NVFD_VERSION);
     printf("==================================================\n");
 
     for (unsigned int i = 0; i < device_count; i++) {
-        char gpu_key[20];
-        snprintf(gpu_key, sizeof(gpu_key), "gpu%d", i);
-        json_t *cfg = json_object_get(root, gpu_key);
+        json_t *cfg = config_gpu_entry(root, i);
 
-        nvmlDevice_t device;
-        if (gpu_get_handle(i, &device) != 0)
+        const GpuDevice *dev = gpu_device(i);
+        if (!dev)
             continue;
 
-        char name[NVML_DEVICE_NAME_BUFFER_SIZE];
-        gpu_get_name(device, name, sizeof(name));
-
+        nvmlDevice_t device = dev->handle;
         int temp = gpu_get_temperature(device);
-        int num_fans = fan_get_count(device);
+        int num_fans = (int)dev->fan_count;
 
-        printf("GPU %u: %s\n", i, name);
+        printf("GPU %u: %s\n", i, dev->name);
 
-        if (json_is_object(cfg)) {
+        if (active && active[i][0]) {
+            printf("  Profile: %s\n", active[i]);
+        } else if (json_is_object(cfg)) {
             const char *mode = json_string_value(json_object_get(cfg, "mode"));
             if (mode && strcmp(mode, "manual") == 0) {
                 int speed = (int)json_integer_value(json_object_get(cfg, "speed"));
                 printf("  Mode: Fixed speed %d%%\n", speed);
             } else if (mode && strcmp(mode, "curve") == 0) {
                 printf("  Mode: Custom curve\n");
+            } else if (mode && strcmp(mode, "target") == 0) {
+                int target;
+                PidGains gains;
+                config_entry_target(cfg, &target, &gains);
+                printf("  Mode: Target %d°C (kp %g, ki %g, kd %g)\n",
+                       target, gains.kp, gains.ki, gains.kd);
+            } else if (mode && strcmp(mode, "clocks") == 0) {
+                int target;
+                PidGains gains;
+                config_entry_target(cfg, &target, &gains);
+                printf("  Mode: Clocks, at most %d°C\n", target);
+            } else if (mode && strcmp(mode, "efficiency") == 0) {
+                int target;
+                PidGains gains;
+                config_entry_target(cfg, &target, &gains);
+                printf("  Mode: Efficiency, at most %d°C\n", target);
             } else {
                 printf("  Mode: Auto (driver-controlled)\n");
             }
@@ -77,6 +115,8 @@ void display_status(void) {
         }
 
         printf("  Temperature: %d°C\n", temp);
+        if (dev->has_mem_temp)
+            printf("  Memory: %d°C\n", gpu_get_memory_temperature(device));
 
         for (int f = 0; f < num_fans; f++) {
             int spd = fan_get_speed(device, (unsigned int)f);
@@ -86,40 +126,181 @@ void display_status(void) {
         printf("\n");
     }
 
+    free(active);
     json_decref(root);
 }
 
+static void print_policy(const GpuPolicy *policy) {
+    printf("%s", config_mode_name(policy->mode));
+    if (policy->mode == FAN_MODE_MANUAL)
+        printf(" %d%%", policy->speed);
+    else if (policy->mode == FAN_MODE_TARGET)
+        printf(" %d°C", policy->target);
+    else if (policy->mode == FAN_MODE_CLOCKS)
+        printf(" %d-%d°C", policy->clocks.floor, policy->target);
+    else if (policy->mode == FAN_MODE_EFFICIENCY)
+        printf(" up to %d°C, %g W per fan", policy->target, policy->efficiency.fan_watts);
+    if (policy->min_speed > 0 || policy->max_speed < 100)
+        printf(", fans %d-%d%%", policy->min_speed, policy->max_speed);
+    if (policy->sensor.count > 0) {
+        char text[64];
+        sensor_format(&policy->sensor, text, sizeof(text));
+        printf(", sensor %s", text);
+    }
+}
+
+void display_profiles(void) {
+    ConfigSnapshot *snap = config_snapshot_load();
+    if (!snap)
+        return; /* the loader said why */
+
+    if (snap->profile_count == 0) {
+        printf("No profiles in %s.\n", NVFD_PROFILE_DIR);
+    } else {
+        printf("Profiles in %s:\n", NVFD_PROFILE_DIR);
+        for (int i = 0; i < snap->profile_count; i++) {
+            const Profile *profile = &snap->profiles[i];
+            printf("  %-16s ", profile->name);
+            print_policy(&profile->policy);
+            printf("%s\n", profile->curves ? ", own curve" : "");
+        }
+    }
+
+    if (snap->rule_count > 0) {
+        printf("\nRules (first match wins, checked every %d s):\n", snap->rule_poll_s);
+        for (int i = 0; i < snap->rule_count; i++) {
+            const ProcessRule *rule = &snap->rules[i];
+            printf("  ");
+            if (rule->process.text)
+                printf("process %s ", rule->process.text);
+            if (rule->cgroup.text)
+                printf("cgroup %s ", rule->cgroup.text);
+            printf("-> %s\n", rule->name);
+        }
+    }
+
+    char (*active)[NVFD_PROFILE_NAME_MAX] = device_count > 0
+        ? calloc(device_count, sizeof(*active)) : NULL;
+    if (active && control_active_profiles(active, device_count) == 0) {
+        printf("\nActive in the daemon:\n");
+        for (unsigned int i = 0; i < device_count; i++)
+            printf("  GPU %u: %s\n", i, active[i][0] ? active[i] : "(config.json)");
+    } else if (active) {
+        printf("\nThe daemon is not running.\n");
+    }
+    free(active);
+    config_snapshot_free(snap);
+}
+
+static void print_threshold(const char *what, int temp) {
+    if (temp >= 0)
+        printf("  %s %d°C", what, temp);
+}
+
+/* Only what the driver reports; older boards leave most of these out */
+static void print_thresholds(const GpuDevice *dev) {
+    if (dev->slowdown_temp < 0 && dev->shutdown_temp < 0 &&
+        dev->gpu_max_temp < 0 && dev->mem_max_temp < 0 && !dev->has_mem_temp)
+        return;
+    printf("       ");
+    print_threshold("slowdown", dev->slowdown_temp);
+    print_threshold("shutdown", dev->shutdown_temp);
+    print_threshold("gpu max", dev->gpu_max_temp);
+    print_threshold("mem max", dev->mem_max_temp);
+    printf("%s\n", dev->has_mem_temp ? "  (memory sensor)" : "");
+}
+
 void display_list_gpus(void) {
     printf("Detected GPUs:\n");
     for (unsigned int i = 0; i < device_count; i++) {
-        nvmlDevice_t device;
-        if (gpu_get_handle(i, &device) != 0)
+        const GpuDevice *dev = gpu_device(i);
+        if (!dev)
             continue;
 
-        char name[NVML_DEVICE_NAME_BUFFER_SIZE];
-        gpu_get_name(device, name, sizeof(name));
+        printf("  GPU %u: %s (%u fan%s)\n", i, dev->name, dev->fan_count,
+               dev->fan_count != 1 ? "s" : "");
+        printf("         %s  %s  fan range %u-%u%%\n", dev->uuid, dev->pci_bus_id,
+               dev->fan_min, dev->fan_max);
+        print_thresholds(dev);
+    }
+}
+
+static void print_points(const FanCurve *curve) {
+    printf("+--------------+-----------------+\n");
+    printf("| Temperature  | Fan Speed       |\n");
+    printf("+--------------+-----------------+\n");
+    for (int i = 0; i < curve->point_count; i++) {
+        printf("| %6d °C    | %6d %%        |\n",
+               curve->points[i].temperature,
+               curve->points[i].fan_speed);
+    }
+    printf("+--------------+-----------------+\n");
+    if (curve->interpolation != CURVE_LINEAR)
+        printf("Interpolation: %s\n", curve_interpolation_name(curve->interpolation));
+    if (curve->hysteresis > 0 || curve->hold_s > 0.0)
+        printf("Ramp-down: hysteresis %d °C, hold %.1f s\n",
+               curve->hysteresis, curve->hold_s);
+    if (curve->sensor.count > 0) {
+        char text[64];
+        sensor_format(&curve->sensor, text, sizeof(text));
+        printf("Sensor: %s\n", text);
+    }
+}
 
-        int num_fans = fan_get_count(device);
-        printf("  GPU %u: %s (%d fan%s)\n", i, name, num_fans,
-               num_fans != 1 ? "s" : "");
+static void show_selected(const CurveSet *set, CurveSelector sel) {
+    char what[48];
+    curve_describe(sel, what, sizeof(what));
+
+    const FanCurve *curve = sel.gpu < 0 ? (set->def.point_count > 0 ? &set->def : NULL)
+                                        : curve_resolve(set, (unsigned int)sel.gpu, sel.fan);
+    const GpuCurve *gc = sel.gpu >= 0 ? curve_set_gpu(set, (unsigned int)sel.gpu) : NULL;
+    const char *source = "";
+    if (sel.gpu >= 0 && curve == NULL)
+        source = " (inherited: built-in curve)";
+    else if (sel.gpu >= 0 && curve == &set->def)
+        source = " (inherited from the default curve)";
+    else if (sel.fan >= 0 && gc && curve == &gc->curve)
+        source = " (inherited from the GPU curve)";
+
+    if (!curve) {
+        printf("The %s is not set%s.\n", what, source);
+        return;
     }
+    printf("Current %s%s:\n", what, source);
+    print_points(curve);
 }
 
-void display_fan_curve(void) {
-    FanCurve *curve = curve_read();
-    if (curve) {
+void display_fan_curve(const CurveSelector *sel) {
+    CurveSet *set = curve_read();
+    if (!set) {
+        printf("Fan curve is not set. Use 'nvfd curve reset' to create default.\n");
+        return;
+    }
+
+    if (sel) {
+        show_selected(set, *sel);
+        curve_set_free(set);
+        return;
+    }
+
+    if (set->def.point_count > 0) {
         printf("Current fan curve:\n");
-        printf("+--------------+-----------------+\n");
-        printf("| Temperature  | Fan Speed       |\n");
-        printf("+--------------+-----------------+\n");
-        for (int i = 0; i < curve->point_count; i++) {
-            printf("| %6d °C    | %6d %%        |\n",
-                   curve->points[i].temperature,
-                   curve->points[i].fan_speed);
-        }
-        printf("+--------------+-----------------+\n");
-        free(curve);
+        print_points(&set->def);
     } else {
-        printf("Fan curve is not set. Use 'nvfd curve reset' to create default.\n");
+        printf("Default fan curve is not set; GPUs without their own use the built-in curve.\n");
+    }
+
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuCurve *gc = curve_set_gpu(set, i);
+        if (!gc)
+            continue;
+        if (gc->curve.point_count > 0)
+            printf("GPU %u: own curve, %d points\n", i, gc->curve.point_count);
+        for (unsigned int f = 0; f < gc->fan_count; f++) {
+            if (gc->fans[f].point_count > 0)
+                printf("GPU %u fan %u: own curve, %d points\n",
+                       i, f, gc->fans[f].point_count);
+        }
     }
+    curve_set_free(set);
 }
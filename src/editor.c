@@ -31,8 +31,10 @@
 #define CP_PROMPT    7
 
 typedef struct {
-    FanCurve   curve;
-    FanCurve   original;   /* for reset */
+    CurveSet  *set;        /* whole curve file, written back on save */
+    FanCurve  *target;     /* the curve being edited, inside set */
+    char       what[48];   /* "default curve", "GPU 1 curve", ... */
+    FanCurve   curve;      /* working copy */
     int        selected;   /* index of selected point */
     int        dirty;      /* unsaved changes */
     int        running;
@@ -56,10 +58,14 @@ static int col_to_temp(int col) {
     return t < TEMP_MIN ? TEMP_MIN : (t > TEMP_MAX ? TEMP_MAX : t);
 }
 
-static void draw_title(void) {
+static void draw_title(const EditorState *st) {
     attron(COLOR_PAIR(CP_TITLE) | A_BOLD);
     mvprintw(0, 2, "NVFD Fan Curve Editor");
     attroff(COLOR_PAIR(CP_TITLE) | A_BOLD);
+    attron(COLOR_PAIR(CP_AXIS));
+    mvprintw(1, 2, "Editing the %s  [i]Interpolation: %s", st->what,
+             curve_interpolation_name(st->curve.interpolation));
+    attroff(COLOR_PAIR(CP_AXIS));
     attron(COLOR_PAIR(CP_STATUS));
     mvprintw(0, GRAPH_LEFT + GRAPH_COLS - 22, "[s]Save [q]Quit [r]Reset");
     attroff(COLOR_PAIR(CP_STATUS));
@@ -102,13 +108,17 @@ static void draw_interpolated_line(const FanCurve *curve) {
     if (curve->point_count < 2)
         return;
 
+    /* Same table the daemon evaluates, so the line matches what it applies */
+    CurveTable table;
+    curve_compile(curve, &table);
+
     attron(COLOR_PAIR(CP_LINE));
 
     for (int col = temp_to_col(curve->points[0].temperature);
          col <= temp_to_col(curve->points[curve->point_count - 1].temperature);
          col++) {
         int temp = col_to_temp(col);
-        int speed = curve_interpolate(temp, curve);
+        int speed = curve_lookup(&table, temp);
         int row = speed_to_row(speed);
 
         /* Don't draw over point markers */
@@ -183,7 +193,7 @@ static void draw_status(const EditorState *st) {
 
 static void draw_screen(const EditorState *st) {
     erase();
-    draw_title();
+    draw_title(st);
     draw_axes();
     draw_interpolated_line(&st->curve);
     draw_points(st);
@@ -226,6 +236,13 @@ static int temp_conflicts(const EditorState *st, int temp, int exclude_idx) {
     return 0;
 }
 
+/* Puts the working copy into the curve file */
+static int save(EditorState *st) {
+    if (curve_copy(st->target, &st->curve) != 0)
+        return -1;
+    return curve_write(st->set);
+}
+
 /* Returns: 1=save&quit, 0=discard&quit, -1=cancel */
 static int prompt_save(void) {
     int row = GRAPH_TOP + GRAPH_ROWS + 5;
@@ -292,7 +309,7 @@ static void handle_input(EditorState *st, int ch) {
             int choice = prompt_save();
             if (choice == 1) {
                 /* Save and quit */
-                curve_write(&st->curve);
+                save(st);
                 st->dirty = 0;
                 st->running = 0;
             } else if (choice == 0) {
@@ -307,26 +324,27 @@ static void handle_input(EditorState *st, int ch) {
 
     case 's':
     case 'S':
-        if (curve_write(&st->curve) == 0) {
+        if (save(st) == 0) {
             st->dirty = 0;
             st->running = 0;
         }
         break;
 
     case 'r':
-    case 'R': {
-        FanCurve def = {
-            .points = {
-                {30, 30}, {40, 40}, {50, 55},
-                {60, 65}, {70, 85}, {80, 100}
-            },
-            .point_count = 6
-        };
-        st->curve = def;
-        st->selected = 0;
+    case 'R':
+        if (curve_fill_default(&st->curve) == 0) {
+            st->selected = 0;
+            st->dirty = 1;
+        }
+        break;
+
+    case 'i':
+    case 'I':
+        st->curve.interpolation = st->curve.interpolation == CURVE_STEP
+                                ? CURVE_LINEAR
+                                : st->curve.interpolation + 1;
         st->dirty = 1;
         break;
-    }
 
     case '\t':
         if (st->curve.point_count > 0)
@@ -388,12 +406,9 @@ static void handle_input(EditorState *st, int ch) {
 
     case 'a':
     case 'A':
-        if (st->curve.point_count >= MAX_CURVE_POINTS)
-            break;
         if (st->curve.point_count == 0) {
-            st->curve.points[0].temperature = 50;
-            st->curve.points[0].fan_speed = 50;
-            st->curve.point_count = 1;
+            if (curve_set_point(&st->curve, 50, 50) < 0)
+                break;
             st->selected = 0;
             st->dirty = 1;
         } else {
@@ -420,12 +435,10 @@ static void handle_input(EditorState *st, int ch) {
             if (new_speed < SPEED_MIN) new_speed = SPEED_MIN;
             if (new_speed > SPEED_MAX) new_speed = SPEED_MAX;
 
-            int idx = st->curve.point_count;
-            st->curve.points[idx].temperature = new_temp;
-            st->curve.points[idx].fan_speed = new_speed;
-            st->curve.point_count++;
+            int idx = curve_set_point(&st->curve, new_temp, new_speed);
+            if (idx < 0)
+                break;
             st->selected = idx;
-            sort_points(st);
             st->dirty = 1;
         }
         break;
@@ -434,9 +447,7 @@ static void handle_input(EditorState *st, int ch) {
     case 'D':
         if (st->curve.point_count <= 2)
             break;  /* Enforce minimum 2 points */
-        for (int i = st->selected; i < st->curve.point_count - 1; i++)
-            st->curve.points[i] = st->curve.points[i + 1];
-        st->curve.point_count--;
+        curve_remove_point(&st->curve, st->selected);
         if (st->selected >= st->curve.point_count)
             st->selected = st->curve.point_count - 1;
         st->dirty = 1;
@@ -499,28 +510,27 @@ static void handle_input(EditorState *st, int ch) {
     }
 }
 
-int editor_run(void) {
-    /* Load current curve */
-    FanCurve *loaded = curve_read();
+int editor_run(CurveSelector sel) {
     EditorState st;
     memset(&st, 0, sizeof(st));
 
-    if (loaded) {
-        st.curve = *loaded;
-        free(loaded);
-    } else {
-        /* No curve file — use default */
-        FanCurve def = {
-            .points = {
-                {30, 30}, {40, 40}, {50, 55},
-                {60, 65}, {70, 85}, {80, 100}
-            },
-            .point_count = 6
-        };
-        st.curve = def;
+    /* Load current curves; a missing file starts an empty set */
+    st.set = curve_read();
+    if (!st.set)
+        st.set = curve_set_new();
+    st.target = st.set ? curve_select(st.set, sel) : NULL;
+    if (!st.target) {
+        curve_set_free(st.set);
+        return -1;
     }
+    curve_describe(sel, st.what, sizeof(st.what));
+
+    curve_init(&st.curve);
+    if (st.target->point_count > 0)
+        curve_copy(&st.curve, st.target);
+    else
+        curve_fill_default(&st.curve); /* no default curve yet */
 
-    st.original = st.curve;
     st.selected = 0;
     st.dirty = 0;
     st.running = 1;
@@ -562,5 +572,7 @@ int editor_run(void) {
     if (standalone)
         endwin();
 
+    curve_free(&st.curve);
+    curve_set_free(st.set);
     return 0;
 }
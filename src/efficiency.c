@@ -0,0 +1,109 @@
+#include "efficiency.h"
+#include "nvfd.h"
+
+void eff_defaults(EfficiencyParams *p) {
+    p->fan_watts = NVFD_EFF_FAN_WATTS_DEFAULT;
+    p->step = NVFD_EFF_STEP_DEFAULT;
+    p->dwell_s = NVFD_EFF_DWELL_S_DEFAULT;
+}
+
+static void start_dwell(Efficiency *e, double now) {
+    e->since = now;
+    e->sum = 0.0;
+    e->weight = 0.0;
+    e->util_lo = 101;
+    e->util_hi = -1;
+}
+
+void eff_reset(Efficiency *e) {
+    e->primed = 0;
+    e->searching = 0;
+    e->last = -1.0;
+}
+
+static int clamp(int v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+/* Fan power follows the cube of speed (fan affinity laws) */
+static double total_watts(const EfficiencyParams *p, int power_mw, unsigned int fans,
+                          int speed) {
+    double s = speed / 100.0;
+    return power_mw / 1000.0 + fans * p->fan_watts * s * s * s;
+}
+
+int eff_update(Efficiency *e, const EfficiencyParams *p, int max_temp, int temp,
+               int power_mw, int util, unsigned int fans, int curve_speed,
+               int lo, int hi, double dt, double now) {
+    curve_speed = clamp(curve_speed, lo, hi);
+    if (power_mw < 0) {
+        eff_reset(e);
+        return curve_speed;
+    }
+    if (!e->primed) {
+        e->primed = 1;
+        e->searching = 0;
+        e->dir = -1; /* quieter first */
+        e->last = -1.0;
+        start_dwell(e, now);
+    }
+
+    int speed = e->searching ? clamp(e->speed, lo, hi) : curve_speed;
+    e->speed = speed;
+    e->total = total_watts(p, power_mw, fans, speed);
+
+    /* Too hot: at least the curve's air, and judge afresh from there */
+    if (e->searching && temp >= max_temp) {
+        int next = speed + p->step;
+        e->speed = clamp(next > curve_speed ? next : curve_speed, lo, hi);
+        e->dir = 1;
+        e->last = -1.0;
+        start_dwell(e, now);
+        return e->speed;
+    }
+
+    if (util >= 0) {
+        if (util < e->util_lo)
+            e->util_lo = util;
+        if (util > e->util_hi)
+            e->util_hi = util;
+    }
+    if (e->util_hi - e->util_lo > NVFD_EFF_UTIL_BAND) {
+        /* Another load: what the last dwells measured no longer holds */
+        e->restarts++;
+        e->searching = 0;
+        e->last = -1.0;
+        start_dwell(e, now);
+        return curve_speed;
+    }
+
+    double elapsed = now - e->since;
+    if (elapsed >= p->dwell_s / 2.0) {
+        e->sum += e->total * dt;
+        e->weight += dt;
+    }
+    if (elapsed < p->dwell_s || e->weight <= 0.0)
+        return speed;
+
+    double avg = e->sum / e->weight;
+    if (!e->searching) {
+        e->curve_w = avg;
+        e->curve_speed = speed;
+        e->searching = 1;
+    } else {
+        e->saved_j += (e->curve_w - avg) * elapsed;
+        e->judged_s += elapsed;
+        if (e->last >= 0.0 && avg > e->last)
+            e->dir = -e->dir;
+    }
+    e->last = avg;
+
+    int next = speed + e->dir * p->step;
+    if (next < lo || next > hi) {
+        e->dir = -e->dir;
+        next = speed + e->dir * p->step;
+    }
+    e->speed = clamp(next, lo, hi);
+    start_dwell(e, now);
+    return e->speed;
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include "events.h"
+#include "gpu.h"
+
+/* What nvfd listens for; each GPU registers the ones it supports */
+#define EVENTS_WANTED (nvmlEventTypeClock | nvmlEventTypeXidCriticalError | \
+                       nvmlEventTypePowerSourceChange)
+
+/* Waiters events_stop() left inside NVML that have not returned yet */
+static pthread_mutex_t left_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int    left_count;
+
+struct EventWaiter {
+    nvmlEventSet_t      set;
+    unsigned long long *registered;   /* per GPU */
+    pthread_t           thread;
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+    GpuEvent            queue[EVENTS_QUEUE_MAX];
+    unsigned int        head;
+    unsigned int        count;
+    unsigned long long  dropped;
+    int                 failed;
+    int                 stop;
+    int                 exited;
+    int                 detached;  /* events_stop() gave up; frees itself */
+    int                 event_fd;
+};
+
+static int device_index(nvmlDevice_t handle) {
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        if (dev && dev->handle == handle)
+            return (int)i;
+    }
+    return -1;
+}
+
+static void notify(EventWaiter *w) {
+    uint64_t one = 1;
+    if (write(w->event_fd, &one, sizeof(one)) < 0)
+        perror("events: eventfd write");
+}
+
+/* A full queue drops its oldest event: the newest say most about now */
+static void push(EventWaiter *w, const GpuEvent *ev) {
+    if (w->count == EVENTS_QUEUE_MAX) {
+        w->head = (w->head + 1) % EVENTS_QUEUE_MAX;
+        w->count--;
+        w->dropped++;
+    }
+    w->queue[(w->head + w->count) % EVENTS_QUEUE_MAX] = *ev;
+    w->count++;
+}
+
+static void waiter_free(EventWaiter *w) {
+    if (w->set)
+        nvmlEventSetFree(w->set);
+    if (w->event_fd >= 0)
+        close(w->event_fd);
+    free(w->registered);
+    free(w);
+}
+
+static void *waiter_main(void *arg) {
+    EventWaiter *w = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        int stop = w->stop;
+        pthread_mutex_unlock(&w->lock);
+        if (stop)
+            break;
+
+        nvmlEventData_t data;
+        memset(&data, 0, sizeof(data));
+        nvmlReturn_t ret = nvmlEventSetWait_v2(w->set, &data, NVFD_EVENT_WAIT_MS);
+        if (ret == NVML_ERROR_TIMEOUT)
+            continue;
+
+        if (ret != NVML_SUCCESS) {
+            pthread_mutex_lock(&w->lock);
+            w->failed = 1;
+            pthread_mutex_unlock(&w->lock);
+            notify(w);
+            break;
+        }
+
+        pthread_mutex_lock(&w->lock);
+        stop = w->stop;
+        pthread_mutex_unlock(&w->lock);
+        if (stop)
+            break;
+
+        int index = device_index(data.device);
+        if (index < 0)
+            continue;
+        GpuEvent ev = { (unsigned int)index, data.eventType, data.eventData };
+        pthread_mutex_lock(&w->lock);
+        push(w, &ev);
+        pthread_mutex_unlock(&w->lock);
+        notify(w);
+    }
+
+    pthread_mutex_lock(&w->lock);
+    w->exited = 1;
+    int detached = w->detached;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+
+    if (detached) {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+        waiter_free(w);
+        pthread_mutex_lock(&left_lock);
+        left_count--;
+        pthread_mutex_unlock(&left_lock);
+    }
+    return NULL;
+}
+
+EventWaiter *events_start(void) {
+    if (device_count == 0)
+        return NULL;
+    EventWaiter *w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    w->event_fd = -1;
+    w->registered = calloc(device_count, sizeof(*w->registered));
+    if (!w->registered || nvmlEventSetCreate(&w->set) != NVML_SUCCESS) {
+        w->set = NULL;
+        waiter_free(w);
+        return NULL;
+    }
+
+    int any = 0;
+    for (unsigned int i = 0; i < device_count; i++) {
+        const GpuDevice *dev = gpu_device(i);
+        unsigned long long supported = 0;
+        if (!dev || nvmlDeviceGetSupportedEventTypes(dev->handle, &supported) != NVML_SUCCESS)
+            continue;
+        unsigned long long types = supported & EVENTS_WANTED;
+        if (types && nvmlDeviceRegisterEvents(dev->handle, types, w->set) == NVML_SUCCESS) {
+            w->registered[i] = types;
+            any = 1;
+        }
+    }
+    if (!any) {
+        waiter_free(w);
+        return NULL;
+    }
+
+    w->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->event_fd < 0) {
+        perror("eventfd");
+        waiter_free(w);
+        return NULL;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+
+    /* Like the workers: signals belong to the main thread's signalfd */
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, NVFD_THREAD_STACK);
+    int started = pthread_create(&w->thread, &attr, waiter_main, w) == 0;
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (!started) {
+        fprintf(stderr, "Failed to start the NVML event waiter\n");
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+        waiter_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int events_stop(EventWaiter *w) {
+    if (!w)
+        return 0;
+
+    /* One wait to notice the flag, plus the time any NVML call may take */
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    long ms = NVFD_EVENT_WAIT_MS + NVFD_NVML_TIMEOUT_MS;
+    long ns = deadline.tv_nsec + (ms % 1000) * 1000000L;
+    deadline.tv_sec += ms / 1000 + ns / 1000000000L;
+    deadline.tv_nsec = ns % 1000000000L;
+
+    pthread_mutex_lock(&w->lock);
+    w->stop = 1;
+    while (!w->exited && pthread_cond_timedwait(&w->cond, &w->lock, &deadline) == 0)
+        ;
+    int exited = w->exited;
+    if (!exited) {
+        w->detached = 1;
+        pthread_mutex_lock(&left_lock);
+        left_count++;
+        pthread_mutex_unlock(&left_lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    /* Joining a thread blocked in the driver would hang shutdown */
+    if (!exited) {
+        pthread_detach(w->thread);
+        return -1;
+    }
+    pthread_join(w->thread, NULL);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    waiter_free(w);
+    return 0;
+}
+
+unsigned int events_left_behind(void) {
+    pthread_mutex_lock(&left_lock);
+    unsigned int n = left_count;
+    pthread_mutex_unlock(&left_lock);
+    return n;
+}
+
+unsigned long long events_registered(const EventWaiter *w, unsigned int gpu_index) {
+    return w && gpu_index < device_count ? w->registered[gpu_index] : 0;
+}
+
+int events_fd(const EventWaiter *w) {
+    return w->event_fd;
+}
+
+unsigned int events_read(EventWaiter *w, GpuEvent *out, unsigned int max,
+                         unsigned long long *dropped) {
+    uint64_t n;
+    while (read(w->event_fd, &n, sizeof(n)) == (ssize_t)sizeof(n))
+        ;
+
+    pthread_mutex_lock(&w->lock);
+    unsigned int taken = w->count < max ? w->count : max;
+    for (unsigned int k = 0; k < taken; k++)
+        out[k] = w->queue[(w->head + k) % EVENTS_QUEUE_MAX];
+    w->head = (w->head + taken) % EVENTS_QUEUE_MAX;
+    w->count -= taken;
+    *dropped = w->dropped;
+    w->dropped = 0;
+    pthread_mutex_unlock(&w->lock);
+    return taken;
+}
+
+int events_failed(EventWaiter *w) {
+    pthread_mutex_lock(&w->lock);
+    int failed = w->failed;
+    pthread_mutex_unlock(&w->lock);
+    return failed;
+}
+
+const char *events_name(unsigned long long type) {
+    if (type & nvmlEventTypeXidCriticalError)
+        return "Xid error";
+    if (type & nvmlEventTypePowerSourceChange)
+        return "power source change";
+    if (type & nvmlEventTypeClock)
+        return "clock change";
+    return "event";
+}
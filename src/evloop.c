@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include "evloop.h"
+
+#define EVLOOP_MAX_EVENTS (EVLOOP_MAX_SLOTS + 2)
+
+int evloop_init(EvLoop *loop, const sigset_t *signals,
+                EvTimerHandler on_timer, EvSignalHandler on_signal, void *arg) {
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = -1;
+    loop->timer_fd = -1;
+    loop->signal_fd = -1;
+    loop->on_timer = on_timer;
+    loop->on_signal = on_signal;
+    loop->arg = arg;
+    for (int i = 0; i < EVLOOP_MAX_SLOTS; i++)
+        loop->slots[i].fd = -1;
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->timer_fd < 0) {
+        perror("timerfd_create");
+        evloop_close(loop);
+        return -1;
+    }
+
+    /* Signals must be blocked before signalfd can see them */
+    if (sigprocmask(SIG_BLOCK, signals, NULL) != 0) {
+        perror("sigprocmask");
+        evloop_close(loop);
+        return -1;
+    }
+    loop->signal_fd = signalfd(-1, signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (loop->signal_fd < 0) {
+        perror("signalfd");
+        evloop_close(loop);
+        return -1;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.fd = loop->timer_fd;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->timer_fd, &ev) != 0) {
+        perror("epoll_ctl(timerfd)");
+        evloop_close(loop);
+        return -1;
+    }
+    ev.data.fd = loop->signal_fd;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->signal_fd, &ev) != 0) {
+        perror("epoll_ctl(signalfd)");
+        evloop_close(loop);
+        return -1;
+    }
+
+    return 0;
+}
+
+void evloop_close(EvLoop *loop) {
+    if (loop->signal_fd >= 0)
+        close(loop->signal_fd);
+    if (loop->timer_fd >= 0)
+        close(loop->timer_fd);
+    if (loop->epoll_fd >= 0)
+        close(loop->epoll_fd);
+    loop->signal_fd = -1;
+    loop->timer_fd = -1;
+    loop->epoll_fd = -1;
+}
+
+int evloop_arm(EvLoop *loop, double deadline) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    /* A zero it_value would disarm; anything already due fires at once */
+    if (deadline < 1e-9)
+        deadline = 1e-9;
+    its.it_value.tv_sec = (time_t)deadline;
+    its.it_value.tv_nsec = (long)((deadline - (double)its.it_value.tv_sec) * 1e9);
+
+    if (timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        perror("timerfd_settime");
+        return -1;
+    }
+    loop->deadline = deadline;
+    loop->armed_at = evloop_now();
+    return 0;
+}
+
+int evloop_add_fd(EvLoop *loop, int fd, uint32_t events,
+                  EvFdHandler handler, void *arg) {
+    for (int i = 0; i < EVLOOP_MAX_SLOTS; i++) {
+        if (loop->slots[i].fd >= 0)
+            continue;
+
+        struct epoll_event ev = { .events = events };
+        ev.data.fd = fd;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("epoll_ctl(add)");
+            return -1;
+        }
+        loop->slots[i].fd = fd;
+        loop->slots[i].handler = handler;
+        loop->slots[i].arg = arg;
+        return 0;
+    }
+    fprintf(stderr, "Event loop: no free fd slot (max %d)\n", EVLOOP_MAX_SLOTS);
+    return -1;
+}
+
+int evloop_del_fd(EvLoop *loop, int fd) {
+    for (int i = 0; i < EVLOOP_MAX_SLOTS; i++) {
+        if (loop->slots[i].fd != fd)
+            continue;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        loop->slots[i].fd = -1;
+        loop->slots[i].handler = NULL;
+        loop->slots[i].arg = NULL;
+        return 0;
+    }
+    return -1;
+}
+
+double evloop_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Bucket bounds for EvJitter, seconds */
+static const double jitter_bounds[EVLOOP_JITTER_BUCKETS - 1] = {
+    0.0001, 0.0002, 0.0005, 0.001, 0.002, 0.005,
+    0.01, 0.02, 0.05, 0.1, 0.2, 0.5
+};
+
+static void record_jitter(EvJitter *j, double late) {
+    int b = 0;
+    if (late < 0.0)
+        late = 0.0;
+    while (b < EVLOOP_JITTER_BUCKETS - 1 && late >= jitter_bounds[b])
+        b++;
+    j->hist[b]++;
+    j->count++;
+    j->sum += late;
+    if (late > j->max)
+        j->max = late;
+}
+
+double evloop_jitter_quantile(const EvJitter *jitter, double q) {
+    unsigned long long want = (unsigned long long)(q * (double)jitter->count + 0.5);
+    unsigned long long seen = 0;
+    for (int b = 0; b < EVLOOP_JITTER_BUCKETS - 1; b++) {
+        seen += jitter->hist[b];
+        if (seen >= want)
+            return jitter_bounds[b];
+    }
+    return jitter->max;
+}
+
+static void dispatch_timer(EvLoop *loop) {
+    uint64_t expirations;
+    if (read(loop->timer_fd, &expirations, sizeof(expirations)) !=
+        (ssize_t)sizeof(expirations))
+        return;
+    double due = loop->deadline > loop->armed_at ? loop->deadline : loop->armed_at;
+    record_jitter(&loop->jitter, evloop_now() - due);
+    loop->deadline = 0.0;
+    if (loop->on_timer)
+        loop->on_timer(loop, loop->arg);
+}
+
+static void dispatch_signals(EvLoop *loop) {
+    struct signalfd_siginfo si;
+    while (read(loop->signal_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+        if (loop->on_signal)
+            loop->on_signal(loop, (int)si.ssi_signo, loop->arg);
+    }
+}
+
+static void dispatch_slot(EvLoop *loop, int fd, uint32_t events) {
+    for (int i = 0; i < EVLOOP_MAX_SLOTS; i++) {
+        if (loop->slots[i].fd == fd) {
+            loop->slots[i].handler(loop, fd, events, loop->slots[i].arg);
+            return;
+        }
+    }
+}
+
+int evloop_run(EvLoop *loop) {
+    struct epoll_event events[EVLOOP_MAX_EVENTS];
+
+    loop->running = 1;
+    while (loop->running) {
+        int n = epoll_wait(loop->epoll_fd, events, EVLOOP_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            return -1;
+        }
+
+        /* Signals first so a pending SIGTERM is never delayed by a tick */
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == loop->signal_fd)
+                dispatch_signals(loop);
+        }
+        for (int i = 0; i < n && loop->running; i++) {
+            int fd = events[i].data.fd;
+            if (fd == loop->signal_fd)
+                continue;
+            if (fd == loop->timer_fd)
+                dispatch_timer(loop);
+            else
+                dispatch_slot(loop, fd, events[i].events);
+        }
+    }
+    return 0;
+}
+
+void evloop_stop(EvLoop *loop) {
+    loop->running = 0;
+}
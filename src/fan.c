@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "fan.h"
 #include "gpu.h"
 
@@ -35,21 +36,128 @@ int fan_set_speed(nvmlDevice_t device, unsigned int fan, unsigned int speed) {
     return 0;
 }
 
+static unsigned int clamp_for_device(const GpuDevice *dev, unsigned int speed) {
+    /* Stay inside what the card accepts, on top of nvfd's own floor */
+    unsigned int lo = dev->fan_min > FAN_SPEED_MIN ? dev->fan_min : FAN_SPEED_MIN;
+    unsigned int hi = dev->fan_max < 100 ? dev->fan_max : 100;
+    if (speed < lo)
+        speed = lo;
+    if (speed > hi)
+        speed = hi;
+    return speed;
+}
+
+int fan_get_range(unsigned int gpu_index, unsigned int *lo, unsigned int *hi) {
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (!dev)
+        return -1;
+    *lo = clamp_for_device(dev, 0);
+    *hi = clamp_for_device(dev, 100);
+    return 0;
+}
+
 int fan_set_gpu_speed(unsigned int gpu_index, unsigned int speed) {
-    nvmlDevice_t device;
-    if (gpu_get_handle(gpu_index, &device) != 0)
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (!dev)
         return -1;
 
-    int num_fans = fan_get_count(device);
-    if (num_fans <= 0) {
+    if (dev->fan_count == 0) {
         fprintf(stderr, "Error: No fans detected on GPU %u\n", gpu_index);
         return -1;
     }
 
+    speed = clamp_for_device(dev, speed);
+
     int failures = 0;
-    for (int i = 0; i < num_fans; i++) {
-        if (fan_set_speed(device, (unsigned int)i, speed) != 0)
+    for (unsigned int i = 0; i < dev->fan_count; i++) {
+        if (fan_set_speed(dev->handle, i, speed) != 0)
+            failures++;
+    }
+    return failures;
+}
+
+int fan_set_gpu_speeds(unsigned int gpu_index, const unsigned int *speeds) {
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (!dev)
+        return -1;
+
+    int failures = 0;
+    for (unsigned int i = 0; i < dev->fan_count; i++) {
+        if (fan_set_speed(dev->handle, i, clamp_for_device(dev, speeds[i])) != 0)
+            failures++;
+    }
+    return failures;
+}
+
+int fan_state_init(FanState *fs, unsigned int fan_count) {
+    fs->count = 0;
+    fs->speed = NULL;
+    fs->written_at = NULL;
+    if (fan_count == 0)
+        return 0;
+
+    fs->speed = malloc(fan_count * sizeof(*fs->speed));
+    fs->written_at = malloc(fan_count * sizeof(*fs->written_at));
+    if (!fs->speed || !fs->written_at) {
+        fan_state_free(fs);
+        return -1;
+    }
+    fs->count = fan_count;
+    fan_state_reset(fs);
+    return 0;
+}
+
+void fan_state_free(FanState *fs) {
+    free(fs->speed);
+    free(fs->written_at);
+    fs->speed = NULL;
+    fs->written_at = NULL;
+    fs->count = 0;
+}
+
+void fan_state_reset(FanState *fs) {
+    for (unsigned int i = 0; i < fs->count; i++) {
+        fs->speed[i] = -1;
+        fs->written_at[i] = 0.0;
+    }
+}
+
+int fan_command_gpu_speeds(unsigned int gpu_index, const unsigned int *speeds,
+                           FanState *fs, unsigned int deadband,
+                           unsigned int reassert_s, double now,
+                           FanWriteStats *stats) {
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (!dev || dev->fan_count == 0)
+        return -1;
+
+    unsigned int lo = clamp_for_device(dev, 0);
+    unsigned int hi = clamp_for_device(dev, 100);
+    unsigned int fans = dev->fan_count < fs->count ? dev->fan_count : fs->count;
+
+    int failures = 0;
+    for (unsigned int i = 0; i < fans; i++) {
+        unsigned int speed = clamp_for_device(dev, speeds[i]);
+        int last = fs->speed[i];
+        if (last >= 0) {
+            unsigned int delta = (unsigned int)abs((int)speed - last);
+            int stale = reassert_s > 0 && now - fs->written_at[i] >= (double)reassert_s;
+            /* Always let the target reach the ends of the range exactly */
+            int edge = (speed == lo || speed == hi) && delta > 0;
+            if (!stale && !edge && (delta == 0 || delta < deadband)) {
+                stats->skipped++;
+                continue;
+            }
+        }
+
+        if (fan_set_speed(dev->handle, i, speed) != 0) {
+            fs->speed[i] = -1; /* unknown state: retry next pass */
+            stats->failures++;
             failures++;
+            continue;
+        }
+        fs->speed[i] = (int)speed;
+        fs->written_at[i] = now;
+        stats->writes++;
     }
     return failures;
 }
@@ -64,11 +172,12 @@ int fan_set_all_speed(unsigned int speed) {
 }
 
 int fan_reset_to_auto(unsigned int gpu_index) {
-    nvmlDevice_t device;
-    if (gpu_get_handle(gpu_index, &device) != 0)
+    const GpuDevice *dev = gpu_device(gpu_index);
+    if (!dev)
         return -1;
 
-    int num_fans = fan_get_count(device);
+    nvmlDevice_t device = dev->handle;
+    int num_fans = (int)dev->fan_count;
     int failures = 0;
     for (int i = 0; i < num_fans; i++) {
         nvmlReturn_t r = nvmlDeviceSetDefaultFanSpeed_v2(device, (unsigned int)i);
@@ -0,0 +1,50 @@
+#include "feedforward.h"
+#include "nvfd.h"
+
+void ff_defaults(FeedForwardParams *p) {
+    p->power_gain = 0.0;
+    p->util_gain = 0.0;
+    p->tau_s = NVFD_FF_TAU_S_DEFAULT;
+    p->max = NVFD_FF_MAX_DEFAULT;
+}
+
+int ff_enabled(const FeedForwardParams *p) {
+    return p->power_gain > 0.0 || p->util_gain > 0.0;
+}
+
+void ff_reset(FeedForward *ff) {
+    ff->primed = 0;
+    ff->power_base = -1.0;
+    ff->util_base = -1.0;
+    ff->boost = 0.0;
+}
+
+/* Rise above the baseline, then move the baseline towards the input */
+static double track(double *base, double value, double alpha) {
+    if (value < 0.0) {
+        *base = -1.0;
+        return 0.0;
+    }
+    if (*base < 0.0)
+        *base = value;
+
+    double rise = value - *base;
+    *base += alpha * (value - *base);
+    return rise > 0.0 ? rise : 0.0;
+}
+
+double ff_update(FeedForward *ff, const FeedForwardParams *p,
+                 double power_pct, double util, double dt) {
+    /* A fresh baseline starts at the current load: no boost on takeover */
+    if (!ff->primed) {
+        ff->power_base = -1.0;
+        ff->util_base = -1.0;
+        ff->primed = 1;
+    }
+    double alpha = p->tau_s > 0.0 ? dt / (p->tau_s + dt) : 1.0;
+
+    double boost = p->power_gain * track(&ff->power_base, power_pct, alpha) +
+                   p->util_gain * track(&ff->util_base, util, alpha);
+    ff->boost = boost > p->max ? p->max : boost;
+    return ff->boost;
+}
@@ -0,0 +1,48 @@
+#include "governor.h"
+#include "nvfd.h"
+
+void gov_defaults(GovernorParams *p) {
+    p->temp = 0;
+    p->step = NVFD_GOV_STEP_DEFAULT;
+    p->floor = NVFD_GOV_FLOOR_DEFAULT;
+    p->interval_s = NVFD_GOV_INTERVAL_S_DEFAULT;
+    p->hysteresis = NVFD_GOV_HYSTERESIS_DEFAULT;
+}
+
+int gov_enabled(const GovernorParams *p) {
+    return p->temp > 0;
+}
+
+void gov_reset(Governor *g) {
+    g->failed = 0;
+    g->limit = g->applied;
+}
+
+int gov_update(Governor *g, const GovernorParams *p, int temp, int saturated,
+               int orig_mw, int min_mw, double now) {
+    if (!gov_enabled(p) || g->failed || orig_mw <= 0) {
+        g->limit = 0;
+        return 0;
+    }
+    if (g->limit != 0 && now - g->changed_at < p->interval_s)
+        return g->limit;
+
+    int current = g->limit ? g->limit : orig_mw;
+    int step = (int)((long long)orig_mw * p->step / 100);
+    int lowest = (int)((long long)orig_mw * p->floor / 100);
+    if (lowest < min_mw)
+        lowest = min_mw;
+
+    if (saturated && temp >= p->temp && current > lowest) {
+        int next = current - step;
+        g->limit = next < lowest ? lowest : next;
+        g->changed_at = now;
+        g->cuts++;
+    } else if (g->limit != 0 && temp <= p->temp - p->hysteresis) {
+        int next = current + step;
+        g->limit = next >= orig_mw ? 0 : next;
+        g->changed_at = now;
+        g->restores++;
+    }
+    return g->limit;
+}
@@ -1,6 +1,80 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "gpu.h"
+#include "proc.h"
+
+static GpuDevice *devices;
+
+static int get_threshold(nvmlDevice_t device, nvmlTemperatureThresholds_t which) {
+    unsigned int temp;
+    if (nvmlDeviceGetTemperatureThreshold(device, which, &temp) == NVML_SUCCESS)
+        return (int)temp;
+    return -1;
+}
+
+static void probe_device(unsigned int index, GpuDevice *dev) {
+    memset(dev, 0, sizeof(*dev));
+    dev->index = index;
+
+    nvmlReturn_t r = nvmlDeviceGetHandleByIndex(index, &dev->handle);
+    if (r != NVML_SUCCESS) {
+        fprintf(stderr, "Failed to get GPU %u handle: %s\n", index, nvmlErrorString(r));
+        return;
+    }
+    dev->valid = 1;
+
+    if (nvmlDeviceGetUUID(dev->handle, dev->uuid, sizeof(dev->uuid)) != NVML_SUCCESS)
+        dev->uuid[0] = '\0';
+
+    nvmlPciInfo_t pci;
+    if (nvmlDeviceGetPciInfo(dev->handle, &pci) == NVML_SUCCESS) {
+        strncpy(dev->pci_bus_id, pci.busId, sizeof(dev->pci_bus_id) - 1);
+        dev->pci_bus_id[sizeof(dev->pci_bus_id) - 1] = '\0';
+    }
+
+    gpu_get_name(dev->handle, dev->name, sizeof(dev->name));
+
+    dev->has_mem_temp = gpu_get_memory_temperature(dev->handle) >= 0;
+    dev->slowdown_temp = get_threshold(dev->handle, NVML_TEMPERATURE_THRESHOLD_SLOWDOWN);
+    dev->shutdown_temp = get_threshold(dev->handle, NVML_TEMPERATURE_THRESHOLD_SHUTDOWN);
+    dev->gpu_max_temp = get_threshold(dev->handle, NVML_TEMPERATURE_THRESHOLD_GPU_MAX);
+    dev->mem_max_temp = get_threshold(dev->handle, NVML_TEMPERATURE_THRESHOLD_MEM_MAX);
+
+    /* Steps and restores start from the limit in force, so a cap an admin
+     * set stays. The default is only kept to spot a lower limit, which may
+     * also be one an earlier nvfd left behind when it was killed. */
+    unsigned int limit, def_limit, min_limit, max_limit;
+    int have_limit = nvmlDeviceGetPowerManagementLimit(dev->handle, &limit) == NVML_SUCCESS;
+    if (nvmlDeviceGetPowerManagementDefaultLimit(dev->handle, &def_limit) == NVML_SUCCESS) {
+        dev->power_default = (int)def_limit;
+        if (!have_limit || def_limit < limit)
+            limit = def_limit;
+        have_limit = 1;
+    }
+    if (have_limit &&
+        nvmlDeviceGetPowerManagementLimitConstraints(dev->handle, &min_limit,
+                                                     &max_limit) == NVML_SUCCESS &&
+        min_limit < limit) {
+        dev->power_orig = (int)limit;
+        dev->power_min = (int)min_limit;
+    }
+
+    unsigned int count = 0;
+    if (nvmlDeviceGetNumFans(dev->handle, &count) == NVML_SUCCESS)
+        dev->fan_count = count;
+
+    /* Fall back to the range nvfd has always enforced */
+    unsigned int min_speed, max_speed;
+    if (nvmlDeviceGetMinMaxFanSpeed(dev->handle, &min_speed, &max_speed) == NVML_SUCCESS &&
+        min_speed < max_speed && max_speed <= 100) {
+        dev->fan_min = min_speed;
+        dev->fan_max = max_speed;
+    } else {
+        dev->fan_min = 0;
+        dev->fan_max = 100;
+    }
+}
 
 int gpu_init(void) {
     nvmlReturn_t r = nvmlInit();
@@ -12,31 +86,147 @@ int gpu_init(void) {
     r = nvmlDeviceGetCount(&device_count);
     if (r != NVML_SUCCESS) {
         fprintf(stderr, "Failed to get device count: %s\n", nvmlErrorString(r));
+        device_count = 0;
         nvmlShutdown();
         return -1;
     }
 
+    if (device_count > 0) {
+        devices = calloc(device_count, sizeof(GpuDevice));
+        if (!devices) {
+            fprintf(stderr, "Memory allocation failed\n");
+            device_count = 0;
+            nvmlShutdown();
+            return -1;
+        }
+    }
+    for (unsigned int i = 0; i < device_count; i++)
+        probe_device(i, &devices[i]);
+
     return 0;
 }
 
 void gpu_shutdown(void) {
+    free(devices);
+    devices = NULL;
+    device_count = 0;
     nvmlShutdown();
 }
 
-int gpu_get_handle(unsigned int index, nvmlDevice_t *device) {
-    nvmlReturn_t r = nvmlDeviceGetHandleByIndex(index, device);
-    if (r != NVML_SUCCESS) {
-        fprintf(stderr, "Failed to get GPU %u handle: %s\n", index, nvmlErrorString(r));
+nvmlReturn_t gpu_count_now(unsigned int *count) {
+    return nvmlDeviceGetCount(count);
+}
+
+GpuFault gpu_fault(nvmlReturn_t r) {
+    switch (r) {
+    case NVML_SUCCESS:
+        return GPU_FAULT_NONE;
+    case NVML_ERROR_GPU_IS_LOST:
+    case NVML_ERROR_RESET_REQUIRED:
+        return GPU_FAULT_LOST;
+    case NVML_ERROR_UNINITIALIZED:
+    case NVML_ERROR_DRIVER_NOT_LOADED:
+    case NVML_ERROR_LIB_RM_VERSION_MISMATCH:
+        return GPU_FAULT_LIBRARY;
+    default:
+        return GPU_FAULT_TRANSIENT;
+    }
+}
+
+static nvmlReturn_t read_temperature(nvmlDevice_t device, int *temp) {
+    unsigned int t;
+    nvmlReturn_t r = nvmlDeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &t);
+    *temp = r == NVML_SUCCESS ? (int)t : -1;
+    return r;
+}
+
+int gpu_reprobe(unsigned int index, GpuDevice *fresh, nvmlReturn_t *status) {
+    const GpuDevice *old = &devices[index];
+    int temp;
+
+    probe_device(index, fresh);
+    *status = fresh->valid ? read_temperature(fresh->handle, &temp)
+                           : NVML_ERROR_GPU_IS_LOST;
+    if (*status != NVML_SUCCESS)
         return -1;
+    if (strcmp(fresh->uuid, old->uuid) != 0 || fresh->fan_count != old->fan_count)
+        return 1;
+    return 0;
+}
+
+void gpu_adopt(unsigned int index, const GpuDevice *fresh) {
+    GpuDevice *old = &devices[index];
+    /* The limit in force now may be one nvfd set; keep the original */
+    int power_orig = old->power_orig;
+    int power_min = old->power_min;
+    int power_default = old->power_default;
+    *old = *fresh;
+    old->power_orig = power_orig;
+    old->power_min = power_min;
+    old->power_default = power_default;
+}
+
+void gpu_keep_power(unsigned int index, int power_orig) {
+    if (index < device_count)
+        devices[index].power_orig = power_orig;
+}
+
+const GpuDevice *gpu_device(unsigned int index) {
+    if (index >= device_count || !devices[index].valid)
+        return NULL;
+    return &devices[index];
+}
+
+int gpu_find_uuid(const char *uuid) {
+    for (unsigned int i = 0; i < device_count; i++) {
+        if (devices[i].valid && strcmp(devices[i].uuid, uuid) == 0)
+            return (int)i;
     }
+    return -1;
+}
+
+int gpu_get_handle(unsigned int index, nvmlDevice_t *device) {
+    const GpuDevice *dev = gpu_device(index);
+    if (!dev)
+        return -1;
+    *device = dev->handle;
     return 0;
 }
 
 int gpu_get_temperature(nvmlDevice_t device) {
-    unsigned int temp;
-    if (nvmlDeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &temp) == NVML_SUCCESS)
-        return (int)temp;
-    return -1;
+    int temp;
+    read_temperature(device, &temp);
+    return temp;
+}
+
+int gpu_get_memory_temperature(nvmlDevice_t device) {
+    nvmlFieldValue_t value;
+    memset(&value, 0, sizeof(value));
+    value.fieldId = NVML_FI_DEV_MEMORY_TEMP;
+    if (nvmlDeviceGetFieldValues(device, 1, &value) != NVML_SUCCESS ||
+        value.nvmlReturn != NVML_SUCCESS)
+        return -1;
+    int temp;
+    switch (value.valueType) {
+    case NVML_VALUE_TYPE_DOUBLE:             temp = (int)value.value.dVal; break;
+    case NVML_VALUE_TYPE_UNSIGNED_LONG:      temp = (int)value.value.ulVal; break;
+    case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG: temp = (int)value.value.ullVal; break;
+    case NVML_VALUE_TYPE_SIGNED_LONG_LONG:   temp = (int)value.value.sllVal; break;
+    default:                                 temp = (int)value.value.uiVal; break;
+    }
+    /* Boards without the sensor may still answer, with a zero */
+    return temp > 0 ? temp : -1;
+}
+
+nvmlReturn_t gpu_read_sensors(const GpuDevice *dev, unsigned int mask, int *temps) {
+    nvmlReturn_t r = NVML_SUCCESS;
+    for (int s = 0; s < SENSOR_COUNT; s++)
+        temps[s] = -1;
+    if (mask & (1u << SENSOR_CORE))
+        r = read_temperature(dev->handle, &temps[SENSOR_CORE]);
+    if ((mask & (1u << SENSOR_MEM)) && dev->has_mem_temp)
+        temps[SENSOR_MEM] = gpu_get_memory_temperature(dev->handle);
+    return r;
 }
 
 int gpu_get_name(nvmlDevice_t device, char *buf, unsigned int len) {
@@ -80,6 +270,70 @@ int gpu_get_power_limit(nvmlDevice_t device) {
     return -1;
 }
 
+int gpu_set_power_limit(nvmlDevice_t device, int mw) {
+    return nvmlDeviceSetPowerManagementLimit(device, (unsigned int)mw) == NVML_SUCCESS
+           ? 0 : -1;
+}
+
+int gpu_get_sm_clock(nvmlDevice_t device) {
+    unsigned int clock;
+    if (nvmlDeviceGetClockInfo(device, NVML_CLOCK_SM, &clock) == NVML_SUCCESS)
+        return (int)clock;
+    return -1;
+}
+
+int gpu_get_throttle_reasons(nvmlDevice_t device, unsigned long long *reasons) {
+    return nvmlDeviceGetCurrentClocksThrottleReasons(device, reasons) == NVML_SUCCESS
+           ? 0 : -1;
+}
+
+/* Appends the PIDs of one NVML process list not already in pids */
+static int add_processes(nvmlDevice_t device, int graphics, unsigned int *pids,
+                         unsigned int count, unsigned int max) {
+    nvmlProcessInfo_t stack[PROC_LIST_MAX];
+    nvmlProcessInfo_t *infos = stack;
+    unsigned int n = PROC_LIST_MAX;
+
+    nvmlReturn_t r = graphics
+        ? nvmlDeviceGetGraphicsRunningProcesses(device, &n, infos)
+        : nvmlDeviceGetComputeRunningProcesses(device, &n, infos);
+    if (r == NVML_ERROR_INSUFFICIENT_SIZE) {
+        /* More than fit on the stack: ask again with room to spare */
+        n += 8;
+        infos = malloc(n * sizeof(*infos));
+        if (!infos)
+            return -1;
+        r = graphics
+            ? nvmlDeviceGetGraphicsRunningProcesses(device, &n, infos)
+            : nvmlDeviceGetComputeRunningProcesses(device, &n, infos);
+    }
+    if (r != NVML_SUCCESS) {
+        if (infos != stack)
+            free(infos);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < n && count < max; i++) {
+        unsigned int j = 0;
+        while (j < count && pids[j] != infos[i].pid)
+            j++;
+        if (j == count)
+            pids[count++] = infos[i].pid;
+    }
+    if (infos != stack)
+        free(infos);
+    return (int)count;
+}
+
+int gpu_get_processes(nvmlDevice_t device, unsigned int *pids, unsigned int max) {
+    int count = add_processes(device, 0, pids, 0, max);
+    if (count < 0)
+        return -1;
+    /* Not every board reports graphics clients; compute ones still count */
+    int all = add_processes(device, 1, pids, (unsigned int)count, max);
+    return all < 0 ? count : all;
+}
+
 int gpu_enable_persistence(void) {
     int failures = 0;
     for (unsigned int i = 0; i < device_count; i++) {
@@ -0,0 +1,60 @@
+#include "health.h"
+#include "nvfd.h"
+
+const char *health_name(HealthState state) {
+    switch (state) {
+    case HEALTH_DEGRADED: return "degraded";
+    case HEALTH_LOST:     return "lost";
+    default:              return "healthy";
+    }
+}
+
+static void set_state(Health *h, HealthState state, double now) {
+    if (h->state != state)
+        h->since = now;
+    h->state = state;
+}
+
+void health_lost(Health *h, double now) {
+    set_state(h, HEALTH_LOST, now);
+    h->backoff = NVFD_HEALTH_RETRY_MIN_S;
+    h->retry_at = now;
+}
+
+HealthState health_sample(Health *h, GpuFault fault, double now) {
+    switch (fault) {
+    case GPU_FAULT_NONE:
+        h->failures = 0;
+        set_state(h, HEALTH_OK, now);
+        break;
+    case GPU_FAULT_TRANSIENT:
+        if (++h->failures >= NVFD_HEALTH_DEGRADED_AFTER)
+            set_state(h, HEALTH_DEGRADED, now);
+        break;
+    case GPU_FAULT_LOST:
+        if (h->state != HEALTH_LOST) {
+            h->losses++;
+            health_lost(h, now);
+            h->retry_at = now + h->backoff;
+        }
+        break;
+    case GPU_FAULT_LIBRARY:
+        break;
+    }
+    return h->state;
+}
+
+HealthState health_probe(Health *h, int back, double now) {
+    if (back) {
+        h->failures = 0;
+        set_state(h, HEALTH_OK, now);
+        return h->state;
+    }
+    h->backoff *= 2.0;
+    if (h->backoff > NVFD_HEALTH_RETRY_MAX_S)
+        h->backoff = NVFD_HEALTH_RETRY_MAX_S;
+    if (h->backoff < NVFD_HEALTH_RETRY_MIN_S)
+        h->backoff = NVFD_HEALTH_RETRY_MIN_S;
+    h->retry_at = now + h->backoff;
+    return h->state;
+}
@@ -2,106 +2,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <syslog.h>
 #include <signal.h>
-#include <jansson.h>
 
 #include "nvfd.h"
 #include "gpu.h"
 #include "fan.h"
 #include "curve.h"
 #include "config.h"
+#include "control.h"
 #include "display.h"
 #include "editor.h"
 #include "dashboard.h"
+#include "daemon.h"
 
 unsigned int device_count = 0;
 volatile sig_atomic_t keep_running = 1;
-volatile sig_atomic_t reload_config = 0;
 
+/* Interactive paths only; the daemon takes signals through signalfd */
 static void signal_handler(int signum) {
     if (signum == SIGTERM || signum == SIGINT)
         keep_running = 0;
-    else if (signum == SIGHUP)
-        reload_config = 1;
-}
-
-static void daemon_loop(void) {
-    FanCurve *curve = NULL;
-    int prev_managed[MAX_GPU_COUNT] = {0};
-
-    printf("Entering daemon mode (polling every 5s)...\n");
-    openlog("nvfd", LOG_PID, LOG_DAEMON);
-
-    while (keep_running) {
-        if (reload_config) {
-            syslog(LOG_INFO, "Reloading configuration (SIGHUP)");
-            if (curve) { free(curve); curve = NULL; }
-            reload_config = 0;
-        }
-
-        json_t *root = config_read();
-
-        for (unsigned int i = 0; i < device_count; i++) {
-            char gpu_key[20];
-            snprintf(gpu_key, sizeof(gpu_key), "gpu%d", i);
-            json_t *cfg = json_object_get(root, gpu_key);
-
-            nvmlDevice_t device;
-            if (gpu_get_handle(i, &device) != 0)
-                continue;
-
-            const char *mode = NULL;
-            if (json_is_object(cfg))
-                mode = json_string_value(json_object_get(cfg, "mode"));
-
-            /* No config or auto mode: let driver control fans */
-            if (!mode || strcmp(mode, "auto") == 0) {
-                if (prev_managed[i]) {
-                    syslog(LOG_INFO, "GPU %u: restoring driver fan control", i);
-                    fan_reset_to_auto(i);
-                    prev_managed[i] = 0;
-                }
-                continue;
-            }
-
-            int temp = gpu_get_temperature(device);
-            if (temp < 0)
-                continue;
-
-            int fan_speed;
-            if (mode && strcmp(mode, "manual") == 0) {
-                fan_speed = (int)json_integer_value(json_object_get(cfg, "speed"));
-            } else if (mode && strcmp(mode, "curve") == 0) {
-                if (!curve)
-                    curve = curve_read();
-                if (curve)
-                    fan_speed = curve_interpolate(temp, curve);
-                else
-                    fan_speed = curve_default_interpolate(temp);
-            } else {
-                /* Unknown mode - fall back to default curve */
-                fan_speed = curve_default_interpolate(temp);
-            }
-
-            fan_set_gpu_speed(i, (unsigned int)fan_speed);
-            prev_managed[i] = 1;
-        }
-
-        json_decref(root);
-        sleep(5);
-    }
-
-    if (curve)
-        free(curve);
-
-    /* Reset all fans to auto on clean shutdown */
-    syslog(LOG_INFO, "Shutting down, resetting fans to auto...");
-    fan_reset_all_to_auto();
-    closelog();
 }
 
 int main(int argc, char *argv[]) {
+#ifndef NVFD_NO_ELEVATE
     /* Auto-elevate to root if needed */
     if (geteuid() != 0) {
         char **new_argv = malloc(sizeof(char *) * (argc + 2));
@@ -118,6 +42,7 @@ int main(int argc, char *argv[]) {
         free(new_argv);
         return 1;
     }
+#endif
 
     if (gpu_init() != 0)
         return 1;
@@ -138,7 +63,6 @@ int main(int argc, char *argv[]) {
 
     signal(SIGTERM, signal_handler);
     signal(SIGINT, signal_handler);
-    signal(SIGHUP, signal_handler);
 
     if (argc == 1) {
         if (tui_mode) {
@@ -147,7 +71,7 @@ int main(int argc, char *argv[]) {
         } else {
             /* Daemon mode (non-TTY, e.g. systemd) */
             gpu_enable_persistence();
-            daemon_loop();
+            daemon_run();
         }
     } else if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
         display_help();
@@ -156,47 +80,140 @@ int main(int argc, char *argv[]) {
     } else if (strcmp(argv[1], "auto") == 0) {
         /* True auto: hand control back to driver */
         for (unsigned int i = 0; i < device_count; i++) {
-            char gpu_key[20];
-            snprintf(gpu_key, sizeof(gpu_key), "gpu%d", i);
-            config_write_gpu(gpu_key, "auto", 0);
+            config_write_gpu(i, "auto", 0);
             fan_reset_to_auto(i);
         }
         printf("All GPU fans set to auto (driver-controlled).\n");
     } else if (strcmp(argv[1], "curve") == 0) {
-        if (argc == 2) {
+        /* nvfd curve [show|edit|reset] [selector] | nvfd curve [selector] <temp> <speed> */
+        CurveSelector sel = { -1, -1 };
+        const char *action = argc >= 3 ? argv[2] : NULL;
+        int is_action = action && (strcmp(action, "show") == 0 ||
+                                   strcmp(action, "edit") == 0 ||
+                                   strcmp(action, "reset") == 0);
+        const char *selector = (is_action && argc == 4) ? argv[3]
+                             : (!is_action && argc == 5) ? argv[2] : NULL;
+
+        if (selector && curve_parse_selector(selector, &sel) != 0) {
+            printf("Invalid curve selector '%s'. Use default, <gpu> or <gpu>:<fan>.\n",
+                   selector);
+        } else if (argc == 2) {
             /* Enable curve mode for all GPUs */
-            for (unsigned int i = 0; i < device_count; i++) {
-                char gpu_key[20];
-                snprintf(gpu_key, sizeof(gpu_key), "gpu%d", i);
-                config_write_gpu(gpu_key, "curve", 0);
-            }
+            for (unsigned int i = 0; i < device_count; i++)
+                config_write_gpu(i, "curve", 0);
             printf("All GPUs set to curve mode.\n");
-        } else if (argc == 4) {
-            int temp = atoi(argv[2]);
-            int speed = atoi(argv[3]);
+        } else if (!is_action && (argc == 4 || argc == 5)) {
+            int temp = atoi(argv[argc - 2]);
+            int speed = atoi(argv[argc - 1]);
             if (temp >= 0 && temp <= 100 && speed >= 0 && speed <= 100) {
                 config_ensure_dir();
-                curve_edit(temp, speed);
+                curve_edit(sel, temp, speed);
             } else {
                 printf("Invalid input. Temperature and speed must be 0-100.\n");
             }
-        } else if (argc == 3) {
-            if (strcmp(argv[2], "show") == 0) {
-                display_fan_curve();
-            } else if (strcmp(argv[2], "edit") == 0) {
+        } else if (is_action && argc <= 4) {
+            if (strcmp(action, "show") == 0) {
+                display_fan_curve(selector ? &sel : NULL);
+            } else if (strcmp(action, "edit") == 0) {
                 config_ensure_dir();
-                editor_run();
-            } else if (strcmp(argv[2], "reset") == 0) {
-                config_ensure_dir();
-                curve_reset();
+                editor_run(sel);
             } else {
-                printf("Invalid curve command. Use 'show', 'edit', or 'reset'.\n");
-                display_help();
+                config_ensure_dir();
+                curve_reset(sel);
             }
+        } else if (argc == 3) {
+            printf("Invalid curve command. Use 'show', 'edit', or 'reset'.\n");
+            display_help();
         } else {
             printf("Invalid curve command.\n");
             display_help();
         }
+    } else if (strcmp(argv[1], "target") == 0) {
+        /* nvfd target <temp> | nvfd target <gpu_index> <temp> */
+        int gpu_index = -1;
+        int target = -1;
+        if (argc == 3) {
+            target = atoi(argv[2]);
+        } else if (argc == 4) {
+            gpu_index = atoi(argv[2]);
+            target = atoi(argv[3]);
+        }
+
+        if (target < NVFD_TARGET_MIN || target > NVFD_TARGET_MAX) {
+            printf("Invalid target. Use a temperature between %d and %d.\n",
+                   NVFD_TARGET_MIN, NVFD_TARGET_MAX);
+        } else if (gpu_index == -1) {
+            for (unsigned int i = 0; i < device_count; i++)
+                config_write_gpu(i, "target", target);
+            printf("All GPUs set to hold %d°C (applied by the daemon).\n", target);
+        } else if (gpu_index >= 0 && gpu_index < (int)device_count) {
+            config_write_gpu((unsigned int)gpu_index, "target", target);
+            printf("GPU %d set to hold %d°C (applied by the daemon).\n",
+                   gpu_index, target);
+        } else {
+            printf("Invalid GPU index. Use 'nvfd list' to see available GPUs.\n");
+        }
+    } else if (strcmp(argv[1], "clocks") == 0) {
+        /* nvfd clocks | nvfd clocks <gpu_index> */
+        int gpu_index = argc == 3 ? atoi(argv[2]) : -1;
+        if (argc > 3) {
+            printf("Invalid clocks command.\n");
+            display_help();
+        } else if (gpu_index == -1) {
+            for (unsigned int i = 0; i < device_count; i++)
+                config_write_gpu(i, "clocks", 0);
+            printf("All GPUs set to clocks mode (applied by the daemon).\n");
+        } else if (gpu_index >= 0 && gpu_index < (int)device_count) {
+            config_write_gpu((unsigned int)gpu_index, "clocks", 0);
+            printf("GPU %d set to clocks mode (applied by the daemon).\n", gpu_index);
+        } else {
+            printf("Invalid GPU index. Use 'nvfd list' to see available GPUs.\n");
+        }
+    } else if (strcmp(argv[1], "efficiency") == 0) {
+        /* nvfd efficiency | nvfd efficiency <gpu_index> */
+        int gpu_index = argc == 3 ? atoi(argv[2]) : -1;
+        if (argc > 3) {
+            printf("Invalid efficiency command.\n");
+            display_help();
+        } else if (gpu_index == -1) {
+            for (unsigned int i = 0; i < device_count; i++)
+                config_write_gpu(i, "efficiency", 0);
+            printf("All GPUs set to efficiency mode (applied by the daemon).\n");
+        } else if (gpu_index >= 0 && gpu_index < (int)device_count) {
+            config_write_gpu((unsigned int)gpu_index, "efficiency", 0);
+            printf("GPU %d set to efficiency mode (applied by the daemon).\n", gpu_index);
+        } else {
+            printf("Invalid GPU index. Use 'nvfd list' to see available GPUs.\n");
+        }
+    } else if (strcmp(argv[1], "profile") == 0) {
+        /* nvfd profile | nvfd profile <name|none> [gpu_index] */
+        int gpu_index = argc == 4 ? atoi(argv[3]) : -1;
+        char err[256];
+        if (argc == 2) {
+            display_profiles();
+        } else if (argc > 4) {
+            printf("Invalid profile command.\n");
+            display_help();
+        } else if (strcmp(argv[2], "none") != 0 && !config_valid_profile_name(argv[2])) {
+            printf("Invalid profile name '%s'.\n", argv[2]);
+        } else if (argc == 4 && (gpu_index < 0 || gpu_index >= (int)device_count)) {
+            printf("Invalid GPU index. Use 'nvfd list' to see available GPUs.\n");
+        } else {
+            int none = strcmp(argv[2], "none") == 0;
+            int ret = control_set_profile(none ? NULL : argv[2], gpu_index, err, sizeof(err));
+            if (ret < 0)
+                printf("The nvfd daemon is not running; profiles are switched in the daemon.\n");
+            else if (ret > 0)
+                printf("Profile not switched: %s\n", err);
+            else if (none && gpu_index >= 0)
+                printf("GPU %d follows config.json again.\n", gpu_index);
+            else if (none)
+                printf("All GPUs follow config.json again.\n");
+            else if (gpu_index >= 0)
+                printf("GPU %d switched to profile %s.\n", gpu_index, argv[2]);
+            else
+                printf("All GPUs switched to profile %s.\n", argv[2]);
+        }
     } else if (strcmp(argv[1], "list") == 0) {
         display_list_gpus();
     } else {
@@ -221,16 +238,12 @@ int main(int argc, char *argv[]) {
             if (gpu_index == -1) {
                 /* Set all GPUs */
                 for (unsigned int i = 0; i < device_count; i++) {
-                    char gpu_key[20];
-                    snprintf(gpu_key, sizeof(gpu_key), "gpu%d", i);
-                    config_write_gpu(gpu_key, "manual", speed);
+                    config_write_gpu(i, "manual", speed);
                     fan_set_gpu_speed(i, (unsigned int)speed);
                 }
                 printf("All GPUs set to fixed speed %d%%.\n", speed);
             } else if (gpu_index >= 0 && gpu_index < (int)device_count) {
-                char gpu_key[20];
-                snprintf(gpu_key, sizeof(gpu_key), "gpu%d", gpu_index);
-                config_write_gpu(gpu_key, "manual", speed);
+                config_write_gpu((unsigned int)gpu_index, "manual", speed);
                 fan_set_gpu_speed((unsigned int)gpu_index, (unsigned int)speed);
                 printf("GPU %d set to fixed speed %d%%.\n", gpu_index, speed);
             } else {
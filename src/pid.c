@@ -0,0 +1,50 @@
+#include "pid.h"
+
+static double clamp(double v, double lo, double hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void pid_reset(PidState *pid) {
+    pid->active = 0;
+    pid->integral = 0.0;
+    pid->step = 0.0;
+    pid->prev_temp = 0.0;
+}
+
+int pid_update(PidState *pid, const PidGains *gains, int target, int temp,
+               double dt, int out_min, int out_max, int initial) {
+    /* Positive error = too hot = more fan */
+    double error = (double)(temp - target);
+
+    if (!pid->active) {
+        /* Preload the integrator so the first output equals `initial` */
+        pid->active = 1;
+        pid->integral = clamp(initial - gains->kp * error, out_min, out_max);
+        pid->prev_temp = temp;
+        dt = 0.0;
+    }
+
+    double p = gains->kp * error;
+    /* Derivative on measurement: a setpoint change does not kick the fans */
+    double d = dt > 0.0 ? gains->kd * (temp - pid->prev_temp) / dt : 0.0;
+    pid->prev_temp = temp;
+
+    /* Anti-windup: drop the integral step while it pushes further into a
+     * saturated output, and never let the term exceed the output range */
+    double integral = pid->integral + gains->ki * error * dt;
+    double out = p + integral + d;
+    double before = pid->integral;
+    if (!((out > out_max && error > 0.0) || (out < out_min && error < 0.0)))
+        pid->integral = clamp(integral, out_min, out_max);
+    pid->step = pid->integral - before;
+
+    out = clamp(p + pid->integral + d, out_min, out_max);
+    return (int)(out + 0.5);
+}
+
+void pid_track(PidState *pid, int asked, int applied) {
+    if ((applied < asked && pid->step > 0.0) || (applied > asked && pid->step < 0.0)) {
+        pid->integral -= pid->step;
+        pid->step = 0.0;
+    }
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fnmatch.h>
+#include "proc.h"
+
+int proc_pattern_compile(ProcPattern *p, const char *glob) {
+    memset(p, 0, sizeof(*p));
+    if (!glob)
+        return 0;
+    p->text = strdup(glob);
+    if (!p->text)
+        return -1;
+
+    const char *core = p->text;
+    size_t len = strlen(core);
+    int lead = len > 0 && core[0] == '*';
+    if (lead) {
+        core++;
+        len--;
+    }
+    int trail = len > 0 && core[len - 1] == '*';
+    if (trail)
+        len--;
+
+    if (memchr(core, '*', len) || memchr(core, '?', len) ||
+        memchr(core, '[', len) || memchr(core, '\\', len)) {
+        p->kind = PROC_MATCH_GLOB;
+        p->core = p->text;
+        p->len = strlen(p->text);
+        return 0;
+    }
+
+    p->core = core;
+    p->len = len;
+    if (len == 0)
+        p->kind = lead || trail ? PROC_MATCH_ANY : PROC_MATCH_EXACT;
+    else if (lead && trail)
+        p->kind = PROC_MATCH_CONTAINS;
+    else if (lead)
+        p->kind = PROC_MATCH_SUFFIX;
+    else if (trail)
+        p->kind = PROC_MATCH_PREFIX;
+    else
+        p->kind = PROC_MATCH_EXACT;
+    return 0;
+}
+
+void proc_pattern_free(ProcPattern *p) {
+    free(p->text);
+    memset(p, 0, sizeof(*p));
+}
+
+static int contains(const char *s, size_t len, const char *needle, size_t n) {
+    for (size_t i = 0; i + n <= len; i++) {
+        if (s[i] == needle[0] && memcmp(s + i, needle, n) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+int proc_pattern_match(const ProcPattern *p, const char *s, size_t len) {
+    switch (p->kind) {
+    case PROC_MATCH_ANY:
+        return 1;
+    case PROC_MATCH_EXACT:
+        return len == p->len && memcmp(s, p->core, len) == 0;
+    case PROC_MATCH_PREFIX:
+        return len >= p->len && memcmp(s, p->core, p->len) == 0;
+    case PROC_MATCH_SUFFIX:
+        return len >= p->len && memcmp(s + len - p->len, p->core, p->len) == 0;
+    case PROC_MATCH_CONTAINS:
+        return contains(s, len, p->core, p->len);
+    case PROC_MATCH_GLOB:
+        return fnmatch(p->core, s, 0) == 0;
+    }
+    return 0;
+}
+
+/* Reads a small /proc file; returns its length, -1 if it cannot be read */
+static ssize_t read_small(const char *path, char *buf, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0)
+        return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+/* The "0::<path>" line of the unified hierarchy, else the first line's path */
+static void parse_cgroup(char *buf, ProcInfo *out) {
+    char *line = strstr(buf, "0::");
+    if (line == buf || (line && line[-1] == '\n'))
+        line += 3;
+    else if ((line = strchr(buf, ':')) && (line = strchr(line + 1, ':')))
+        line++;
+    else
+        return;
+
+    size_t len = strcspn(line, "\n");
+    if (len >= sizeof(out->cgroup))
+        len = sizeof(out->cgroup) - 1;
+    memcpy(out->cgroup, line, len);
+    out->cgroup[len] = '\0';
+    out->cgroup_len = len;
+}
+
+int proc_read(unsigned int pid, int cgroup, ProcInfo *out) {
+    char path[64];
+    char buf[1024];
+
+    memset(out, 0, sizeof(*out));
+    out->pid = pid;
+
+    snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+    ssize_t n = read_small(path, buf, sizeof(buf));
+    if (n < 0)
+        return -1;
+    size_t len = strcspn(buf, "\n");
+    if (len >= sizeof(out->comm))
+        len = sizeof(out->comm) - 1;
+    memcpy(out->comm, buf, len);
+    out->comm[len] = '\0';
+    out->comm_len = len;
+
+    if (cgroup) {
+        snprintf(path, sizeof(path), "/proc/%u/cgroup", pid);
+        if (read_small(path, buf, sizeof(buf)) > 0)
+            parse_cgroup(buf, out);
+    }
+    return 0;
+}
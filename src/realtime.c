@@ -0,0 +1,192 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <malloc.h>
+#include <syslog.h>
+#include <sys/mman.h>
+
+#include "realtime.h"
+
+/* CPUs set aside for compute (isolcpus=, nohz_full=) */
+static const char *const reserved_cpus[] = {
+    "/sys/devices/system/cpu/isolated",
+    "/sys/devices/system/cpu/nohz_full",
+};
+
+static const char *const sched_names[] = { "inherit", "other", "fifo", "rr" };
+
+void rt_defaults(RealtimeParams *p) {
+    p->sched = RT_SCHED_INHERIT;
+    p->priority = NVFD_RT_PRIORITY_DEFAULT;
+    p->cpus[0] = '\0';
+    p->lock_memory = 0;
+}
+
+int rt_parse_sched(const char *str, RtSched *sched) {
+    for (int s = RT_SCHED_OTHER; s <= RT_SCHED_RR; s++) {
+        if (str && strcmp(str, sched_names[s]) == 0) {
+            *sched = (RtSched)s;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *rt_sched_name(RtSched sched) {
+    return sched >= RT_SCHED_INHERIT && sched <= RT_SCHED_RR ? sched_names[sched] : "?";
+}
+
+/* "0-3,8" into set; a trailing newline is allowed, as sysfs ends in one */
+static int parse_cpus(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p && *p != '\n') {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        if (end == p || lo < 0)
+            return -1;
+        long hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p || hi < lo)
+                return -1;
+        }
+        if (hi >= CPU_SETSIZE)
+            return -1;
+        for (long c = lo; c <= hi; c++)
+            CPU_SET((int)c, set);
+
+        if (*end == ',' && end[1] >= '0' && end[1] <= '9')
+            p = end + 1;
+        else if (*end == '\0' || *end == '\n')
+            p = end;
+        else
+            return -1;
+    }
+    return 0;
+}
+
+int rt_valid_cpus(const char *list) {
+    cpu_set_t set;
+    return parse_cpus(list, &set) == 0 && CPU_COUNT(&set) > 0 ? 0 : -1;
+}
+
+static void format_cpus(const cpu_set_t *set, char *buf, size_t len) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int c = 0; c < CPU_SETSIZE && used < len; c++) {
+        if (!CPU_ISSET(c, set))
+            continue;
+        int last = c;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set))
+            last++;
+        int n = last > c ? snprintf(buf + used, len - used, "%s%d-%d", used ? "," : "", c, last)
+                         : snprintf(buf + used, len - used, "%s%d", used ? "," : "", c);
+        used += n > 0 ? (size_t)n : 0;
+        c = last;
+    }
+}
+
+static int read_cpus(const char *path, cpu_set_t *set) {
+    char buf[1024];
+    FILE *f = fopen(path, "r");
+    CPU_ZERO(set);
+    if (!f)
+        return -1;
+    int ok = fgets(buf, sizeof(buf), f) != NULL && parse_cpus(buf, set) == 0;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+int rt_equal(const RealtimeParams *a, const RealtimeParams *b) {
+    int rt = a->sched == RT_SCHED_FIFO || a->sched == RT_SCHED_RR;
+    return a->sched == b->sched && (!rt || a->priority == b->priority) &&
+           strcmp(a->cpus, b->cpus) == 0 && a->lock_memory == b->lock_memory;
+}
+
+/* The configured CPUs, or the ones allowed now, minus reserved ones */
+static void apply_affinity(const char *cpus) {
+    cpu_set_t set;
+    if (cpus[0])
+        parse_cpus(cpus, &set);
+    else if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return;
+
+    int dropped = 0;
+    for (size_t r = 0; r < sizeof(reserved_cpus) / sizeof(reserved_cpus[0]); r++) {
+        cpu_set_t reserved;
+        if (read_cpus(reserved_cpus[r], &reserved) != 0)
+            continue;
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &reserved) && CPU_ISSET(c, &set)) {
+                CPU_CLR(c, &set);
+                dropped++;
+            }
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        syslog(LOG_WARNING, "Every CPU in \"%s\" is isolated; CPU affinity unchanged",
+               cpus);
+        return;
+    }
+    if (!cpus[0] && !dropped)
+        return;
+
+    char list[NVFD_RT_CPUS_MAX];
+    format_cpus(&set, list, sizeof(list));
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        syslog(LOG_WARNING, "Cannot run on CPUs %s: %m", list);
+    else
+        syslog(LOG_INFO, "Running on CPUs %s%s", list,
+               dropped ? ", isolated CPUs left out" : "");
+}
+
+static void apply_sched(const RealtimeParams *p) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    int policy = SCHED_OTHER;
+    if (p->sched == RT_SCHED_INHERIT)
+        return;
+    if (p->sched == RT_SCHED_FIFO || p->sched == RT_SCHED_RR) {
+        policy = p->sched == RT_SCHED_FIFO ? SCHED_FIFO : SCHED_RR;
+        param.sched_priority = p->priority;
+    }
+
+    if (sched_setscheduler(0, policy, &param) != 0)
+        syslog(LOG_WARNING, "Cannot switch to %s scheduling: %m",
+               rt_sched_name(p->sched));
+    else
+        syslog(LOG_INFO, "Scheduling: %s, priority %d", rt_sched_name(p->sched),
+               param.sched_priority);
+}
+
+/* Growing the stack into these pages later never faults */
+static void prefault_stack(void) {
+    volatile unsigned char stack[NVFD_RT_STACK_PREFAULT];
+    for (size_t i = 0; i < sizeof(stack); i += 4096)
+        stack[i] = 0;
+}
+
+/* Locks what is mapped now and whatever is mapped later, thread stacks
+ * included, and keeps malloc from returning memory that would have to be
+ * faulted in again */
+static void lock_memory(void) {
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        syslog(LOG_WARNING, "Cannot lock memory: %m");
+        return;
+    }
+    prefault_stack();
+    syslog(LOG_INFO, "Memory locked");
+}
+
+void rt_apply(const RealtimeParams *p) {
+    apply_affinity(p->cpus);
+    apply_sched(p);
+    if (p->lock_memory)
+        lock_memory();
+}
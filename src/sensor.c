@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "sensor.h"
+
+static const char *const sensor_names[SENSOR_COUNT] = { "core", "mem" };
+
+const char *sensor_name(SensorId sensor) {
+    return sensor >= 0 && sensor < SENSOR_COUNT ? sensor_names[sensor] : "?";
+}
+
+static const char *skip_space(const char *p) {
+    while (isspace((unsigned char)*p))
+        p++;
+    return p;
+}
+
+/* name[+-offset]; returns the end of the term, NULL if invalid */
+static const char *parse_term(const char *p, SensorExpr *out) {
+    if (out->count == SENSOR_TERMS_MAX)
+        return NULL;
+
+    p = skip_space(p);
+    int sensor = -1;
+    for (int s = 0; s < SENSOR_COUNT; s++) {
+        size_t len = strlen(sensor_names[s]);
+        if (strncmp(p, sensor_names[s], len) == 0 && !isalnum((unsigned char)p[len])) {
+            sensor = s;
+            p += len;
+            break;
+        }
+    }
+    if (sensor < 0)
+        return NULL;
+
+    long offset = 0;
+    p = skip_space(p);
+    if (*p == '+' || *p == '-') {
+        char *end;
+        offset = strtol(p + 1, &end, 10);
+        if (end == p + 1 || offset < 0 || offset > SENSOR_OFFSET_MAX)
+            return NULL;
+        if (*p == '-')
+            offset = -offset;
+        p = end;
+    }
+
+    out->terms[out->count].sensor = (SensorId)sensor;
+    out->terms[out->count].offset = (int)offset;
+    out->count++;
+    return skip_space(p);
+}
+
+int sensor_parse(const char *text, SensorExpr *out) {
+    memset(out, 0, sizeof(*out));
+    const char *p = skip_space(text);
+
+    if (strncmp(p, "max", 3) == 0 && *skip_space(p + 3) == '(') {
+        p = skip_space(p + 3) + 1;
+        for (;;) {
+            p = parse_term(p, out);
+            if (!p)
+                return -1;
+            if (*p == ')')
+                break;
+            if (*p != ',')
+                return -1;
+            p++;
+        }
+        p++;
+    } else {
+        p = parse_term(p, out);
+        if (!p)
+            return -1;
+    }
+    return *skip_space(p) == '\0' ? 0 : -1;
+}
+
+void sensor_format(const SensorExpr *expr, char *buf, size_t len) {
+    if (expr->count == 0) {
+        snprintf(buf, len, "%s", sensor_names[SENSOR_CORE]);
+        return;
+    }
+
+    buf[0] = '\0';
+    if (expr->count > 1)
+        strncat(buf, "max(", len - strlen(buf) - 1);
+    for (int i = 0; i < expr->count; i++) {
+        char term[32];
+        int n = snprintf(term, sizeof(term), "%s%s", i > 0 ? ", " : "",
+                         sensor_name(expr->terms[i].sensor));
+        if (expr->terms[i].offset != 0)
+            snprintf(term + n, sizeof(term) - (size_t)n, "%+d", expr->terms[i].offset);
+        strncat(buf, term, len - strlen(buf) - 1);
+    }
+    if (expr->count > 1)
+        strncat(buf, ")", len - strlen(buf) - 1);
+}
+
+unsigned int sensor_mask(const SensorExpr *expr) {
+    unsigned int mask = expr->count == 0 ? 1u << SENSOR_CORE : 0;
+    for (int i = 0; i < expr->count; i++)
+        mask |= 1u << expr->terms[i].sensor;
+    return mask;
+}
+
+int sensor_eval(const SensorExpr *expr, const int *temps) {
+    if (expr->count == 0)
+        return temps[SENSOR_CORE];
+
+    int best = -1;
+    for (int i = 0; i < expr->count; i++) {
+        int t = temps[expr->terms[i].sensor];
+        if (t < 0)
+            continue;
+        t += expr->terms[i].offset;
+        if (t < 0)
+            t = 0;
+        if (best < 0 || t > best)
+            best = t;
+    }
+    return best;
+}
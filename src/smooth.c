@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <string.h>
+#include "smooth.h"
+#include "nvfd.h"
+
+void smooth_defaults(SmoothParams *p) {
+    p->kind = FILTER_EMA;
+    p->tau_s = NVFD_FILTER_TAU_S_DEFAULT;
+    p->window = NVFD_FILTER_WINDOW_DEFAULT;
+    p->slew_up = NVFD_SLEW_UP_DEFAULT;
+    p->slew_down = NVFD_SLEW_DOWN_DEFAULT;
+    p->critical_temp = NVFD_CRITICAL_TEMP_DEFAULT;
+}
+
+int smooth_parse_filter(const char *str, FilterKind *kind) {
+    if (strcmp(str, "none") == 0)
+        *kind = FILTER_NONE;
+    else if (strcmp(str, "ema") == 0)
+        *kind = FILTER_EMA;
+    else if (strcmp(str, "median") == 0)
+        *kind = FILTER_MEDIAN;
+    else
+        return -1;
+    return 0;
+}
+
+void temp_filter_reset(TempFilter *f) {
+    memset(f, 0, sizeof(*f));
+}
+
+static int compare_ints(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+static double median(const TempFilter *f) {
+    int sorted[SMOOTH_WINDOW_MAX];
+    memcpy(sorted, f->samples, (size_t)f->count * sizeof(int));
+    qsort(sorted, (size_t)f->count, sizeof(int), compare_ints);
+    if (f->count % 2)
+        return sorted[f->count / 2];
+    return (sorted[f->count / 2 - 1] + sorted[f->count / 2]) / 2.0;
+}
+
+int temp_filter_update(TempFilter *f, const SmoothParams *p, int temp, double dt) {
+    switch (p->kind) {
+    case FILTER_EMA:
+        if (!f->primed || p->tau_s <= 0.0) {
+            f->value = temp;
+        } else {
+            /* alpha from elapsed time, so variable poll intervals agree */
+            double alpha = dt / (p->tau_s + dt);
+            f->value += alpha * (temp - f->value);
+        }
+        break;
+    case FILTER_MEDIAN: {
+        int window = p->window < SMOOTH_WINDOW_MAX ? p->window : SMOOTH_WINDOW_MAX;
+        if (f->count > window || f->pos >= window) {
+            f->count = 0; /* window shrank on reload */
+            f->pos = 0;
+        }
+        f->samples[f->pos] = temp;
+        f->pos = (f->pos + 1) % window;
+        if (f->count < window)
+            f->count++;
+        f->value = median(f);
+        break;
+    }
+    default:
+        f->value = temp;
+        break;
+    }
+    f->primed = 1;
+    return (int)(f->value + 0.5);
+}
+
+void slew_reset(SlewLimiter *s) {
+    s->primed = 0;
+    s->output = 0.0;
+}
+
+int slew_update(SlewLimiter *s, const SmoothParams *p, int target, double dt,
+                int bypass) {
+    if (!s->primed || bypass) {
+        s->output = target;
+        s->primed = 1;
+        return target;
+    }
+
+    double delta = target - s->output;
+    if (delta > 0.0 && p->slew_up > 0.0 && delta > p->slew_up * dt)
+        delta = p->slew_up * dt;
+    else if (delta < 0.0 && p->slew_down > 0.0 && -delta > p->slew_down * dt)
+        delta = -p->slew_down * dt;
+    s->output += delta;
+
+    return (int)(s->output + 0.5);
+}
+
+int slew_settled(const SlewLimiter *s, int target) {
+    return !s->primed || (int)(s->output + 0.5) == target;
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "watch.h"
+#include "nvfd.h"
+
+/* Editors either rewrite in place (CLOSE_WRITE) or rename a temp file
+ * over the target (MOVED_TO, as config_write_gpu and curve_write do). */
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+
+/* The profile directory may come and go; its watch is tracked separately */
+static int profile_wd = -1;
+
+static void watch_profiles(int fd) {
+    if (profile_wd < 0)
+        profile_wd = inotify_add_watch(fd, NVFD_PROFILE_DIR, WATCH_EVENTS | IN_ONLYDIR);
+}
+
+static const char *basename_of(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/* Editor swap and temp files in the profile directory are not profiles */
+static int is_profile_event(const struct inotify_event *ev) {
+    if (ev->len == 0)
+        return (ev->mask & IN_IGNORED) != 0;
+    size_t len = strlen(ev->name);
+    return len > 5 && strcmp(ev->name + len - 5, ".json") == 0;
+}
+
+int watch_open(void) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        perror("inotify_init1");
+        return -1;
+    }
+    if (inotify_add_watch(fd, NVFD_CONFIG_DIR, WATCH_EVENTS | IN_CREATE) < 0) {
+        perror("inotify_add_watch(" NVFD_CONFIG_DIR ")");
+        close(fd);
+        return -1;
+    }
+    profile_wd = -1;
+    watch_profiles(fd);
+    return fd;
+}
+
+int watch_read(int fd) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const char *config_name = basename_of(NVFD_CONFIG_FILE);
+    const char *curve_name = basename_of(NVFD_CURVE_FILE);
+    const char *profile_dir = basename_of(NVFD_PROFILE_DIR);
+    int changed = 0;
+
+    /* Drain everything queued so a burst of events costs one reload */
+    for (;;) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0)
+            break;
+
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->wd == profile_wd) {
+                if (ev->mask & IN_IGNORED)
+                    profile_wd = -1; /* directory removed */
+                if (is_profile_event(ev))
+                    changed |= WATCH_PROFILES;
+            } else if (ev->len > 0 && strcmp(ev->name, profile_dir) == 0) {
+                watch_profiles(fd);
+                changed |= WATCH_PROFILES;
+            } else if (ev->len > 0 && !(ev->mask & IN_CREATE)) {
+                if (strcmp(ev->name, config_name) == 0)
+                    changed |= WATCH_CONFIG;
+                else if (strcmp(ev->name, curve_name) == 0)
+                    changed |= WATCH_CURVE;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include "worker.h"
+#include "evloop.h"
+#include "gpu.h"
+
+typedef enum {
+    WORKER_IDLE,
+    WORKER_PENDING,   /* submitted, running or about to */
+    WORKER_DONE       /* result waiting to be collected */
+} WorkerState;
+
+typedef struct {
+    WorkerPool     *pool;
+    unsigned int    gpu_index;
+    pthread_t       thread;
+    int             started;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    WorkerState     state;
+    WorkerJob       job;
+    double          since;
+    int             stop;
+} Worker;
+
+struct WorkerPool {
+    Worker      *workers;
+    unsigned int count;
+    int          event_fd;
+};
+
+static void scan_processes(const GpuDevice *dev, ProcessList *list, int cgroups) {
+    unsigned int pids[PROC_LIST_MAX];
+    int n = dev ? gpu_get_processes(dev->handle, pids, PROC_LIST_MAX) : -1;
+
+    list->count = 0;
+    list->ok = n >= 0;
+    for (int i = 0; i < n; i++) {
+        /* Exited since NVML listed it */
+        if (proc_read(pids[i], cgroups, &list->procs[list->count]) == 0)
+            list->count++;
+    }
+}
+
+static void run_job(unsigned int gpu_index, WorkerJob *job) {
+    const GpuDevice *dev = gpu_device(gpu_index);
+
+    if (job->power_set > 0)
+        job->power_ok = dev && gpu_set_power_limit(dev->handle, job->power_set) == 0;
+
+    switch (job->kind) {
+    case WORK_SAMPLE:
+        if (dev) {
+            job->status = gpu_read_sensors(dev, job->sensors | 1u << SENSOR_CORE,
+                                           job->temps);
+        } else {
+            job->temps[SENSOR_CORE] = job->temps[SENSOR_MEM] = -1;
+            job->status = NVML_ERROR_GPU_IS_LOST;
+        }
+        job->power = job->power_limit = job->util = job->sm_clock = -1;
+        job->reasons_ok = dev && gpu_get_throttle_reasons(dev->handle, &job->reasons) == 0;
+        if (dev && job->load) {
+            job->power = gpu_get_power(dev->handle);
+            job->power_limit = gpu_get_power_limit(dev->handle);
+            job->util = gpu_get_utilization(dev->handle);
+        }
+        if (dev && job->clocks)
+            job->sm_clock = gpu_get_sm_clock(dev->handle);
+        break;
+    case WORK_WRITE:
+        job->failures = fan_command_gpu_speeds(gpu_index, job->speeds, job->fans,
+                                               job->deadband, job->reassert_s,
+                                               job->now, &job->stats);
+        break;
+    case WORK_RESET:
+        job->failures = fan_reset_to_auto(gpu_index);
+        if (job->fans)
+            fan_state_reset(job->fans);
+        break;
+    case WORK_PROCESSES:
+        break;
+    case WORK_PROBE: {
+        nvmlReturn_t status;
+        job->probe = gpu_reprobe(gpu_index, &job->probed, &status);
+        job->status = status;
+        if (job->probe == 0 && job->fans)
+            fan_state_reset(job->fans);
+        break;
+    }
+    }
+    if (job->procs)
+        scan_processes(dev, job->procs, job->cgroups);
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (w->state != WORKER_PENDING && !w->stop)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (w->stop)
+            break;
+
+        WorkerJob job = w->job;
+        pthread_mutex_unlock(&w->lock);
+
+        run_job(w->gpu_index, &job);
+
+        pthread_mutex_lock(&w->lock);
+        w->job = job;
+        w->state = WORKER_DONE;
+
+        uint64_t one = 1;
+        if (write(w->pool->event_fd, &one, sizeof(one)) < 0)
+            perror("worker: eventfd write");
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+WorkerPool *worker_pool_create(unsigned int count) {
+    WorkerPool *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+    pool->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pool->event_fd < 0) {
+        perror("eventfd");
+        free(pool);
+        return NULL;
+    }
+    if (count > 0) {
+        pool->workers = calloc(count, sizeof(*pool->workers));
+        if (!pool->workers) {
+            worker_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    /* Workers inherit the mask: signals belong to the main thread's signalfd */
+    sigset_t all, saved;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, NVFD_THREAD_STACK);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->gpu_index = i;
+        w->state = WORKER_IDLE;
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        pool->count = i + 1;
+
+        if (pthread_create(&w->thread, &attr, worker_main, w) != 0) {
+            fprintf(stderr, "Failed to start worker for GPU %u\n", i);
+            pthread_attr_destroy(&attr);
+            pthread_sigmask(SIG_SETMASK, &saved, NULL);
+            worker_pool_destroy(pool);
+            return NULL;
+        }
+        w->started = 1;
+    }
+
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    return pool;
+}
+
+int worker_pool_destroy(WorkerPool *pool) {
+    if (!pool)
+        return 0;
+
+    int stuck = 0;
+    for (unsigned int i = 0; i < pool->count; i++) {
+        Worker *w = &pool->workers[i];
+        if (!w->started)
+            continue;
+        pthread_mutex_lock(&w->lock);
+        w->stop = 1;
+        int running = w->state == WORKER_PENDING;
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+
+        /* Joining a thread blocked in the driver would hang shutdown */
+        if (running) {
+            pthread_detach(w->thread);
+            w->started = 0;
+            stuck = 1;
+        }
+    }
+    for (unsigned int i = 0; i < pool->count; i++) {
+        if (pool->workers[i].started)
+            pthread_join(pool->workers[i].thread, NULL);
+    }
+    if (stuck)
+        return -1; /* detached threads still reference the pool */
+
+    for (unsigned int i = 0; i < pool->count; i++) {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+        pthread_cond_destroy(&pool->workers[i].cond);
+    }
+    close(pool->event_fd);
+    free(pool->workers);
+    free(pool);
+    return 0;
+}
+
+int worker_pool_fd(const WorkerPool *pool) {
+    return pool->event_fd;
+}
+
+void worker_pool_drain_fd(WorkerPool *pool) {
+    uint64_t n;
+    while (read(pool->event_fd, &n, sizeof(n)) == (ssize_t)sizeof(n))
+        ;
+}
+
+int worker_submit(WorkerPool *pool, unsigned int gpu_index, const WorkerJob *job,
+                  double now) {
+    if (gpu_index >= pool->count)
+        return -1;
+    Worker *w = &pool->workers[gpu_index];
+
+    pthread_mutex_lock(&w->lock);
+    if (w->state != WORKER_IDLE) {
+        pthread_mutex_unlock(&w->lock);
+        return -1;
+    }
+    w->job = *job;
+    w->since = now;
+    w->state = WORKER_PENDING;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+int worker_collect(WorkerPool *pool, unsigned int gpu_index, WorkerJob *out) {
+    if (gpu_index >= pool->count)
+        return 0;
+    Worker *w = &pool->workers[gpu_index];
+
+    pthread_mutex_lock(&w->lock);
+    int ready = w->state == WORKER_DONE;
+    if (ready) {
+        *out = w->job;
+        w->state = WORKER_IDLE;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ready;
+}
+
+int worker_busy(WorkerPool *pool, unsigned int gpu_index, double *since) {
+    if (gpu_index >= pool->count)
+        return 0;
+    Worker *w = &pool->workers[gpu_index];
+
+    pthread_mutex_lock(&w->lock);
+    int busy = w->state == WORKER_PENDING;
+    if (busy && since)
+        *since = w->since;
+    pthread_mutex_unlock(&w->lock);
+    return busy;
+}
+
+int worker_wait(WorkerPool *pool, unsigned int gpu_index, double deadline) {
+    WorkerJob discard;
+
+    for (;;) {
+        worker_collect(pool, gpu_index, &discard);
+        if (!worker_busy(pool, gpu_index, NULL))
+            return 0;
+
+        double left = deadline - evloop_now();
+        if (left <= 0.0)
+            return -1;
+
+        struct pollfd pfd = { .fd = pool->event_fd, .events = POLLIN };
+        poll(&pfd, 1, (int)(left * 1000.0) + 1);
+        worker_pool_drain_fd(pool);
+    }
+}
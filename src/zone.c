@@ -0,0 +1,39 @@
+#include <string.h>
+#include "zone.h"
+
+int zone_parse_combine(const char *name, ZoneCombine *combine) {
+    if (!name)
+        return -1;
+    if (strcmp(name, "max") == 0)
+        *combine = ZONE_MAX;
+    else if (strcmp(name, "weighted") == 0)
+        *combine = ZONE_WEIGHTED;
+    else
+        return -1;
+    return 0;
+}
+
+const char *zone_combine_name(ZoneCombine combine) {
+    return combine == ZONE_WEIGHTED ? "weighted" : "max";
+}
+
+int zone_combine(const Zone *zone, const int *temps) {
+    int hottest = -1;
+    double sum = 0.0, weights = 0.0;
+
+    for (int m = 0; m < zone->member_count; m++) {
+        if (temps[m] < 0)
+            continue;
+        int temp = temps[m] + zone->members[m].offset;
+        if (temp < 0)
+            temp = 0;
+        if (temp > hottest)
+            hottest = temp;
+        sum += zone->members[m].weight * temp;
+        weights += zone->members[m].weight;
+    }
+
+    if (zone->combine == ZONE_WEIGHTED && weights > 0.0)
+        return (int)(sum / weights + 0.5);
+    return hottest;
+}
@@ -0,0 +1,94 @@
+/* make bench: what compiling curves into per-degree tables saves. Times
+ * curve_compile, then the per-sample evaluation of every fan on a large
+ * node both ways: curve_lookup_batch over compiled tables and
+ * curve_interpolate over the point lists. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "curve.h"
+
+#define BENCH_FANS    256    /* 64 GPUs with 4 fans */
+#define BENCH_SAMPLES 4096   /* temperature sets, cycled */
+#define BENCH_ROUNDS  20
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Ten points, offset per fan so no two curves are alike */
+static void make_curve(FanCurve *curve, unsigned int fan, CurveInterpolation mode) {
+    curve_init(curve);
+    curve->interpolation = mode;
+    for (int i = 0; i < 10; i++)
+        curve_set_point(curve, 25 + i * 7 + (int)(fan % 5),
+                        20 + i * 8 + (int)(fan % 3));
+}
+
+static int bench(CurveInterpolation mode, int *temps) {
+    static FanCurve curves[BENCH_FANS];
+    static CurveTable tables[BENCH_FANS];
+    static const CurveTable *bound[BENCH_FANS];
+    static unsigned int speeds[BENCH_FANS];
+    unsigned long long sum_table = 0, sum_points = 0;
+    int rounds = BENCH_ROUNDS * BENCH_SAMPLES;
+
+    for (unsigned int f = 0; f < BENCH_FANS; f++)
+        make_curve(&curves[f], f, mode);
+
+    double t0 = now_ns();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (unsigned int f = 0; f < BENCH_FANS; f++)
+            curve_compile(&curves[f], &tables[f]);
+    double compile = (now_ns() - t0) / (BENCH_ROUNDS * BENCH_FANS);
+    for (unsigned int f = 0; f < BENCH_FANS; f++)
+        bound[f] = &tables[f];
+
+    t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        curve_lookup_batch(bound, temps + (r % BENCH_SAMPLES) * BENCH_FANS,
+                           speeds, BENCH_FANS);
+        for (unsigned int f = 0; f < BENCH_FANS; f++)
+            sum_table += speeds[f];
+    }
+    double table = (now_ns() - t0) / ((double)rounds * BENCH_FANS);
+
+    t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        const int *t = temps + (r % BENCH_SAMPLES) * BENCH_FANS;
+        for (unsigned int f = 0; f < BENCH_FANS; f++)
+            sum_points += (unsigned int)curve_interpolate(t[f], &curves[f]);
+    }
+    double points = (now_ns() - t0) / ((double)rounds * BENCH_FANS);
+
+    for (unsigned int f = 0; f < BENCH_FANS; f++)
+        curve_free(&curves[f]);
+
+    printf("%-15s compile %7.1f ns/curve  table %5.2f ns/fan  points %6.2f ns/fan  (%.1fx)\n",
+           curve_interpolation_name(mode), compile, table, points, points / table);
+    if (sum_table != sum_points) {
+        fprintf(stderr, "%s: tables and point lists disagree\n",
+                curve_interpolation_name(mode));
+        return -1;
+    }
+    return 0;
+}
+
+int main(void) {
+    int *temps = malloc(sizeof(int) * BENCH_SAMPLES * BENCH_FANS);
+    if (!temps)
+        return 1;
+    srand(1);
+    for (int i = 0; i < BENCH_SAMPLES * BENCH_FANS; i++)
+        temps[i] = 30 + rand() % 60;
+
+    printf("%u fans, %u samples each\n", BENCH_FANS, BENCH_ROUNDS * BENCH_SAMPLES);
+    int ret = 0;
+    if (bench(CURVE_LINEAR, temps) < 0 ||
+        bench(CURVE_MONOTONE_CUBIC, temps) < 0 ||
+        bench(CURVE_STEP, temps) < 0)
+        ret = 1;
+    free(temps);
+    return ret;
+}
@@ -0,0 +1,50 @@
+/* Assertions for the unit tests in tests/test_*.c, each its own program.
+ * A failed check is reported with its line and the run goes on; main()
+ * ends with check_done(), which sets the exit status. */
+#ifndef NVFD_CHECK_H
+#define NVFD_CHECK_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int check_count;
+static int check_failures;
+
+#define CHECK(cond) do { \
+    check_count++; \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        check_failures++; \
+    } \
+} while (0)
+
+#define CHECK_INT(got, want) do { \
+    long long got_ = (got), want_ = (want); \
+    check_count++; \
+    if (got_ != want_) { \
+        fprintf(stderr, "%s:%d: %s is %lld, not %lld\n", __FILE__, __LINE__, \
+                #got, got_, want_); \
+        check_failures++; \
+    } \
+} while (0)
+
+#define CHECK_STR(got, want) do { \
+    const char *got_ = (got), *want_ = (want); \
+    check_count++; \
+    if (strcmp(got_, want_) != 0) { \
+        fprintf(stderr, "%s:%d: %s is \"%s\", not \"%s\"\n", __FILE__, __LINE__, \
+                #got, got_, want_); \
+        check_failures++; \
+    } \
+} while (0)
+
+static int check_done(const char *name) {
+    if (check_failures) {
+        fprintf(stderr, "FAIL %s: %d of %d checks\n", name, check_failures, check_count);
+        return 1;
+    }
+    printf("PASS %s: %d checks\n", name, check_count);
+    return 0;
+}
+
+#endif /* NVFD_CHECK_H */
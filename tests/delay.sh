@@ -0,0 +1,34 @@
+#!/bin/bash
+# One GPU whose NVML calls take seconds must not hold the others back:
+# each GPU has its own worker, so the healthy ones keep their poll
+# cadence while the slow one is timed out and quarantined.
+. "$(dirname "$0")/lib.sh"
+
+GPUS=4
+POLL_MS=250
+DELAY_MS=3000
+export FAKE_NVML_GPUS=$GPUS
+export FAKE_NVML_TRACE=$WORK/trace
+
+write_config "$GPUS" "{\"poll_min_ms\": $POLL_MS, \"poll_max_ms\": $POLL_MS, \"filter\": \"none\"}"
+start_daemon
+sleep 1
+set_gpu 0 delay_ms "$DELAY_MS"
+from=$(wc -l < "$FAKE_NVML_TRACE")
+sleep 7
+stop_daemon
+
+grep -q "GPU 0: NVML call stuck" "$WORK/log" || fail "GPU 0 was never timed out"
+timeouts=$(scheduler_count "NVML timeouts")
+[ "${timeouts:-0}" -ge 1 ] || fail "no NVML timeouts counted"
+
+# Longest gap between readings of each healthy GPU once GPU 0 slowed down:
+# at most two poll intervals, plus scheduling slack
+for gpu in $(seq 1 $((GPUS - 1))); do
+    gap=$(awk -v g="gpu$gpu" -v from="$from" '
+        NR > from && $2 == g { if (last) { d = $1 - last; if (d > max) max = d } last = $1 }
+        END { printf "%.3f\n", max }' "$FAKE_NVML_TRACE")
+    awk -v d="$gap" -v p="$POLL_MS" 'BEGIN { exit !(d > 0 && d <= 2 * p / 1000 + 0.1) }' ||
+        fail "GPU $gpu went $gap s between readings while GPU 0 hung"
+done
+pass "GPUs 1-$((GPUS - 1)) kept their ${POLL_MS} ms cadence while GPU 0 took $DELAY_MS ms per call"
@@ -0,0 +1,64 @@
+#!/bin/bash
+# NVML events: a clock event samples its GPU at once instead of at the next
+# poll, an Xid error is logged, and a GPU whose registration is refused is
+# still polled.
+. "$(dirname "$0")/lib.sh"
+
+POLL_MAX_MS=2000
+export FAKE_NVML_GPUS=2
+export FAKE_NVML_EVENTS=1
+export FAKE_NVML_TRACE=$WORK/trace
+
+# Manual mode polls at poll_max_ms, twice that with clock events
+write_config 2 "{\"poll_min_ms\": 250, \"poll_max_ms\": $POLL_MAX_MS, \"filter\": \"none\"}" \
+    '{"mode": "manual", "speed": 50}'
+set_gpu 1 noevents 1
+start_daemon
+sleep 5
+
+grep -q "NVML events registered for 1 of 2 GPUs" "$WORK/log" ||
+    fail "GPU 1 refused registration but was not left out"
+
+# readings GPU: times of the GPU's temperature readings so far
+readings() {
+    awk -v g="gpu$1" '$2 == g && $3 == "temp" { print $1 }' "$FAKE_NVML_TRACE"
+}
+
+# (a) Just after a reading of GPU 0 its next poll is seconds away; a clock
+# event must bring it forward to poll_min_ms after that reading
+count=$(readings 0 | wc -l)
+for _ in $(seq 100); do
+    [ "$(readings 0 | wc -l)" -gt "$count" ] && break
+    sleep 0.05
+done
+nvml_event "0 clock"
+sleep 1.5
+# The reading before the event, the event, and the first reading after it
+set -- $(awk '$2 == "gpu0" && $3 == "temp" { if (!ev) last = $1; else if (!t) t = $1 }
+              $2 == "gpu0" && $3 == "event" && !ev { ev = $1 }
+              END { print last, ev, t }' "$FAKE_NVML_TRACE")
+[ -n "$2" ] || fail "the clock event for GPU 0 was never delivered"
+[ -n "$3" ] || fail "GPU 0 was not sampled after its clock event"
+after=$(awk -v ev="$2" -v t="$3" 'BEGIN { printf "%.3f\n", t - ev }')
+awk -v last="$1" -v after="$after" -v t="$3" 'BEGIN { exit !(after <= 0.5 && t - last < 1.0) }' ||
+    fail "GPU 0 sampled $after s after its clock event, $(awk -v a="$1" -v b="$3" 'BEGIN { print b - a }') s after the previous reading"
+pass "clock event: GPU 0 sampled $after s after it"
+
+# (b) An Xid error is reported
+nvml_event "0 xid 79"
+sleep 1
+grep -q "GPU 0: Xid 79 reported by the driver" "$WORK/log" || fail "Xid 79 on GPU 0 not logged"
+pass "Xid event logged"
+
+# (c) GPU 1 gets no events, so they cannot wake it, but it is still polled
+nvml_event "1 clock"
+sleep 3
+stop_daemon
+grep -q "gpu1 event" "$FAKE_NVML_TRACE" && fail "GPU 1 got an event it never registered for"
+gap=$(readings 1 | awk 'NR > 1 { d = $1 - last; if (d > max) max = d } { last = $1 }
+                        END { printf "%.3f\n", max }')
+samples=$(readings 1 | wc -l)
+[ "$samples" -ge 5 ] || fail "GPU 1 sampled only $samples times"
+awk -v d="$gap" -v p="$POLL_MAX_MS" 'BEGIN { exit !(d <= p / 1000 + 0.5) }' ||
+    fail "GPU 1 went $gap s between readings"
+pass "GPU 1 polled every $gap s or sooner without events"
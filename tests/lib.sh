@@ -0,0 +1,87 @@
+# Sourced by the make check scripts, with the test nvfd as $1. Each script
+# gets a scratch directory for the stub NVML's files (FAKE_NVML_DIR) and
+# writes the config the test build reads from the build tree.
+
+NVFD=$(readlink -f "$1")
+TESTBUILD=$(dirname "$NVFD")
+TOPDIR=$(cd "$(dirname "$0")/.." && pwd)
+ETC=$TESTBUILD/etc
+WORK=$(mktemp -d "$TESTBUILD/run.XXXXXX")
+NAME=$(basename "$0" .sh)
+DAEMON_PID=
+
+export FAKE_NVML_DIR=$WORK
+unset LD_LIBRARY_PATH LD_PRELOAD
+
+cleanup() {
+    [ -n "$DAEMON_PID" ] && kill -KILL "$DAEMON_PID" 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL $NAME: $*" >&2
+    [ -f "$WORK/log" ] && tail -n 20 "$WORK/log" >&2
+    exit 1
+}
+
+pass() {
+    echo "PASS $NAME: $*"
+}
+
+# write_config GPUS DAEMON [ENTRY]: every GPU gets ENTRY (curve mode by
+# default), "daemon" gets DAEMON; the curve is the shipped default
+write_config() {
+    local entry=${3:-}
+    [ -n "$entry" ] || entry='{"mode": "curve"}'
+    rm -rf "$ETC"
+    mkdir -p "$ETC"
+    cp "$TOPDIR/config/default_curve.json" "$ETC/curve.json"
+    {
+        printf '{\n  "daemon": %s' "$2"
+        i=0
+        while [ "$i" -lt "$1" ]; do
+            printf ',\n  "GPU-stub-%d": %s' "$i" "$entry"
+            i=$((i + 1))
+        done
+        printf '\n}\n'
+    } > "$ETC/config.json"
+}
+
+# set_gpu N WHAT VALUE: a reading or fault for the stub (see tests/stub)
+set_gpu() {
+    echo "$3" > "$WORK/gpu$1_$2"
+}
+
+# nvml_event LINE: an event for the stub to deliver, "<gpu> <kind> [data]"
+nvml_event() {
+    echo "$1" > "$WORK/events.new"
+    mv "$WORK/events.new" "$WORK/events"
+}
+
+# Starts the daemon in the background, its log in $WORK/log
+start_daemon() {
+    "$NVFD" </dev/null >"$WORK/log" 2>&1 &
+    DAEMON_PID=$!
+}
+
+# Stops it the way systemd does; the final statistics land in the log
+stop_daemon() {
+    kill -TERM "$DAEMON_PID"
+    wait "$DAEMON_PID"
+    DAEMON_PID=
+}
+
+# The number in the last "Scheduler:" statistics line before WORD
+scheduler_count() {
+    grep 'Scheduler:' "$WORK/log" | tail -n 1 |
+        sed -n "s/.* \([0-9][0-9]*\) $1.*/\1/p"
+}
+
+# CPU seconds (user + system) a command and its children use; its own
+# output goes to $WORK/log
+cpu_seconds() {
+    local TIMEFORMAT='%3U %3S' times
+    times=$( { time "$@" </dev/null >"$WORK/log" 2>&1; } 2>&1)
+    echo "$times" | awk '{ printf "%.3f\n", $1 + $2 }'
+}
@@ -0,0 +1,51 @@
+#!/bin/bash
+# Control-loop cost against GPU count: 64 GPUs must cost about eight times
+# what 8 do, per sample in the daemon and per refresh in the dashboard,
+# not more. Fixed startup work only makes the larger run look cheaper.
+. "$(dirname "$0")/lib.sh"
+
+RUN_S=6
+DAEMON='{"poll_min_ms": 250, "poll_max_ms": 250, "filter": "none"}'
+
+# daemon_cost GPUS: CPU microseconds per GPU sample into COST
+daemon_cost() {
+    write_config "$1" "$DAEMON"
+    local cpu samples
+    cpu=$(FAKE_NVML_GPUS=$1 cpu_seconds timeout -s TERM "$RUN_S" "$NVFD")
+    samples=$(scheduler_count samples)
+    [ -n "$samples" ] || fail "no statistics from the $1-GPU daemon"
+    # Every GPU polled at 4 Hz, give or take startup
+    [ "$samples" -ge $(( $1 * RUN_S * 4 * 3 / 4 )) ] ||
+        fail "$1 GPUs: only $samples samples in $RUN_S s"
+    COST=$(echo "$cpu $samples" | awk '{ printf "%.1f\n", $1 * 1e6 / $2 }')
+}
+
+daemon_cost 8
+small=$COST
+daemon_cost 64
+large=$COST
+awk -v s="$small" -v l="$large" 'BEGIN { exit !(l <= 3 * s + 20) }' ||
+    fail "daemon: $large us per sample with 64 GPUs, $small us with 8"
+pass "daemon $small us per sample with 8 GPUs, $large us with 64"
+
+# The dashboard needs a terminal; script(1) gives it one
+if ! command -v script >/dev/null; then
+    pass "dashboard skipped, no script(1)"
+    exit 0
+fi
+
+# dashboard_cost GPUS: CPU seconds over RUN_S seconds of refreshes into COST
+dashboard_cost() {
+    write_config "$1" "$DAEMON"
+    COST=$(FAKE_NVML_GPUS=$1 TERM=xterm cpu_seconds script -qec \
+        "stty rows 60 cols 160; timeout -s TERM $RUN_S $NVFD" /dev/null)
+    grep -q "Stub GPU 0" "$WORK/log" || fail "$1 GPUs: the dashboard drew nothing"
+}
+
+dashboard_cost 8
+small=$COST
+dashboard_cost 64
+large=$COST
+awk -v s="$small" -v l="$large" 'BEGIN { exit !(l <= 3 * 8 * s + 0.05) }' ||
+    fail "dashboard: $large s CPU with 64 GPUs, $small s with 8"
+pass "dashboard $small s CPU with 8 GPUs, $large s with 64, over $RUN_S s"
@@ -0,0 +1,7 @@
+/* What main.c defines, for the programs that link the daemon's objects
+ * without it (make bench, make check's unit tests) */
+#include <signal.h>
+#include "nvfd.h"
+
+unsigned int device_count = 0;
+volatile sig_atomic_t keep_running = 1;
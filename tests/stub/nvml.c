@@ -0,0 +1,492 @@
+/* Stand-in for libnvidia-ml, so make check never touches a driver.
+ *
+ * FAKE_NVML_GPUS GPUs (default 2) with FAKE_NVML_FANS fans each (default
+ * 2). Readings come from small files in FAKE_NVML_DIR, read at every
+ * call, so a test can change them while the daemon runs:
+ *
+ *   gpu<N>_temp      core °C (default 50)
+ *   gpu<N>_util      utilization % (default 90)
+ *   gpu<N>_power     board power, mW (default 150000)
+ *   gpu<N>_clock     SM clock, MHz (default 1800)
+ *   gpu<N>_throttle  nvmlClocksThrottleReason* bits (default 0)
+ *   gpu<N>_limit     power limit at the first nvmlInit(), mW (default
+ *                    300000, the default limit; 100000-350000 accepted)
+ *   gpu<N>_lost      non-zero: every call on the GPU fails as lost
+ *   gpu<N>_delay_ms  every call on the GPU takes this long first
+ *   gpu<N>_noevents  non-zero: registering for events is not supported
+ *   fail             non-zero: every call fails as if the driver went away
+ *   count            what nvmlDeviceGetCount() reports (default the GPUs)
+ *
+ * With FAKE_NVML_EVENTS set, every GPU supports clock, Xid and power
+ * source events. The waiter delivers those listed in an "events" file,
+ * one "<gpu> clock|xid|power [data]" per line, and removes the file; it
+ * must appear whole, so write it elsewhere and rename it into place.
+ *
+ * With FAKE_NVML_TRACE set to a file, each temperature reading appends
+ * "<CLOCK_MONOTONIC seconds> gpu<N> temp" to it, and each event delivered
+ * "... gpu<N> event <kind>".
+ *
+ * Only what nvfd calls is here. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <nvml.h>
+
+#define STUB_GPUS_MAX 256
+#define STUB_FANS_MAX 8
+
+#define STUB_EVENTS_MAX 64
+
+struct nvmlDevice_st {
+    unsigned int index;
+    unsigned int fan[STUB_FANS_MAX];
+    unsigned int power_limit;   /* mW */
+    unsigned long long events;  /* registered nvmlEventType* */
+};
+
+/* One set at a time, waited on by one thread */
+struct nvmlEventSet_st {
+    nvmlEventData_t queue[STUB_EVENTS_MAX];
+    unsigned int    count;
+};
+
+static struct nvmlDevice_st devices[STUB_GPUS_MAX];
+static struct nvmlEventSet_st event_set;
+static unsigned int gpu_count = 2;
+static unsigned int fan_count = 2;
+static int initialized;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *stub_dir(void) {
+    const char *dir = getenv("FAKE_NVML_DIR");
+    return dir ? dir : ".";
+}
+
+static long read_file(const char *name, long def) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", stub_dir(), name);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return def;
+    long value;
+    if (fscanf(f, "%ld", &value) != 1)
+        value = def;
+    fclose(f);
+    return value;
+}
+
+static long read_gpu(const struct nvmlDevice_st *dev, const char *what, long def) {
+    char name[64];
+    snprintf(name, sizeof(name), "gpu%u_%s", dev->index, what);
+    return read_file(name, def);
+}
+
+static void trace(const struct nvmlDevice_st *dev, const char *call) {
+    const char *path = getenv("FAKE_NVML_TRACE");
+    if (!path)
+        return;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    pthread_mutex_lock(&trace_lock);
+    FILE *f = fopen(path, "a");
+    if (f) {
+        fprintf(f, "%ld.%06ld gpu%u %s\n", (long)ts.tv_sec, ts.tv_nsec / 1000,
+                dev->index, call);
+        fclose(f);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+/* What every per-device call goes through first */
+static nvmlReturn_t enter(nvmlDevice_t dev) {
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (!dev)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    if (read_file("fail", 0))
+        return NVML_ERROR_DRIVER_NOT_LOADED;
+    long delay_ms = read_gpu(dev, "delay_ms", 0);
+    if (delay_ms > 0)
+        usleep((useconds_t)delay_ms * 1000);
+    if (read_gpu(dev, "lost", 0))
+        return NVML_ERROR_GPU_IS_LOST;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlInit(void) {
+    const char *env = getenv("FAKE_NVML_GPUS");
+    if (env)
+        gpu_count = (unsigned int)atoi(env);
+    env = getenv("FAKE_NVML_FANS");
+    if (env)
+        fan_count = (unsigned int)atoi(env);
+    if (gpu_count > STUB_GPUS_MAX)
+        gpu_count = STUB_GPUS_MAX;
+    if (fan_count > STUB_FANS_MAX)
+        fan_count = STUB_FANS_MAX;
+    if (read_file("fail", 0))
+        return NVML_ERROR_DRIVER_NOT_LOADED;
+
+    for (unsigned int i = 0; i < STUB_GPUS_MAX; i++) {
+        devices[i].index = i;
+        if (devices[i].power_limit == 0)
+            devices[i].power_limit = (unsigned int)read_gpu(&devices[i], "limit", 300000);
+    }
+    initialized = 1;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlShutdown(void) {
+    initialized = 0;
+    return NVML_SUCCESS;
+}
+
+const char *nvmlErrorString(nvmlReturn_t result) {
+    switch (result) {
+    case NVML_SUCCESS:                return "Success";
+    case NVML_ERROR_UNINITIALIZED:    return "Uninitialized";
+    case NVML_ERROR_INVALID_ARGUMENT: return "Invalid Argument";
+    case NVML_ERROR_NOT_SUPPORTED:    return "Not Supported";
+    case NVML_ERROR_TIMEOUT:          return "Timeout";
+    case NVML_ERROR_DRIVER_NOT_LOADED:return "Driver Not Loaded";
+    case NVML_ERROR_GPU_IS_LOST:      return "GPU is lost";
+    default:                          return "Unknown Error";
+    }
+}
+
+nvmlReturn_t nvmlDeviceGetCount(unsigned int *count) {
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (read_file("fail", 0))
+        return NVML_ERROR_DRIVER_NOT_LOADED;
+    long n = read_file("count", gpu_count);
+    *count = n < 0 ? 0 : n > STUB_GPUS_MAX ? STUB_GPUS_MAX : (unsigned int)n;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex(unsigned int index, nvmlDevice_t *device) {
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    if (index >= STUB_GPUS_MAX)
+        return NVML_ERROR_INVALID_ARGUMENT;
+    *device = &devices[index];
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetName(nvmlDevice_t device, char *name, unsigned int length) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        snprintf(name, length, "Stub GPU %u", device->index);
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetUUID(nvmlDevice_t device, char *uuid, unsigned int length) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        snprintf(uuid, length, "GPU-stub-%u", device->index);
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetPciInfo(nvmlDevice_t device, nvmlPciInfo_t *pci) {
+    nvmlReturn_t r = enter(device);
+    if (r != NVML_SUCCESS)
+        return r;
+    memset(pci, 0, sizeof(*pci));
+    snprintf(pci->busId, sizeof(pci->busId), "00000000:%02X:00.0", device->index + 1);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device, nvmlTemperatureSensors_t sensor,
+                                      unsigned int *temp) {
+    (void)sensor;
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS) {
+        *temp = (unsigned int)read_gpu(device, "temp", 50);
+        trace(device, "temp");
+    }
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperatureThreshold(nvmlDevice_t device,
+                                               nvmlTemperatureThresholds_t type,
+                                               unsigned int *temp) {
+    nvmlReturn_t r = enter(device);
+    if (r != NVML_SUCCESS)
+        return r;
+    switch (type) {
+    case NVML_TEMPERATURE_THRESHOLD_SHUTDOWN: *temp = 98; break;
+    case NVML_TEMPERATURE_THRESHOLD_SLOWDOWN: *temp = 93; break;
+    case NVML_TEMPERATURE_THRESHOLD_GPU_MAX:  *temp = 88; break;
+    default:                                  return NVML_ERROR_NOT_SUPPORTED;
+    }
+    return NVML_SUCCESS;
+}
+
+/* No memory junction sensor */
+nvmlReturn_t nvmlDeviceGetFieldValues(nvmlDevice_t device, int count,
+                                      nvmlFieldValue_t *values) {
+    nvmlReturn_t r = enter(device);
+    for (int i = 0; r == NVML_SUCCESS && i < count; i++)
+        values[i].nvmlReturn = NVML_ERROR_NOT_SUPPORTED;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t *util) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS) {
+        util->gpu = (unsigned int)read_gpu(device, "util", 90);
+        util->memory = 10;
+    }
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetMemoryInfo(nvmlDevice_t device, nvmlMemory_t *memory) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS) {
+        memory->total = 24ULL << 30;
+        memory->used = 1ULL << 30;
+        memory->free = memory->total - memory->used;
+    }
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int *power) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *power = (unsigned int)read_gpu(device, "power", 150000);
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetEnforcedPowerLimit(nvmlDevice_t device, unsigned int *limit) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *limit = device->power_limit;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerManagementLimit(nvmlDevice_t device, unsigned int *limit) {
+    return nvmlDeviceGetEnforcedPowerLimit(device, limit);
+}
+
+nvmlReturn_t nvmlDeviceGetPowerManagementDefaultLimit(nvmlDevice_t device,
+                                                      unsigned int *limit) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *limit = 300000;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerManagementLimitConstraints(nvmlDevice_t device,
+                                                          unsigned int *min_limit,
+                                                          unsigned int *max_limit) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS) {
+        *min_limit = 100000;
+        *max_limit = 350000;
+    }
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceSetPowerManagementLimit(nvmlDevice_t device, unsigned int limit) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        device->power_limit = limit;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceSetPersistenceMode(nvmlDevice_t device, nvmlEnableState_t mode) {
+    (void)mode;
+    return enter(device);
+}
+
+nvmlReturn_t nvmlDeviceGetNumFans(nvmlDevice_t device, unsigned int *count) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *count = fan_count;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetMinMaxFanSpeed(nvmlDevice_t device, unsigned int *min_speed,
+                                         unsigned int *max_speed) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS) {
+        *min_speed = 30;
+        *max_speed = 100;
+    }
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetFanSpeed_v2(nvmlDevice_t device, unsigned int fan,
+                                      unsigned int *speed) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS && fan >= fan_count)
+        r = NVML_ERROR_INVALID_ARGUMENT;
+    if (r == NVML_SUCCESS)
+        *speed = device->fan[fan];
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceSetFanSpeed_v2(nvmlDevice_t device, unsigned int fan,
+                                      unsigned int speed) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS && fan >= fan_count)
+        r = NVML_ERROR_INVALID_ARGUMENT;
+    if (r == NVML_SUCCESS)
+        device->fan[fan] = speed;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceSetDefaultFanSpeed_v2(nvmlDevice_t device, unsigned int fan) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS && fan >= fan_count)
+        r = NVML_ERROR_INVALID_ARGUMENT;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceSetFanControlPolicy(nvmlDevice_t device, unsigned int fan,
+                                           nvmlFanControlPolicy_t policy) {
+    (void)fan;
+    (void)policy;
+    return enter(device);
+}
+
+nvmlReturn_t nvmlDeviceGetClockInfo(nvmlDevice_t device, nvmlClockType_t type,
+                                    unsigned int *clock) {
+    (void)type;
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *clock = (unsigned int)read_gpu(device, "clock", 1800);
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetCurrentClocksThrottleReasons(nvmlDevice_t device,
+                                                       unsigned long long *reasons) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *reasons = (unsigned long long)read_gpu(device, "throttle", 0);
+    return r;
+}
+
+/* No processes on any GPU */
+nvmlReturn_t nvmlDeviceGetComputeRunningProcesses(nvmlDevice_t device, unsigned int *count,
+                                                  nvmlProcessInfo_t *infos) {
+    (void)infos;
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *count = 0;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceGetGraphicsRunningProcesses(nvmlDevice_t device, unsigned int *count,
+                                                   nvmlProcessInfo_t *infos) {
+    return nvmlDeviceGetComputeRunningProcesses(device, count, infos);
+}
+
+/* Events, with FAKE_NVML_EVENTS set */
+static unsigned long long event_type(const char *kind) {
+    if (strcmp(kind, "clock") == 0)
+        return nvmlEventTypeClock;
+    if (strcmp(kind, "xid") == 0)
+        return nvmlEventTypeXidCriticalError;
+    if (strcmp(kind, "power") == 0)
+        return nvmlEventTypePowerSourceChange;
+    return 0;
+}
+
+static const char *event_kind(unsigned long long type) {
+    return type == nvmlEventTypeClock ? "event clock"
+         : type == nvmlEventTypeXidCriticalError ? "event xid" : "event power";
+}
+
+nvmlReturn_t nvmlEventSetCreate(nvmlEventSet_t *set) {
+    if (!initialized)
+        return NVML_ERROR_UNINITIALIZED;
+    *set = &event_set;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlEventSetFree(nvmlEventSet_t set) {
+    (void)set;
+    for (unsigned int i = 0; i < STUB_GPUS_MAX; i++)
+        devices[i].events = 0;
+    event_set.count = 0;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetSupportedEventTypes(nvmlDevice_t device,
+                                              unsigned long long *types) {
+    nvmlReturn_t r = enter(device);
+    if (r == NVML_SUCCESS)
+        *types = getenv("FAKE_NVML_EVENTS")
+                 ? nvmlEventTypeClock | nvmlEventTypeXidCriticalError |
+                   nvmlEventTypePowerSourceChange
+                 : 0;
+    return r;
+}
+
+nvmlReturn_t nvmlDeviceRegisterEvents(nvmlDevice_t device, unsigned long long types,
+                                      nvmlEventSet_t set) {
+    (void)set;
+    nvmlReturn_t r = enter(device);
+    if (r != NVML_SUCCESS)
+        return r;
+    if (!getenv("FAKE_NVML_EVENTS") || read_gpu(device, "noevents", 0))
+        return NVML_ERROR_NOT_SUPPORTED;
+    device->events |= types;
+    return NVML_SUCCESS;
+}
+
+/* Takes the events file whole, queueing what registered GPUs listen for */
+static void take_events(struct nvmlEventSet_st *set) {
+    char path[512], taken[512];
+    snprintf(path, sizeof(path), "%s/events", stub_dir());
+    snprintf(taken, sizeof(taken), "%s/events.taken", stub_dir());
+    if (rename(path, taken) != 0)
+        return;
+    FILE *f = fopen(taken, "r");
+    if (!f)
+        return;
+
+    char line[128], kind[16];
+    unsigned int gpu;
+    unsigned long long data;
+    while (fgets(line, sizeof(line), f)) {
+        data = 0;
+        if (sscanf(line, "%u %15s %llu", &gpu, kind, &data) < 2 || gpu >= gpu_count)
+            continue;
+        unsigned long long type = event_type(kind);
+        if (!(devices[gpu].events & type) || set->count == STUB_EVENTS_MAX)
+            continue;
+        nvmlEventData_t *ev = &set->queue[set->count++];
+        memset(ev, 0, sizeof(*ev));
+        ev->device = &devices[gpu];
+        ev->eventType = type;
+        ev->eventData = data;
+    }
+    fclose(f);
+    unlink(taken);
+}
+
+nvmlReturn_t nvmlEventSetWait_v2(nvmlEventSet_t set, nvmlEventData_t *data,
+                                 unsigned int timeout_ms) {
+    for (unsigned int waited = 0;; waited += 10) {
+        if (!initialized)
+            return NVML_ERROR_UNINITIALIZED;
+        if (read_file("fail", 0))
+            return NVML_ERROR_DRIVER_NOT_LOADED;
+        take_events(set);
+        if (set->count > 0) {
+            *data = set->queue[0];
+            set->count--;
+            memmove(set->queue, set->queue + 1, set->count * sizeof(set->queue[0]));
+            trace(data->device, event_kind(data->eventType));
+            return NVML_SUCCESS;
+        }
+        if (waited >= timeout_ms)
+            return NVML_ERROR_TIMEOUT;
+        usleep(10000);
+    }
+}
@@ -0,0 +1,60 @@
+/* Node-wide fan budget */
+#include "check.h"
+#include "budget.h"
+
+static int total(const BudgetDemand *d, unsigned int count) {
+    int sum = 0;
+    for (unsigned int i = 0; i < count; i++)
+        sum += d[i].grant;
+    return sum;
+}
+
+/* Enough for everyone: everyone gets what they asked */
+static void test_enough(void) {
+    BudgetDemand d[] = { { 100, 30, 5, 0 }, { 80, 30, 20, 0 }, { 60, 30, 10, 0 } };
+    budget_allocate(d, 3, 300);
+    CHECK_INT(d[0].grant, 100);
+    CHECK_INT(d[1].grant, 80);
+    CHECK_INT(d[2].grant, 60);
+}
+
+/* Short: the least headroom is served first, the coolest get the rest */
+static void test_short(void) {
+    BudgetDemand d[] = { { 100, 30, 5, 0 }, { 100, 30, 20, 0 }, { 100, 30, 10, 0 } };
+    budget_allocate(d, 3, 200);
+    CHECK_INT(d[0].grant, 100);
+    CHECK_INT(d[2].grant, 70);
+    CHECK_INT(d[1].grant, 30);
+    CHECK_INT(total(d, 3), 200);
+}
+
+/* Floors hold even when they alone exceed the budget */
+static void test_floors(void) {
+    BudgetDemand d[] = { { 100, 60, 5, 0 }, { 100, 100, -3, 0 }, { 50, 20, 30, 0 } };
+    budget_allocate(d, 3, 120);
+    CHECK_INT(d[0].grant, 60);
+    CHECK_INT(d[1].grant, 100);
+    CHECK_INT(d[2].grant, 20);
+}
+
+/* Each fan keeps its floor and gives up its share above it */
+static void test_share(void) {
+    BudgetDemand d = { 100, 30, 5, 70 };
+    int a = budget_share(&d, 50, 15);
+    int b = budget_share(&d, 50, 15);
+    CHECK_INT(a, 35);
+    CHECK_INT(a + b, 70);
+    CHECK_INT(budget_share(&d, 15, 15), 15);
+    CHECK_INT(budget_share(&d, 10, 15), 10);
+
+    d.grant = d.want;
+    CHECK_INT(budget_share(&d, 50, 15), 50);
+}
+
+int main(void) {
+    test_enough();
+    test_short();
+    test_floors();
+    test_share();
+    return check_done("budget");
+}
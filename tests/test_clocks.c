@@ -0,0 +1,144 @@
+/* Clock-aware setpoint: learning where boost bins start to drop */
+#include <nvml.h>
+#include "check.h"
+#include "clocks.h"
+#include "nvfd.h"
+
+#define TARGET 80
+#define PEAK 1800
+#define THERMAL nvmlClocksThrottleReasonSwThermalSlowdown
+
+static void params(ClockParams *p) {
+    clock_defaults(p, TARGET);
+}
+
+/* count busy samples; returns the last setpoint */
+static int feed(ClockLearner *c, const ClockParams *p, int count, int temp, int mhz,
+                unsigned long long reasons) {
+    int setpoint = -1;
+    for (int i = 0; i < count; i++)
+        setpoint = clock_update(c, p, TARGET, temp, mhz, reasons, 95);
+    return setpoint;
+}
+
+static void test_defaults(void) {
+    ClockParams p;
+    clock_defaults(&p, 80);
+    CHECK_INT(p.floor, 80 - NVFD_CLOCK_FLOOR_SPAN);
+    CHECK_INT(p.margin, NVFD_CLOCK_MARGIN_DEFAULT);
+    clock_defaults(&p, NVFD_TARGET_MIN + 1);
+    CHECK_INT(p.floor, NVFD_TARGET_MIN);
+
+    CHECK(clock_thermal(nvmlClocksThrottleReasonHwThermalSlowdown));
+    CHECK(clock_thermal(THERMAL));
+    CHECK(!clock_thermal(nvmlClocksThrottleReasonSwPowerCap));
+    CHECK(clock_power(nvmlClocksThrottleReasonSwPowerCap));
+    CHECK(!clock_power(THERMAL));
+}
+
+/* Bins lost at or below the knee walk it down, a step per sample; full
+ * clocks above it walk it back up, never past target */
+static void test_knee(void) {
+    ClockParams p;
+    ClockLearner c;
+    params(&p);
+    clock_reset(&c);
+
+    CHECK_INT(feed(&c, &p, 1, 70, PEAK, 0), TARGET);
+    CHECK_INT(c.peak_mhz, PEAK);
+    /* Within a bin of the peak is not a loss */
+    CHECK_INT(feed(&c, &p, 10, 78, PEAK - NVFD_CLOCK_BIN_MHZ, 0), TARGET);
+
+    int steps = (int)(2.0 / NVFD_CLOCK_KNEE_STEP);
+    CHECK_INT(feed(&c, &p, steps, 78, PEAK - 2 * NVFD_CLOCK_BIN_MHZ, 0), TARGET - 2);
+
+    /* Lost above the knee says nothing new */
+    CHECK_INT(feed(&c, &p, 10, 85, PEAK - 2 * NVFD_CLOCK_BIN_MHZ, 0), TARGET - 2);
+
+    CHECK_INT(feed(&c, &p, steps, 85, PEAK, 0), TARGET);
+    CHECK_INT(feed(&c, &p, 50, 85, PEAK, 0), TARGET);
+}
+
+/* However often clocks are lost, the setpoint stays at the floor */
+static void test_floor(void) {
+    ClockParams p;
+    ClockLearner c;
+    params(&p);
+    clock_reset(&c);
+
+    CHECK_INT(feed(&c, &p, 500, 50, PEAK, THERMAL), p.floor);
+    CHECK(c.knee == p.floor + p.margin);
+}
+
+/* Idle, lightly loaded or power-capped samples teach nothing */
+static void test_ignored(void) {
+    ClockParams p;
+    ClockLearner c;
+    params(&p);
+    clock_reset(&c);
+
+    feed(&c, &p, 1, 70, PEAK, 0);
+    for (int i = 0; i < 50; i++) {
+        clock_update(&c, &p, TARGET, 70, 900, nvmlClocksThrottleReasonGpuIdle, 95);
+        clock_update(&c, &p, TARGET, 70, 900, 0, NVFD_CLOCK_BUSY_UTIL - 1);
+        clock_update(&c, &p, TARGET, 70, 900, nvmlClocksThrottleReasonSwPowerCap, 95);
+        clock_update(&c, &p, TARGET, 70, -1, 0, 95);
+    }
+    CHECK(c.knee == TARGET + p.margin);
+    CHECK_INT(c.peak_mhz, PEAK);
+    /* Unknown utilization counts as busy */
+    clock_update(&c, &p, TARGET, 70, PEAK + 100, 0, -1);
+    CHECK_INT(c.peak_mhz, PEAK + 100);
+}
+
+/* Clocks held at a lower level, with no thermal slowdown, were not lost to
+ * heat: after NVFD_CLOCK_PLATEAU_SAMPLES that level is the peak and the
+ * knee starts over from target */
+static void test_plateau(void) {
+    ClockParams p;
+    ClockLearner c;
+    params(&p);
+    clock_reset(&c);
+
+    feed(&c, &p, 1, 70, PEAK, 0);
+    CHECK_INT(feed(&c, &p, NVFD_CLOCK_PLATEAU_SAMPLES - 1, 60, 1500, 0), p.floor);
+    CHECK_INT(c.peak_mhz, PEAK);
+    CHECK_INT(feed(&c, &p, 1, 60, 1500 + NVFD_CLOCK_BIN_MHZ, 0), TARGET);
+    CHECK_INT(c.peak_mhz, 1500 + NVFD_CLOCK_BIN_MHZ);
+
+    /* From the new peak, losses count again */
+    CHECK_INT(feed(&c, &p, 4, 78, 1400, 0), TARGET - 1);
+}
+
+/* A thermal slowdown or a return to the peak breaks the run */
+static void test_plateau_broken(void) {
+    ClockParams p;
+    ClockLearner c;
+    params(&p);
+    clock_reset(&c);
+
+    feed(&c, &p, 1, 70, PEAK, 0);
+    feed(&c, &p, NVFD_CLOCK_PLATEAU_SAMPLES - 1, 70, 1500, 0);
+    feed(&c, &p, 1, 70, 1500, THERMAL);
+    feed(&c, &p, NVFD_CLOCK_PLATEAU_SAMPLES - 1, 70, 1500, 0);
+    CHECK_INT(c.peak_mhz, PEAK);
+
+    feed(&c, &p, 1, 70, PEAK, 0);
+    feed(&c, &p, NVFD_CLOCK_PLATEAU_SAMPLES - 1, 70, 1500, 0);
+    CHECK_INT(c.peak_mhz, PEAK);
+
+    /* A level that wanders by more than a bin is no plateau either */
+    for (int i = 0; i < 2 * NVFD_CLOCK_PLATEAU_SAMPLES; i++)
+        feed(&c, &p, 1, 70, i % 2 ? 1500 : 1500 + 2 * NVFD_CLOCK_BIN_MHZ, 0);
+    CHECK_INT(c.peak_mhz, PEAK);
+}
+
+int main(void) {
+    test_defaults();
+    test_knee();
+    test_floor();
+    test_ignored();
+    test_plateau();
+    test_plateau_broken();
+    return check_done("clocks");
+}
@@ -0,0 +1,133 @@
+/* Fan curves compiled into per-degree tables, and their falling edge */
+#include "check.h"
+#include "curve.h"
+
+static void make_curve(FanCurve *curve, CurveInterpolation mode) {
+    curve_init(curve);
+    curve->interpolation = mode;
+    curve_set_point(curve, 40, 30);
+    curve_set_point(curve, 60, 50);
+    curve_set_point(curve, 75, 60);
+    curve_set_point(curve, 80, 80);
+}
+
+/* The table holds what interpolating the points gives, degree by degree */
+static void test_compile(void) {
+    CurveInterpolation modes[] = { CURVE_LINEAR, CURVE_MONOTONE_CUBIC, CURVE_STEP };
+    FanCurve curve;
+    CurveTable table;
+
+    for (unsigned int m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        make_curve(&curve, modes[m]);
+        curve_compile(&curve, &table);
+        int same = 1;
+        for (int t = CURVE_TEMP_MIN; t <= CURVE_TEMP_MAX; t++)
+            same &= curve_lookup(&table, t) == curve_interpolate(t, &curve);
+        CHECK(same);
+        curve_free(&curve);
+    }
+
+    make_curve(&curve, CURVE_LINEAR);
+    curve_compile(&curve, &table);
+    CHECK_INT(curve_lookup(&table, 40), 30);
+    CHECK_INT(curve_lookup(&table, 50), 40);
+    CHECK_INT(curve_lookup(&table, 80), 80);
+    curve_free(&curve);
+}
+
+/* Readings outside the table clamp to its ends */
+static void test_clamp(void) {
+    FanCurve curve;
+    CurveTable table;
+
+    make_curve(&curve, CURVE_LINEAR);
+    curve_compile(&curve, &table);
+    CHECK_INT(curve_lookup(&table, -20), curve_lookup(&table, CURVE_TEMP_MIN));
+    CHECK_INT(curve_lookup(&table, 500), curve_lookup(&table, CURVE_TEMP_MAX));
+    CHECK_INT(curve_lookup(&table, 500), 80);
+    curve_free(&curve);
+}
+
+/* No curve, or one without points, is the built-in curve */
+static void test_builtin(void) {
+    FanCurve empty;
+    CurveTable builtin, table;
+
+    curve_init(&empty);
+    curve_compile(NULL, &builtin);
+    curve_compile(&empty, &table);
+    int same = 1;
+    for (int t = CURVE_TEMP_MIN; t <= CURVE_TEMP_MAX; t++)
+        same &= curve_lookup(&table, t) == curve_lookup(&builtin, t) &&
+                curve_lookup(&builtin, t) == curve_default_interpolate(t);
+    CHECK(same);
+    CHECK_INT(builtin.hysteresis, 0);
+    CHECK(builtin.hold_s == 0.0);
+}
+
+static void test_batch(void) {
+    FanCurve a, b;
+    CurveTable ta, tb;
+    make_curve(&a, CURVE_LINEAR);
+    make_curve(&b, CURVE_STEP);
+    curve_compile(&a, &ta);
+    curve_compile(&b, &tb);
+
+    const CurveTable *tables[] = { &ta, &tb, &ta, &tb };
+    int temps[] = { 50, 50, 200, -5 };
+    unsigned int speeds[4];
+    curve_lookup_batch(tables, temps, speeds, 4);
+    for (int i = 0; i < 4; i++)
+        CHECK_INT(speeds[i], curve_lookup(tables[i], temps[i]));
+
+    curve_free(&a);
+    curve_free(&b);
+}
+
+/* Rises follow at once; falls wait out hold_s, then lag by hysteresis */
+static void test_hold(void) {
+    FanCurve curve;
+    CurveTable table;
+    CurveState s;
+
+    make_curve(&curve, CURVE_LINEAR);
+    curve.hysteresis = 5;
+    curve.hold_s = 10.0;
+    curve_compile(&curve, &table);
+    CHECK_INT(table.hysteresis, 5);
+    CHECK(table.hold_s == 10.0);
+
+    curve_state_reset(&s);
+    CHECK_INT(curve_eval(&table, &s, 60, 0.0), 50);
+    CHECK_INT(curve_eval(&table, &s, 50, 5.0), 50);
+    /* Past the hold, 58 °C reads as 63 °C, which still wants more than 50 */
+    CHECK_INT(curve_eval(&table, &s, 58, 11.0), 50);
+    CHECK_INT(curve_eval(&table, &s, 50, 12.0), curve_lookup(&table, 55));
+    /* A rise restarts the hold */
+    CHECK_INT(curve_eval(&table, &s, 70, 13.0), curve_lookup(&table, 70));
+    CHECK_INT(curve_eval(&table, &s, 40, 20.0), curve_lookup(&table, 70));
+    CHECK_INT(curve_eval(&table, &s, 40, 23.0), curve_lookup(&table, 45));
+
+    /* curve_hold takes the speed from a batch lookup */
+    curve_state_reset(&s);
+    CHECK_INT(curve_hold(&table, &s, curve_lookup(&table, 80), 80, 0.0), 80);
+    CHECK_INT(curve_hold(&table, &s, curve_lookup(&table, 40), 40, 1.0), 80);
+    curve_free(&curve);
+
+    /* Without hysteresis or hold, falls follow the curve too */
+    make_curve(&curve, CURVE_LINEAR);
+    curve_compile(&curve, &table);
+    curve_state_reset(&s);
+    CHECK_INT(curve_eval(&table, &s, 80, 0.0), 80);
+    CHECK_INT(curve_eval(&table, &s, 60, 0.1), 50);
+    curve_free(&curve);
+}
+
+int main(void) {
+    test_compile();
+    test_clamp();
+    test_builtin();
+    test_batch();
+    test_hold();
+    return check_done("curve");
+}
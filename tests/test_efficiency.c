@@ -0,0 +1,152 @@
+/* Efficiency mode: perturb and observe on board plus fan power */
+#include "check.h"
+#include "efficiency.h"
+
+#define CURVE 50
+#define LO    20
+#define HI   100
+
+/* A board whose leakage climbs steeply below 40 % fan, so board plus fan
+ * power is lowest there */
+static int board_mw(int speed) {
+    return 200000 + (speed < 40 ? (40 - speed) * 300 : 0);
+}
+
+static void params(EfficiencyParams *p) {
+    eff_defaults(p);
+    p->fan_watts = 10.0;
+    p->step = 5;
+    p->dwell_s = 10.0;
+}
+
+/* Runs seconds of 1 s samples at temp and util; returns the last speed */
+static int run(Efficiency *e, const EfficiencyParams *p, int temp, int util,
+               int seconds, double *now, int speed) {
+    for (int i = 0; i < seconds; i++) {
+        speed = eff_update(e, p, 83, temp, board_mw(speed), util, 2, CURVE, LO, HI,
+                           1.0, *now);
+        *now += 1.0;
+    }
+    return speed;
+}
+
+/* One dwell on the curve to measure it, then a step quieter */
+static void test_first_dwell(void) {
+    EfficiencyParams p;
+    Efficiency e;
+    double now = 0.0;
+
+    params(&p);
+    eff_reset(&e);
+    CHECK_INT(run(&e, &p, 60, 90, 10, &now, CURVE), CURVE);
+    CHECK(!e.searching);
+    CHECK_INT(run(&e, &p, 60, 90, 1, &now, CURVE), CURVE - 5);
+    CHECK(e.searching);
+    CHECK_INT(e.curve_speed, CURVE);
+    CHECK(e.curve_w > 202.0 && e.curve_w < 203.0);
+}
+
+/* Downhill it keeps going; past the minimum the total rises and it turns
+ * round, then dithers about the minimum */
+static void test_search(void) {
+    EfficiencyParams p;
+    Efficiency e;
+    double now = 0.0;
+    int speed = CURVE;
+
+    params(&p);
+    eff_reset(&e);
+    speed = run(&e, &p, 60, 90, 11, &now, speed);
+    speed = run(&e, &p, 60, 90, 11, &now, speed);
+    CHECK_INT(speed, 40);
+    CHECK_INT(e.dir, -1);
+    speed = run(&e, &p, 60, 90, 11, &now, speed);
+    CHECK_INT(speed, 35);
+    /* 35 % costs more than 40 %: back up */
+    speed = run(&e, &p, 60, 90, 11, &now, speed);
+    CHECK_INT(speed, 40);
+    CHECK_INT(e.dir, 1);
+
+    int lowest = speed, highest = speed;
+    for (int i = 0; i < 20; i++) {
+        speed = run(&e, &p, 60, 90, 11, &now, speed);
+        lowest = speed < lowest ? speed : lowest;
+        highest = speed > highest ? speed : highest;
+    }
+    CHECK(lowest >= 35 && highest <= 45);
+    CHECK(e.saved_j > 0.0);
+}
+
+/* Power that only rises with speed drives it to the bottom of the range,
+ * where it turns round instead of leaving it */
+static void test_bounds(void) {
+    EfficiencyParams p;
+    Efficiency e;
+    double now = 0.0;
+    int speed = CURVE;
+
+    params(&p);
+    eff_reset(&e);
+    for (int i = 0; i < 40; i++) {
+        for (int s = 0; s < 11; s++, now += 1.0)
+            speed = eff_update(&e, &p, 83, 60, 200000, 90, 2, CURVE, 30, HI, 1.0, now);
+        CHECK(speed >= 30);
+    }
+    CHECK(speed <= 40);
+}
+
+/* Too hot: at least the curve's speed again */
+static void test_too_hot(void) {
+    EfficiencyParams p;
+    Efficiency e;
+    double now = 0.0;
+    int speed = CURVE;
+
+    params(&p);
+    eff_reset(&e);
+    speed = run(&e, &p, 60, 90, 22, &now, speed);
+    CHECK(speed < CURVE);
+    speed = run(&e, &p, 83, 90, 1, &now, speed);
+    CHECK(speed >= CURVE);
+    CHECK_INT(e.dir, 1);
+}
+
+/* A change of load starts over from the curve */
+static void test_load_change(void) {
+    EfficiencyParams p;
+    Efficiency e;
+    double now = 0.0;
+    int speed = CURVE;
+
+    params(&p);
+    eff_reset(&e);
+    speed = run(&e, &p, 60, 90, 22, &now, speed);
+    CHECK(e.searching);
+    speed = run(&e, &p, 60, 40, 1, &now, speed);
+    CHECK_INT(speed, CURVE);
+    CHECK(!e.searching);
+    CHECK_INT(e.restarts, 1);
+}
+
+/* No power reading: the curve, clamped to the allowed speeds */
+static void test_no_power(void) {
+    EfficiencyParams p;
+    Efficiency e;
+
+    params(&p);
+    eff_reset(&e);
+    CHECK_INT(eff_update(&e, &p, 83, 60, -1, 90, 2, CURVE, LO, HI, 1.0, 0.0), CURVE);
+    CHECK_INT(eff_update(&e, &p, 83, 60, -1, 90, 2, 10, LO, HI, 1.0, 1.0), LO);
+    CHECK_INT(eff_update(&e, &p, 83, 60, -1, 90, 2, CURVE, LO, 45, 1.0, 2.0), 45);
+    CHECK(!e.primed);
+}
+
+int main(void) {
+    test_first_dwell();
+    test_search();
+    test_bounds();
+    test_too_hot();
+    test_load_change();
+    test_no_power();
+    return check_done("efficiency");
+}
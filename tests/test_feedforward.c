@@ -0,0 +1,130 @@
+/* Load feed-forward: a boost on a rise in power or utilization that fades
+ * as the baseline catches up */
+#include <math.h>
+#include "check.h"
+#include "feedforward.h"
+
+#define CLOSE(a, b) (fabs((a) - (b)) < 0.01)
+
+static void params(FeedForwardParams *p) {
+    ff_defaults(p);
+    p->power_gain = 0.5;
+    p->util_gain = 0.0;
+    p->tau_s = 10.0;
+    p->max = 100.0;
+}
+
+static void test_enabled(void) {
+    FeedForwardParams p;
+    ff_defaults(&p);
+    CHECK(!ff_enabled(&p));
+    p.util_gain = 0.2;
+    CHECK(ff_enabled(&p));
+}
+
+/* Taking over at full load is no rise */
+static void test_takeover(void) {
+    FeedForwardParams p;
+    FeedForward ff;
+    params(&p);
+    ff_reset(&ff);
+    CHECK(ff_update(&ff, &p, 95.0, 100.0, 1.0) == 0.0);
+}
+
+/* A step in power gives gain * rise at once, then fades with the baseline
+ * as exp(-t / tau) */
+static void test_step_decay(void) {
+    FeedForwardParams p;
+    FeedForward ff;
+    params(&p);
+    ff_reset(&ff);
+
+    ff_update(&ff, &p, 40.0, -1.0, 1.0);
+    double boost = ff_update(&ff, &p, 90.0, -1.0, 1.0);
+    CHECK(CLOSE(boost, 25.0));
+
+    double last = boost;
+    int falling = 1;
+    for (int i = 1; i <= 10; i++) {
+        boost = ff_update(&ff, &p, 90.0, -1.0, 1.0);
+        falling &= boost < last;
+        last = boost;
+    }
+    CHECK(falling);
+    /* 25 * (10 / 11)^10 */
+    CHECK(CLOSE(boost, 25.0 * pow(10.0 / 11.0, 10)));
+    for (int i = 0; i < 100; i++)
+        boost = ff_update(&ff, &p, 90.0, -1.0, 1.0);
+    CHECK(boost < 0.01);
+
+    /* Load falling away never takes fan away */
+    CHECK(ff_update(&ff, &p, 30.0, -1.0, 1.0) == 0.0);
+}
+
+/* Power and utilization add up, under the cap */
+static void test_sum_and_cap(void) {
+    FeedForwardParams p;
+    FeedForward ff;
+    params(&p);
+    p.util_gain = 0.2;
+    ff_reset(&ff);
+
+    ff_update(&ff, &p, 40.0, 20.0, 1.0);
+    CHECK(CLOSE(ff_update(&ff, &p, 60.0, 70.0, 1.0), 0.5 * 20.0 + 0.2 * 50.0));
+
+    p.max = 5.0;
+    ff_reset(&ff);
+    ff_update(&ff, &p, 40.0, 20.0, 1.0);
+    CHECK(ff_update(&ff, &p, 100.0, 100.0, 1.0) == 5.0);
+    CHECK(ff.boost == 5.0);
+}
+
+/* A missing reading adds nothing, and when it returns the baseline starts
+ * from it again */
+static void test_missing(void) {
+    FeedForwardParams p;
+    FeedForward ff;
+    params(&p);
+    ff_reset(&ff);
+
+    ff_update(&ff, &p, 40.0, -1.0, 1.0);
+    CHECK(ff_update(&ff, &p, -1.0, -1.0, 1.0) == 0.0);
+    CHECK(ff.power_base < 0.0);
+    CHECK(ff_update(&ff, &p, 90.0, -1.0, 1.0) == 0.0);
+}
+
+/* Without a time constant the baseline jumps to the input: one sample */
+static void test_no_tau(void) {
+    FeedForwardParams p;
+    FeedForward ff;
+    params(&p);
+    p.tau_s = 0.0;
+    ff_reset(&ff);
+
+    ff_update(&ff, &p, 40.0, -1.0, 1.0);
+    CHECK(CLOSE(ff_update(&ff, &p, 90.0, -1.0, 1.0), 25.0));
+    CHECK(ff_update(&ff, &p, 90.0, -1.0, 1.0) == 0.0);
+}
+
+/* A reset forgets the baseline, so the next sample is a takeover */
+static void test_reset(void) {
+    FeedForwardParams p;
+    FeedForward ff;
+    params(&p);
+    ff_reset(&ff);
+
+    ff_update(&ff, &p, 40.0, -1.0, 1.0);
+    ff_reset(&ff);
+    CHECK(ff_update(&ff, &p, 90.0, -1.0, 1.0) == 0.0);
+}
+
+int main(void) {
+    test_enabled();
+    test_takeover();
+    test_step_decay();
+    test_sum_and_cap();
+    test_missing();
+    test_no_tau();
+    test_reset();
+    return check_done("feedforward");
+}
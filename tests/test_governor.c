@@ -0,0 +1,177 @@
+/* Thermal governor: power limit steps once the fans are at their ceiling */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "check.h"
+#include "governor.h"
+#include "gpu.h"
+
+static void params(GovernorParams *p) {
+    gov_defaults(p);
+    p->temp = 85;
+    p->step = 5;
+    p->floor = 60;
+    p->interval_s = 5.0;
+    p->hysteresis = 3;
+}
+
+/* Each cut is step % of the original limit, at most one per interval, and
+ * only while the fans are at their ceiling and the GPU at temp */
+static void test_cut(void) {
+    GovernorParams p;
+    Governor g = { 0 };
+
+    params(&p);
+    CHECK_INT(gov_update(&g, &p, 84, 1, 300000, 100000, 0.0), 0);
+    CHECK_INT(gov_update(&g, &p, 95, 0, 300000, 100000, 0.0), 0);
+    CHECK_INT(gov_update(&g, &p, 85, 1, 300000, 100000, 0.0), 285000);
+    CHECK_INT(gov_update(&g, &p, 90, 1, 300000, 100000, 4.9), 285000);
+    CHECK_INT(gov_update(&g, &p, 90, 1, 300000, 100000, 5.0), 270000);
+    CHECK_INT(gov_update(&g, &p, 90, 0, 300000, 100000, 10.0), 270000);
+    CHECK_INT(g.cuts, 2);
+}
+
+/* No lower than floor % of the original, nor than the driver accepts */
+static void test_floor(void) {
+    GovernorParams p;
+    Governor g = { 0 };
+    double now = 0.0;
+
+    params(&p);
+    for (int i = 0; i < 20; i++, now += p.interval_s)
+        gov_update(&g, &p, 95, 1, 300000, 100000, now);
+    CHECK_INT(g.limit, 180000);
+    CHECK_INT(g.cuts, 8);
+
+    Governor h = { 0 };
+    for (int i = 0; i < 20; i++, now += p.interval_s)
+        gov_update(&h, &p, 95, 1, 300000, 200000, now);
+    CHECK_INT(h.limit, 200000);
+
+    /* A step past the floor stops at it */
+    Governor k = { 0 };
+    p.step = 30;
+    p.floor = 50;
+    gov_update(&k, &p, 95, 1, 300000, 100000, 0.0);
+    CHECK_INT(gov_update(&k, &p, 95, 1, 300000, 100000, 5.0), 150000);
+}
+
+/* Back up in the same steps once hysteresis below temp, then the original */
+static void test_restore(void) {
+    GovernorParams p;
+    Governor g = { 0 };
+
+    params(&p);
+    gov_update(&g, &p, 90, 1, 300000, 100000, 0.0);
+    gov_update(&g, &p, 90, 1, 300000, 100000, 5.0);
+    CHECK_INT(gov_update(&g, &p, 83, 0, 300000, 100000, 10.0), 270000);
+    CHECK_INT(gov_update(&g, &p, 82, 0, 300000, 100000, 10.0), 285000);
+    CHECK_INT(gov_update(&g, &p, 70, 0, 300000, 100000, 14.9), 285000);
+    CHECK_INT(gov_update(&g, &p, 70, 0, 300000, 100000, 15.0), 0);
+    CHECK_INT(g.restores, 2);
+    CHECK_INT(gov_update(&g, &p, 70, 0, 300000, 100000, 20.0), 0);
+    CHECK_INT(g.restores, 2);
+}
+
+/* Off, refused by the driver, or no adjustable limit: the original */
+static void test_off(void) {
+    GovernorParams p;
+    Governor g = { 0 };
+
+    params(&p);
+    p.temp = 0;
+    CHECK(!gov_enabled(&p));
+    CHECK_INT(gov_update(&g, &p, 95, 1, 300000, 100000, 0.0), 0);
+
+    params(&p);
+    CHECK_INT(gov_update(&g, &p, 95, 1, 0, 0, 0.0), 0);
+
+    gov_update(&g, &p, 95, 1, 300000, 100000, 0.0);
+    g.applied = g.limit;
+    g.failed = 1;
+    CHECK_INT(gov_update(&g, &p, 95, 1, 300000, 100000, 10.0), 0);
+
+    /* A reload forgets the failure and goes on from what is applied */
+    gov_reset(&g);
+    CHECK_INT(g.failed, 0);
+    CHECK_INT(g.limit, 285000);
+    CHECK_INT(g.cuts, 1);
+    CHECK_INT(gov_update(&g, &p, 95, 1, 300000, 100000, 20.0), 270000);
+}
+
+/* An admin capped a 300 W card at 250 W: the governor steps down from the
+ * cap and back up to it, never past it */
+static void test_below_default(void) {
+    GovernorParams p;
+    Governor g = { 0 };
+    int orig = 250000, highest = 0;
+    double now = 0.0;
+
+    params(&p);
+    for (int i = 0; i < 20; i++, now += p.interval_s) {
+        int limit = gov_update(&g, &p, 90, 1, orig, 100000, now);
+        if (limit > highest)
+            highest = limit;
+    }
+    CHECK_INT(gov_update(&g, &p, 90, 1, orig, 100000, now), 150000);
+    for (int i = 0; i < 20; i++, now += p.interval_s) {
+        int limit = gov_update(&g, &p, 70, 0, orig, 100000, now);
+        if (limit > highest)
+            highest = limit;
+    }
+    CHECK(highest <= orig);
+    CHECK(highest > 0);
+    CHECK_INT(g.limit, 0);
+}
+
+static void write_limit(const char *dir, unsigned int gpu, int mw) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/gpu%u_limit", dir, gpu);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fprintf(f, "%d\n", mw);
+        fclose(f);
+    }
+}
+
+/* The limit to govern from is the one in force, no higher than the
+ * default; the stub's default is 300 W */
+static void test_probe(void) {
+    char dir[] = "/tmp/nvfd-governor.XXXXXX";
+    if (!mkdtemp(dir)) {
+        CHECK(!"mkdtemp");
+        return;
+    }
+    setenv("FAKE_NVML_DIR", dir, 1);
+    setenv("FAKE_NVML_GPUS", "3", 1);
+    write_limit(dir, 0, 250000);
+    write_limit(dir, 2, 320000);
+
+    CHECK_INT(gpu_init(), 0);
+    CHECK_INT(device_count, 3);
+    if (device_count == 3) {
+        CHECK_INT(gpu_device(0)->power_orig, 250000);
+        CHECK_INT(gpu_device(0)->power_default, 300000);
+        CHECK_INT(gpu_device(1)->power_orig, 300000);
+        CHECK_INT(gpu_device(2)->power_orig, 300000);
+        CHECK_INT(gpu_device(2)->power_min, 100000);
+    }
+    gpu_shutdown();
+
+    char path[512];
+    for (unsigned int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s/gpu%u_limit", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+int main(void) {
+    test_cut();
+    test_floor();
+    test_restore();
+    test_off();
+    test_below_default();
+    test_probe();
+    return check_done("governor");
+}
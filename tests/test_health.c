@@ -0,0 +1,95 @@
+/* Per-GPU health state machine */
+#include <string.h>
+#include "check.h"
+#include "health.h"
+
+static void fresh(Health *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+/* Failed readings degrade a GPU only in a row; one success clears them */
+static void test_degraded(void) {
+    Health h;
+    fresh(&h);
+
+    for (int i = 1; i < NVFD_HEALTH_DEGRADED_AFTER; i++)
+        CHECK_INT(health_sample(&h, GPU_FAULT_TRANSIENT, i), HEALTH_OK);
+    CHECK_INT(health_sample(&h, GPU_FAULT_NONE, 10.0), HEALTH_OK);
+    CHECK_INT(h.failures, 0);
+
+    for (int i = 1; i < NVFD_HEALTH_DEGRADED_AFTER; i++)
+        health_sample(&h, GPU_FAULT_TRANSIENT, 10.0 + i);
+    CHECK_INT(health_sample(&h, GPU_FAULT_TRANSIENT, 20.0), HEALTH_DEGRADED);
+    CHECK(h.since == 20.0);
+    CHECK_INT(health_sample(&h, GPU_FAULT_TRANSIENT, 21.0), HEALTH_DEGRADED);
+    CHECK(h.since == 20.0);
+    CHECK_INT(health_sample(&h, GPU_FAULT_NONE, 22.0), HEALTH_OK);
+    CHECK(h.since == 22.0);
+    CHECK_STR(health_name(h.state), "healthy");
+}
+
+/* A lost GPU is re-probed with the wait doubling up to the maximum */
+static void test_lost(void) {
+    Health h;
+    fresh(&h);
+
+    CHECK_INT(health_sample(&h, GPU_FAULT_LOST, 100.0), HEALTH_LOST);
+    CHECK_INT(h.losses, 1);
+    CHECK(h.retry_at == 100.0 + NVFD_HEALTH_RETRY_MIN_S);
+    CHECK_STR(health_name(h.state), "lost");
+
+    /* Samples still in flight do not count it lost again */
+    CHECK_INT(health_sample(&h, GPU_FAULT_LOST, 101.0), HEALTH_LOST);
+    CHECK_INT(h.losses, 1);
+
+    double now = 105.0, backoff = NVFD_HEALTH_RETRY_MIN_S;
+    for (int i = 0; i < 20; i++) {
+        CHECK_INT(health_probe(&h, 0, now), HEALTH_LOST);
+        backoff = backoff * 2.0 < NVFD_HEALTH_RETRY_MAX_S ? backoff * 2.0
+                                                          : NVFD_HEALTH_RETRY_MAX_S;
+        CHECK(h.backoff == backoff);
+        CHECK(h.retry_at == now + backoff);
+        now = h.retry_at;
+    }
+    CHECK(h.backoff == NVFD_HEALTH_RETRY_MAX_S);
+
+    CHECK_INT(health_probe(&h, 1, now), HEALTH_OK);
+    CHECK(h.since == now);
+
+    /* Lost again: the backoff starts over */
+    health_sample(&h, GPU_FAULT_LOST, now + 1.0);
+    CHECK_INT(h.losses, 2);
+    CHECK(h.backoff == NVFD_HEALTH_RETRY_MIN_S);
+}
+
+/* Lost from the start: probed at once */
+static void test_lost_at_start(void) {
+    Health h;
+    fresh(&h);
+
+    health_lost(&h, 50.0);
+    CHECK_INT(h.state, HEALTH_LOST);
+    CHECK(h.retry_at == 50.0);
+    CHECK_INT(h.losses, 0);
+}
+
+/* Library failures are the daemon's; they leave the GPU as it was */
+static void test_library(void) {
+    Health h;
+    fresh(&h);
+
+    CHECK_INT(health_sample(&h, GPU_FAULT_LIBRARY, 1.0), HEALTH_OK);
+    CHECK_INT(h.failures, 0);
+    for (int i = 0; i < NVFD_HEALTH_DEGRADED_AFTER; i++)
+        health_sample(&h, GPU_FAULT_TRANSIENT, 2.0);
+    CHECK_INT(health_sample(&h, GPU_FAULT_LIBRARY, 3.0), HEALTH_DEGRADED);
+    CHECK_STR(health_name(h.state), "degraded");
+}
+
+int main(void) {
+    test_degraded();
+    test_lost();
+    test_lost_at_start();
+    test_library();
+    return check_done("health");
+}
@@ -0,0 +1,93 @@
+/* PID target-temperature mode */
+#include "check.h"
+#include "pid.h"
+
+/* Switching to PID mode does not jolt the fans */
+static void test_bumpless_start(void) {
+    PidGains g = { 2.0, 0.5, 1.0 };
+    PidState pid;
+
+    pid_reset(&pid);
+    CHECK_INT(pid_update(&pid, &g, 65, 70, 1.0, 20, 100, 40), 40);
+    pid_reset(&pid);
+    CHECK_INT(pid_update(&pid, &g, 65, 50, 1.0, 20, 100, 60), 60);
+}
+
+static void test_output_range(void) {
+    PidGains g = { 10.0, 0.0, 0.0 };
+    PidState pid;
+
+    pid_reset(&pid);
+    pid_update(&pid, &g, 65, 65, 1.0, 30, 90, 50);
+    CHECK_INT(pid_update(&pid, &g, 65, 80, 1.0, 30, 90, 50), 90);
+    CHECK_INT(pid_update(&pid, &g, 65, 40, 1.0, 30, 90, 50), 30);
+}
+
+/* A steady error moves the output by ki * error every second */
+static void test_integral(void) {
+    PidGains g = { 0.0, 1.0, 0.0 };
+    PidState pid;
+
+    pid_reset(&pid);
+    CHECK_INT(pid_update(&pid, &g, 65, 70, 1.0, 0, 100, 40), 40);
+    CHECK_INT(pid_update(&pid, &g, 65, 70, 1.0, 0, 100, 40), 45);
+    CHECK_INT(pid_update(&pid, &g, 65, 70, 2.0, 0, 100, 40), 55);
+    CHECK_INT(pid_update(&pid, &g, 65, 60, 1.0, 0, 100, 40), 50);
+}
+
+/* Held at 100% for a long time, the integral stops there, so the fans
+ * slow down as soon as the GPU is below target */
+static void test_windup(void) {
+    PidGains g = { 0.0, 1.0, 0.0 };
+    PidState pid;
+
+    pid_reset(&pid);
+    pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50);
+    for (int i = 0; i < 50; i++)
+        pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50);
+    CHECK_INT(pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50), 100);
+    CHECK(pid.integral <= 100.0);
+    CHECK_INT(pid_update(&pid, &g, 65, 55, 1.0, 0, 100, 50), 90);
+}
+
+/* The derivative acts on the temperature, not the error */
+static void test_derivative(void) {
+    PidGains g = { 0.0, 0.0, 2.0 };
+    PidState pid;
+
+    pid_reset(&pid);
+    CHECK_INT(pid_update(&pid, &g, 65, 60, 1.0, 0, 100, 50), 50);
+    CHECK_INT(pid_update(&pid, &g, 65, 65, 1.0, 0, 100, 50), 60);
+    CHECK_INT(pid_update(&pid, &g, 65, 65, 1.0, 0, 100, 50), 50);
+    CHECK_INT(pid_update(&pid, &g, 55, 65, 1.0, 0, 100, 50), 50);
+    CHECK_INT(pid_update(&pid, &g, 55, 65, 0.0, 0, 100, 50), 50);
+}
+
+/* Slew-limited below what it asked, the PID takes back its integral step
+ * instead of piling it up against the limit */
+static void test_track(void) {
+    PidGains g = { 0.0, 1.0, 0.0 };
+    PidState pid;
+
+    pid_reset(&pid);
+    pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50);
+    CHECK_INT(pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50), 60);
+    pid_track(&pid, 60, 55);
+    CHECK_INT(pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50), 60);
+    pid_track(&pid, 60, 60);
+    CHECK_INT(pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50), 70);
+
+    /* Held back against the direction it moved: nothing to undo */
+    pid_track(&pid, 70, 75);
+    CHECK_INT(pid_update(&pid, &g, 65, 75, 1.0, 0, 100, 50), 80);
+}
+
+int main(void) {
+    test_bumpless_start();
+    test_output_range();
+    test_integral();
+    test_windup();
+    test_derivative();
+    test_track();
+    return check_done("pid");
+}
@@ -0,0 +1,76 @@
+/* Process name patterns of the process rules */
+#include <string.h>
+#include "check.h"
+#include "proc.h"
+
+/* match GLOB S: compiled once, matched against S */
+static int match(const char *glob, const char *s) {
+    ProcPattern p;
+    if (proc_pattern_compile(&p, glob) != 0)
+        return -1;
+    int m = proc_pattern_match(&p, s, strlen(s));
+    proc_pattern_free(&p);
+    return m;
+}
+
+static ProcMatchKind kind(const char *glob) {
+    ProcPattern p;
+    proc_pattern_compile(&p, glob);
+    ProcMatchKind k = p.kind;
+    proc_pattern_free(&p);
+    return k;
+}
+
+/* Plain compares wherever the pattern allows one */
+static void test_kind(void) {
+    CHECK_INT(kind(NULL), PROC_MATCH_ANY);
+    CHECK_INT(kind("*"), PROC_MATCH_ANY);
+    CHECK_INT(kind("**"), PROC_MATCH_ANY);
+    CHECK_INT(kind("python"), PROC_MATCH_EXACT);
+    CHECK_INT(kind("python*"), PROC_MATCH_PREFIX);
+    CHECK_INT(kind("*.bin"), PROC_MATCH_SUFFIX);
+    CHECK_INT(kind("*torch*"), PROC_MATCH_CONTAINS);
+    CHECK_INT(kind("py?hon"), PROC_MATCH_GLOB);
+    CHECK_INT(kind("py*on"), PROC_MATCH_GLOB);
+    CHECK_INT(kind("[pP]ython"), PROC_MATCH_GLOB);
+}
+
+static void test_match(void) {
+    CHECK_INT(match(NULL, "anything"), 1);
+    CHECK_INT(match("*", ""), 1);
+    CHECK_INT(match("python", "python"), 1);
+    CHECK_INT(match("python", "python3"), 0);
+    CHECK_INT(match("python", "pytho"), 0);
+    CHECK_INT(match("python*", "python3"), 1);
+    CHECK_INT(match("python*", "python"), 1);
+    CHECK_INT(match("python*", "ipython"), 0);
+    CHECK_INT(match("*.bin", "model.bin"), 1);
+    CHECK_INT(match("*.bin", "bin"), 0);
+    CHECK_INT(match("*torch*", "run_torch_job"), 1);
+    CHECK_INT(match("*torch*", "torch"), 1);
+    CHECK_INT(match("*torch*", "tor"), 0);
+    CHECK_INT(match("py?hon", "python"), 1);
+    CHECK_INT(match("py*on", "pyon"), 1);
+    CHECK_INT(match("[pP]ython", "Python"), 1);
+    CHECK_INT(match("[pP]ython", "jython"), 0);
+}
+
+/* Names are matched by length, as read from /proc, not up to a NUL */
+static void test_length(void) {
+    ProcPattern p;
+    proc_pattern_compile(&p, "python");
+    CHECK_INT(proc_pattern_match(&p, "python3", 6), 1);
+    CHECK_INT(proc_pattern_match(&p, "python", 5), 0);
+    proc_pattern_free(&p);
+
+    proc_pattern_compile(&p, "*on");
+    CHECK_INT(proc_pattern_match(&p, "python3", 6), 1);
+    proc_pattern_free(&p);
+}
+
+int main(void) {
+    test_kind();
+    test_match();
+    test_length();
+    return check_done("proc");
+}
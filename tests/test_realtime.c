@@ -0,0 +1,58 @@
+/* Real-time options: CPU lists and scheduling policies */
+#include <string.h>
+#include "check.h"
+#include "realtime.h"
+
+static void test_cpus(void) {
+    CHECK_INT(rt_valid_cpus("0"), 0);
+    CHECK_INT(rt_valid_cpus("0-3,8"), 0);
+    CHECK_INT(rt_valid_cpus("8,0-3"), 0);
+    CHECK_INT(rt_valid_cpus("2-2"), 0);
+    /* As read from sysfs */
+    CHECK_INT(rt_valid_cpus("0-3\n"), 0);
+
+    CHECK_INT(rt_valid_cpus(""), -1);
+    CHECK_INT(rt_valid_cpus("\n"), -1);
+    CHECK_INT(rt_valid_cpus("3-1"), -1);
+    CHECK_INT(rt_valid_cpus("-1"), -1);
+    CHECK_INT(rt_valid_cpus("0,"), -1);
+    CHECK_INT(rt_valid_cpus("0,,1"), -1);
+    CHECK_INT(rt_valid_cpus("0-"), -1);
+    CHECK_INT(rt_valid_cpus("0;1"), -1);
+    CHECK_INT(rt_valid_cpus("all"), -1);
+    CHECK_INT(rt_valid_cpus("99999"), -1);
+}
+
+static void test_sched(void) {
+    RtSched s;
+    CHECK(rt_parse_sched("fifo", &s) == 0 && s == RT_SCHED_FIFO);
+    CHECK(rt_parse_sched("rr", &s) == 0 && s == RT_SCHED_RR);
+    CHECK(rt_parse_sched("other", &s) == 0 && s == RT_SCHED_OTHER);
+    /* "inherit" is what leaving the option out means; it cannot be written */
+    CHECK_INT(rt_parse_sched("inherit", &s), -1);
+    CHECK_INT(rt_parse_sched("batch", &s), -1);
+    CHECK_STR(rt_sched_name(RT_SCHED_RR), "rr");
+    CHECK_STR(rt_sched_name(RT_SCHED_INHERIT), "inherit");
+}
+
+/* The priority only matters to the policies that use it */
+static void test_equal(void) {
+    RealtimeParams a, b;
+    rt_defaults(&a);
+    rt_defaults(&b);
+    CHECK(rt_equal(&a, &b));
+    b.priority = a.priority + 1;
+    CHECK(rt_equal(&a, &b));
+    a.sched = b.sched = RT_SCHED_FIFO;
+    CHECK(!rt_equal(&a, &b));
+    b.priority = a.priority;
+    strcpy(b.cpus, "0-1");
+    CHECK(!rt_equal(&a, &b));
+}
+
+int main(void) {
+    test_cpus();
+    test_sched();
+    test_equal();
+    return check_done("realtime");
+}
@@ -0,0 +1,113 @@
+/* Sensor expressions: what a curve or controller reads */
+#include "check.h"
+#include "sensor.h"
+
+static int parses(const char *text) {
+    SensorExpr e;
+    return sensor_parse(text, &e) == 0;
+}
+
+static void test_parse(void) {
+    SensorExpr e;
+
+    CHECK_INT(sensor_parse("core", &e), 0);
+    CHECK(e.count == 1 && e.terms[0].sensor == SENSOR_CORE && e.terms[0].offset == 0);
+    CHECK_INT(sensor_parse("  mem-10 ", &e), 0);
+    CHECK(e.count == 1 && e.terms[0].sensor == SENSOR_MEM && e.terms[0].offset == -10);
+    CHECK_INT(sensor_parse("max(core, mem-10)", &e), 0);
+    CHECK(e.count == 2 && e.terms[0].sensor == SENSOR_CORE &&
+          e.terms[1].sensor == SENSOR_MEM && e.terms[1].offset == -10);
+    CHECK_INT(sensor_parse("max ( core+5 ,mem )", &e), 0);
+    CHECK(e.count == 2 && e.terms[0].offset == 5);
+
+    CHECK(!parses(""));
+    CHECK(!parses("gpu"));
+    CHECK(!parses("cores"));
+    CHECK(!parses("core-"));
+    CHECK(!parses("core--5"));
+    CHECK(!parses("core 5"));
+    CHECK(!parses("max()"));
+    CHECK(!parses("max(core"));
+    CHECK(!parses("max(core,)"));
+    CHECK(!parses("max(core) mem"));
+    CHECK(!parses("min(core, mem)"));
+}
+
+static void test_limits(void) {
+    char text[64];
+
+    snprintf(text, sizeof(text), "mem-%d", SENSOR_OFFSET_MAX);
+    CHECK(parses(text));
+    snprintf(text, sizeof(text), "mem+%d", SENSOR_OFFSET_MAX);
+    CHECK(parses(text));
+    snprintf(text, sizeof(text), "mem-%d", SENSOR_OFFSET_MAX + 1);
+    CHECK(!parses(text));
+    snprintf(text, sizeof(text), "core+%d", SENSOR_OFFSET_MAX + 1);
+    CHECK(!parses(text));
+    CHECK(!parses("core+99999999999999999999"));
+
+    /* SENSOR_TERMS_MAX terms, then one too many */
+    CHECK_INT(SENSOR_TERMS_MAX, 4);
+    CHECK(parses("max(core, mem, core+1, mem+1)"));
+    CHECK(!parses("max(core, mem, core+1, mem+1, core+2)"));
+}
+
+static void test_eval(void) {
+    SensorExpr e;
+    int both[SENSOR_COUNT] = { 70, 88 };
+    int no_mem[SENSOR_COUNT] = { 70, -1 };
+
+    sensor_parse("max(core, mem-10)", &e);
+    CHECK_INT(sensor_eval(&e, both), 78);
+    both[SENSOR_MEM] = 75;
+    CHECK_INT(sensor_eval(&e, both), 70);
+    /* A missing sensor drops out of the max */
+    CHECK_INT(sensor_eval(&e, no_mem), 70);
+
+    /* Nothing to read: -1, and the daemon falls back to the core */
+    sensor_parse("mem", &e);
+    CHECK_INT(sensor_eval(&e, no_mem), -1);
+
+    /* Offsets never take a reading below 0 °C */
+    int cold[SENSOR_COUNT] = { 5, 5 };
+    sensor_parse("mem-10", &e);
+    CHECK_INT(sensor_eval(&e, cold), 0);
+
+    /* No terms is the core */
+    SensorExpr none = { 0 };
+    CHECK_INT(sensor_eval(&none, no_mem), 70);
+    CHECK_INT(sensor_mask(&none), 1u << SENSOR_CORE);
+    sensor_parse("max(mem, mem-5)", &e);
+    CHECK_INT(sensor_mask(&e), 1u << SENSOR_MEM);
+}
+
+/* What sensor_format writes parses back to the same expression */
+static void test_round_trip(void) {
+    const char *texts[] = { "core", "mem-10", "max(core, mem-10)",
+                            "max(core+5, mem, mem+50)", "core-50" };
+    for (unsigned int i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        SensorExpr a, b;
+        char buf[128];
+        CHECK_INT(sensor_parse(texts[i], &a), 0);
+        sensor_format(&a, buf, sizeof(buf));
+        CHECK_STR(buf, texts[i]);
+        CHECK_INT(sensor_parse(buf, &b), 0);
+        CHECK(b.count == a.count);
+        for (int t = 0; t < a.count && t < b.count; t++)
+            CHECK(b.terms[t].sensor == a.terms[t].sensor &&
+                  b.terms[t].offset == a.terms[t].offset);
+    }
+
+    SensorExpr none = { 0 };
+    char buf[16];
+    sensor_format(&none, buf, sizeof(buf));
+    CHECK_STR(buf, "core");
+}
+
+int main(void) {
+    test_parse();
+    test_limits();
+    test_eval();
+    test_round_trip();
+    return check_done("sensor");
+}
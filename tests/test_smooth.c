@@ -0,0 +1,94 @@
+/* Temperature filter and fan slew limit */
+#include "check.h"
+#include "smooth.h"
+
+static void params(SmoothParams *p, FilterKind kind) {
+    smooth_defaults(p);
+    p->kind = kind;
+    p->tau_s = 1.0;
+    p->window = 3;
+    p->slew_up = 10.0;
+    p->slew_down = 5.0;
+}
+
+static void test_parse(void) {
+    FilterKind kind;
+    CHECK(smooth_parse_filter("none", &kind) == 0 && kind == FILTER_NONE);
+    CHECK(smooth_parse_filter("ema", &kind) == 0 && kind == FILTER_EMA);
+    CHECK(smooth_parse_filter("median", &kind) == 0 && kind == FILTER_MEDIAN);
+    CHECK_INT(smooth_parse_filter("mean", &kind), -1);
+}
+
+/* With dt equal to tau, each sample moves the EMA halfway */
+static void test_ema(void) {
+    SmoothParams p;
+    TempFilter f;
+
+    params(&p, FILTER_EMA);
+    temp_filter_reset(&f);
+    CHECK_INT(temp_filter_update(&f, &p, 50, 1.0), 50);
+    CHECK_INT(temp_filter_update(&f, &p, 60, 1.0), 55);
+    CHECK_INT(temp_filter_update(&f, &p, 60, 1.0), 58);
+    CHECK_INT(temp_filter_update(&f, &p, 60, 3.0), 59);
+
+    p.tau_s = 0.0;
+    CHECK_INT(temp_filter_update(&f, &p, 40, 1.0), 40);
+}
+
+/* A one-sample spike never gets through a median of three */
+static void test_median(void) {
+    SmoothParams p;
+    TempFilter f;
+
+    params(&p, FILTER_MEDIAN);
+    temp_filter_reset(&f);
+    CHECK_INT(temp_filter_update(&f, &p, 50, 1.0), 50);
+    CHECK_INT(temp_filter_update(&f, &p, 52, 1.0), 51);
+    CHECK_INT(temp_filter_update(&f, &p, 90, 1.0), 52);
+    CHECK_INT(temp_filter_update(&f, &p, 53, 1.0), 53);
+    CHECK_INT(temp_filter_update(&f, &p, 54, 1.0), 54);
+
+    /* The window shrinking on reload starts it over */
+    p.window = 1;
+    CHECK_INT(temp_filter_update(&f, &p, 70, 1.0), 70);
+}
+
+static void test_none(void) {
+    SmoothParams p;
+    TempFilter f;
+
+    params(&p, FILTER_NONE);
+    temp_filter_reset(&f);
+    CHECK_INT(temp_filter_update(&f, &p, 50, 1.0), 50);
+    CHECK_INT(temp_filter_update(&f, &p, 90, 1.0), 90);
+}
+
+static void test_slew(void) {
+    SmoothParams p;
+    SlewLimiter s;
+
+    params(&p, FILTER_NONE);
+    slew_reset(&s);
+    CHECK(slew_settled(&s, 30));
+    CHECK_INT(slew_update(&s, &p, 30, 1.0, 0), 30);
+    CHECK_INT(slew_update(&s, &p, 80, 1.0, 0), 40);
+    CHECK(!slew_settled(&s, 80));
+    CHECK_INT(slew_update(&s, &p, 80, 0.5, 0), 45);
+    CHECK_INT(slew_update(&s, &p, 80, 10.0, 0), 80);
+    CHECK(slew_settled(&s, 80));
+    CHECK_INT(slew_update(&s, &p, 30, 1.0, 0), 75);
+    CHECK_INT(slew_update(&s, &p, 30, 1.0, 1), 30);
+
+    /* 0 = unlimited */
+    p.slew_up = 0.0;
+    CHECK_INT(slew_update(&s, &p, 100, 0.1, 0), 100);
+}
+
+int main(void) {
+    test_parse();
+    test_ema();
+    test_median();
+    test_none();
+    test_slew();
+    return check_done("smooth");
+}
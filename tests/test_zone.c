@@ -0,0 +1,85 @@
+/* Airflow zones: member readings combined into one temperature */
+#include <string.h>
+#include "check.h"
+#include "zone.h"
+
+static void make_zone(Zone *z, ZoneCombine combine, int count) {
+    memset(z, 0, sizeof(*z));
+    z->combine = combine;
+    z->member_count = count;
+    for (int m = 0; m < count; m++) {
+        z->members[m].gpu = m;
+        z->members[m].weight = 1.0;
+    }
+}
+
+static void test_parse(void) {
+    ZoneCombine c;
+    CHECK(zone_parse_combine("max", &c) == 0 && c == ZONE_MAX);
+    CHECK(zone_parse_combine("weighted", &c) == 0 && c == ZONE_WEIGHTED);
+    CHECK_INT(zone_parse_combine("mean", &c), -1);
+    CHECK_INT(zone_parse_combine(NULL, &c), -1);
+    CHECK_STR(zone_combine_name(ZONE_WEIGHTED), "weighted");
+    CHECK_STR(zone_combine_name(ZONE_MAX), "max");
+}
+
+/* The hottest member after its offset */
+static void test_max(void) {
+    Zone z;
+    make_zone(&z, ZONE_MAX, 3);
+
+    int temps[] = { 60, 72, 65 };
+    CHECK_INT(zone_combine(&z, temps), 72);
+    z.members[2].offset = 10;
+    CHECK_INT(zone_combine(&z, temps), 75);
+    z.members[1].offset = -80;
+    CHECK_INT(zone_combine(&z, temps), 75);
+}
+
+static void test_weighted(void) {
+    Zone z;
+    make_zone(&z, ZONE_WEIGHTED, 3);
+
+    int temps[] = { 60, 70, 80 };
+    CHECK_INT(zone_combine(&z, temps), 70);
+    z.members[2].weight = 2.0;
+    CHECK_INT(zone_combine(&z, temps), 73);
+    z.members[0].offset = 5;
+    CHECK_INT(zone_combine(&z, temps), 74);
+
+    /* No weight at all: the hottest */
+    for (int m = 0; m < 3; m++)
+        z.members[m].weight = 0.0;
+    CHECK_INT(zone_combine(&z, temps), 80);
+}
+
+/* Members without a reading (-1) are left out, offset or not */
+static void test_missing(void) {
+    Zone z;
+    make_zone(&z, ZONE_MAX, 3);
+    z.members[1].offset = 30;
+
+    int temps[] = { 60, -1, 55 };
+    CHECK_INT(zone_combine(&z, temps), 60);
+
+    z.combine = ZONE_WEIGHTED;
+    CHECK_INT(zone_combine(&z, temps), 58);
+
+    int none[] = { -1, -1, -1 };
+    CHECK_INT(zone_combine(&z, none), -1);
+    z.combine = ZONE_MAX;
+    CHECK_INT(zone_combine(&z, none), -1);
+
+    /* A negative offset stops at 0 °C, still a reading */
+    z.members[0].offset = -90;
+    int cold[] = { 20, -1, -1 };
+    CHECK_INT(zone_combine(&z, cold), 0);
+}
+
+int main(void) {
+    test_parse();
+    test_max();
+    test_weighted();
+    test_missing();
+    return check_done("zone");
+}